@@ -0,0 +1,53 @@
+/*******************************************************************************
+ * In this example we read two sensors without blocking loop(): every call to
+ * poll() runs one step of the reading, so the settle wait of one sensor
+ * overlaps with the reading of the other and loop() stays free for other work
+ * The sensors are read about every 10 minutes
+ ******************************************************************************/
+#include <FlowerCare_BLE.h>
+
+// sensor addresses
+#define FLORA_ADDR1 "XX:XX:XX:XX:XX:01"
+#define FLORA_ADDR2 "XX:XX:XX:XX:XX:02"
+
+// 10 minutes in ms
+#define TEN_MINUTES 600000
+
+FlowerCare* flora[2];
+unsigned long lastRead;
+
+// print the data as soon as a reading ends
+void readDone(FlowerCare* sensor, FC_RET_T ret, void* arg) {
+  Serial.print(sensor->addr().c_str());
+  if (ret != FLCARE_OK) {
+    Serial.print(" error ");
+    Serial.println(ret);
+    return;
+  }
+  Serial.println();
+  Serial.print(sensor->dataStr());
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  flora[0] = new FlowerCare(FLORA_ADDR1, FICUS);
+  flora[1] = new FlowerCare(FLORA_ADDR2, BEGONIA);
+
+  lastRead = millis() - TEN_MINUTES;
+}
+
+void loop() {
+  if (millis() - lastRead >= TEN_MINUTES) {
+    lastRead = millis();
+    for (int i = 0; i < 2; i++) {
+      flora[i]->beginRead(readDone, NULL);
+    }
+  }
+
+  for (int i = 0; i < 2; i++) {
+    flora[i]->poll();
+  }
+
+  // other work here
+}
@@ -0,0 +1,59 @@
+/*******************************************************************************
+ * In this example a battery gateway reads its sensors every 10 minutes. All
+ * the sensors due are read in one short radio window, then the ESP32 deep
+ * sleeps until the next one. The schedule and the last readings are kept in
+ * RTC memory, every wake-up starts again from setup()
+ ******************************************************************************/
+#include <FlowerCare_Sleep.h>
+
+// kept across deep sleep, reset on power on
+RTC_DATA_ATTR FlowerCareSleepState_t rtcState;
+
+FlowerCareFleet fleet(3);
+FlowerCareSleep gateway(&fleet, &rtcState);
+
+// print each sensor as soon as it has been read
+void printSensor(size_t idx, FlowerCare* sensor, FC_RET_T ret, void* arg) {
+  Serial.print("Sensor ");
+  Serial.print(sensor->addr().c_str());
+  if (ret != FLCARE_OK) {
+    Serial.print(" error ");
+    Serial.println(ret);
+    return;
+  }
+  Serial.println();
+  Serial.print(sensor->dataStr());
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  fleet.add("XX:XX:XX:XX:XX:01", FICUS);
+  fleet.add("XX:XX:XX:XX:XX:02", BEGONIA);
+  fleet.add("XX:XX:XX:XX:XX:03", OCIMUM_BASILICUM);
+
+  if (!gateway.restore()) {
+    Serial.println("Cold boot, new schedule");
+  }
+
+  gateway.window(printSensor, NULL);
+
+  FlowerCareEnergy_t energy;
+  gateway.report(&energy);
+  Serial.print("Window ");
+  Serial.print(energy.windowMs);
+  Serial.print(" ms, duty cycle ");
+  Serial.print(energy.dutyCycle * 100, 3);
+  Serial.print(" %, average ");
+  Serial.print(energy.avgMa, 3);
+  Serial.println(" mA");
+  Serial.flush();
+
+  // sleeps only if the next window is far enough, otherwise loop() runs it
+  gateway.sleep(SLEEP_DEEP);
+}
+
+void loop() {
+  gateway.window(printSensor, NULL);
+  gateway.sleep(SLEEP_DEEP);
+}
@@ -0,0 +1,51 @@
+/*******************************************************************************
+ * In this example the sensors are found by a BLE scan instead of hard-coded
+ * addresses. The registry of the sensors is saved in NVS: after a reboot the
+ * polling resumes at once, the scan runs only when no sensor is known
+ * The sensors are read about every 10 minutes
+ ******************************************************************************/
+#include <FlowerCare_Registry.h>
+
+// 10 minutes in ms
+#define TEN_MINUTES 600000
+// scan window in ms
+#define SCAN_MS 10000
+
+FlowerCareNVSStore store;
+FlowerCareRegistry registry(&store);
+FlowerCareFleet fleet(3);
+
+void setup() {
+  Serial.begin(9600);
+
+  if (!registry.load() || registry.size() == 0) {
+    Serial.println("Scanning for sensors...");
+    registry.discover(SCAN_MS);
+  }
+
+  for (size_t i = 0; i < registry.size(); i++) {
+    const FlowerCareRegEntry_t* e = registry.get(i);
+    Serial.print("Sensor ");
+    Serial.print(e->addr);
+    Serial.print(" RSSI ");
+    Serial.println(e->rssi);
+  }
+
+  // sensors without an assigned plant, see registry.setPlant(), use FICUS
+  registry.addTo(&fleet, FICUS);
+}
+
+void loop() {
+  for (size_t i = 0; i < fleet.size(); i++) {
+    FlowerCare* sensor = fleet.sensor(i);
+    FlowerCareDataExt_t data;
+
+    // the battery and firmware are read once a day, data at every call
+    if (sensor->getDataExt(&data) == FLCARE_OK) {
+      registry.update(sensor);
+      Serial.print(sensor->dataStr());
+    }
+  }
+
+  delay(TEN_MINUTES);
+}
@@ -0,0 +1,61 @@
+/*******************************************************************************
+ * In this example we read several sensors with up to 3 connections in flight
+ * and print the results on the serial monitor
+ * The sensors are read about every 10 minutes, an alert is printed when a
+ * value stays out of the plant range for 3 readings in a row
+ ******************************************************************************/
+#include <FlowerCare_Alert.h>
+#include <FlowerCare_Fleet.h>
+
+// 10 minutes in ms
+#define TEN_MINUTES 600000
+
+FlowerCareFleet fleet(3);
+FlowerCareAlerts alerts(4);
+
+// print the alerts, at most one per hour and metric
+void printAlert(size_t idx, const FlowerCareAlertEvent_t* ev, void* arg) {
+  Serial.print("Alert sensor ");
+  Serial.print(fleet.sensor(idx)->addr().c_str());
+  Serial.print(" field ");
+  Serial.print(ev->field);
+  Serial.print(ev->to < 0 ? " low " : ev->to > 0 ? " high " : " ok ");
+  Serial.println(ev->value);
+}
+
+// print each sensor as soon as it has been read
+void printSensor(size_t idx, FlowerCare* sensor, FC_RET_T ret, void* arg) {
+  Serial.print("Sensor ");
+  Serial.print(sensor->addr().c_str());
+  if (ret != FLCARE_OK) {
+    Serial.print(" error ");
+    Serial.println(ret);
+    return;
+  }
+  Serial.println();
+  Serial.print(sensor->dataStr());
+
+  alerts.evaluate(idx, millis() / 1000, sensor->data(), sensor->plant());
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  fleet.add("XX:XX:XX:XX:XX:01", FICUS);
+  fleet.add("XX:XX:XX:XX:XX:02", BEGONIA);
+  fleet.add("XX:XX:XX:XX:XX:03", OCIMUM_BASILICUM);
+  fleet.add("XX:XX:XX:XX:XX:04", SUCCULENTS);
+
+  alerts.setCallback(printAlert, NULL);
+}
+
+void loop() {
+  size_t ok = fleet.sweep(printSensor, NULL);
+
+  Serial.print(ok);
+  Serial.print("/");
+  Serial.print(fleet.size());
+  Serial.println(" sensors read");
+
+  delay(TEN_MINUTES);
+}
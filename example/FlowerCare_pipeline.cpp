@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * In this example the sensors are read by a task on core 0, next to the BLE
+ * stack, while a task on core 1 checks the readings and prints them on the
+ * serial monitor. A slow serial link does not delay the BLE reads: if the
+ * printing falls behind, the oldest readings are overwritten
+ * The sensors are read about every 10 minutes
+ ******************************************************************************/
+#include <FlowerCare_Pipeline.h>
+
+// 10 minutes in ms
+#define TEN_MINUTES 600000
+
+FlowerCareFleet fleet(3);
+FlowerCarePipeline pipeline(&fleet, 32, QUEUE_OVERWRITE);
+
+// runs on core 1 for every reading
+void printReading(const FlowerCareItem_t* item, void* arg) {
+  FlowerCare* sensor = fleet.sensor(item->sensor);
+  char buf[FC_FORMAT_MAXLEN];
+
+  if (item->ret != FLCARE_OK) {
+    Serial.print("Sensor ");
+    Serial.print(sensor->addr().c_str());
+    Serial.print(" error ");
+    Serial.println(item->ret);
+    return;
+  }
+
+  fcFormat(FORMAT_TEXT, sensor->addr().c_str(), item->time, item->reading,
+           item->fields, buf, sizeof(buf));
+  Serial.print(buf);
+
+  const PlantVal_t& p = sensor->plant();
+  if (fcCheck(item->reading.moist, (uint8_t)p.moist_min,
+              (uint8_t)p.moist_max) < 0) {
+    Serial.println("Needs water!");
+  }
+}
+
+void setup() {
+  Serial.begin(9600);
+
+  fleet.add("XX:XX:XX:XX:XX:01", FICUS);
+  fleet.add("XX:XX:XX:XX:XX:02", BEGONIA);
+  fleet.add("XX:XX:XX:XX:XX:03", OCIMUM_BASILICUM);
+  fleet.add("XX:XX:XX:XX:XX:04", SUCCULENTS);
+
+  pipeline.setConsumer(printReading, NULL);
+  pipeline.setInterval(TEN_MINUTES);
+  pipeline.start();
+}
+
+void loop() {
+  FlowerCareQueueStats_t stats;
+
+  delay(TEN_MINUTES);
+
+  pipeline.queue().stats(&stats);
+  Serial.print("Readings: ");
+  Serial.print(stats.pushed);
+  Serial.print(" pushed, ");
+  Serial.print(stats.overwritten);
+  Serial.print(" overwritten, max depth ");
+  Serial.println(stats.maxDepth);
+}
@@ -0,0 +1,473 @@
+/*******************************************************************************
+ * Host benchmarks of the hot paths, run against the simulated transport.
+ * Every benchmark runs batches of operations and reports throughput, p50/p99
+ * of the per-operation time (measured per batch) and heap allocations per
+ * operation
+ *
+ * Build and run from the repository root:
+ *   g++ -std=c++11 -O2 -Isrc extras/benchmark/FlowerCare_bench.cpp \
+ *       src/FlowerCare*.cpp -lpthread -o fc_bench
+ *   ./fc_bench [name filter]
+ ******************************************************************************/
+#include <FlowerCare_Fleet.h>
+#include <FlowerCare_Pipeline.h>
+#include "../common/FlowerCare_allocs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*******************************************************************************
+ *                                  HARNESS
+ ******************************************************************************/
+
+static const char* filter = NULL;
+
+// keeps the optimizer from dropping benchmarked results
+static volatile uint64_t sink;
+
+static uint64_t nowNs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// true if the benchmark matches the filter of the command line
+static bool selected(const char* name) {
+  return filter == NULL || strstr(name, filter) != NULL;
+}
+
+/**
+ * @brief Run fn(i) batches x batchOps times and print the results
+ *
+ * @param name     benchmark name
+ * @param batches  number of timed batches
+ * @param batchOps operations per batch
+ * @param fn       the operation, gets the operation index
+ */
+template <class F>
+static void bench(const char* name, size_t batches, size_t batchOps, F fn) {
+  if (!selected(name)) {
+    return;
+  }
+
+  std::vector<double> perOp(batches);
+  size_t op = 0;
+
+  // warm up
+  for (size_t i = 0; i < batchOps; i++) {
+    fn(op++);
+  }
+
+  uint64_t allocStart = allocs.load();
+  uint64_t start = nowNs();
+
+  for (size_t b = 0; b < batches; b++) {
+    uint64_t t = nowNs();
+    for (size_t i = 0; i < batchOps; i++) {
+      fn(op++);
+    }
+    perOp[b] = (double)(nowNs() - t) / batchOps;
+  }
+
+  uint64_t total = nowNs() - start;
+  uint64_t nAllocs = allocs.load() - allocStart;
+  size_t ops = batches * batchOps;
+
+  std::sort(perOp.begin(), perOp.end());
+
+  printf("%-28s %12.0f op/s  p50 %12.1f ns  p99 %12.1f ns  %6.2f alloc/op\n",
+         name, ops / (total / 1e9), perOp[batches / 2],
+         perOp[std::min(batches - 1, batches * 99 / 100)],
+         (double)nAllocs / ops);
+}
+
+static FlowerCareTransport* simTransport(void* sim) {
+  return new FlowerCareSimTransport((FlowerCareSim*)sim);
+}
+
+static std::string sensorAddr(size_t i) {
+  char buf[18];
+  snprintf(buf, sizeof(buf), "C4:7C:8D:%02X:%02X:%02X",
+           (unsigned)(i >> 16) & 0xFF, (unsigned)(i >> 8) & 0xFF,
+           (unsigned)i & 0xFF);
+  return buf;
+}
+
+/*******************************************************************************
+ *                                BENCHMARKS
+ ******************************************************************************/
+
+// end to end reading over a zero latency simulated link
+static void benchGetData() {
+  FlowerCareSim sim;
+  sim.setData("C4:7C:8D:00:00:01", 21.5, 35, 5000, 400);
+  FlowerCareSimTransport link(&sim);
+  FlowerCare flora("C4:7C:8D:00:00:01", FICUS, &link);
+  flora.setSettleTime(0);
+
+  bench("getData", 200, 50, [&](size_t) { sink += flora.getData(); });
+
+  flora.setSession(true);
+  bench("getData/session", 200, 200, [&](size_t) { sink += flora.getData(); });
+}
+
+// store in memory, keeps the file system out of the measurements
+class MemStore : public FlowerCareStore {
+ public:
+  bool load(const char* key, void* buf, size_t len) {
+    std::map<std::string, std::string>::iterator it = _values.find(key);
+    if (it == _values.end() || it->second.size() != len) {
+      return false;
+    }
+    memcpy(buf, it->second.data(), len);
+    return true;
+  }
+  bool save(const char* key, const void* buf, size_t len) {
+    _values[key].assign((const char*)buf, len);
+    return true;
+  }
+
+ private:
+  std::map<std::string, std::string> _values;
+};
+
+// reconnects with 5 ms discovery latency, discovering the characteristics
+// every time or using the handles cached by the first connection
+static void benchHandleCache() {
+  FlowerCareSim sim;
+  sim.addSensor("C4:7C:8D:00:00:01");
+  sim.config.discover_ms = 5;
+  FlowerCareSimTransport link(&sim);
+  FlowerCare flora("C4:7C:8D:00:00:01", FICUS, &link);
+  flora.setSettleTime(0);
+  MemStore store;
+
+  bench("reconnect/discover", 10, 5, [&](size_t) { sink += flora.getData(); });
+
+  flora.setHandleCache(&store);
+  bench("reconnect/cached", 10, 5, [&](size_t) { sink += flora.getData(); });
+}
+
+// decoding of the 0x1a01 value and of MiBeacon frames
+static void benchDecode() {
+  std::vector<std::vector<uint8_t>> payloads(256);
+  for (size_t i = 0; i < payloads.size(); i++) {
+    payloads[i].resize(SENSORDATA_LEN);
+    for (size_t j = 0; j < SENSORDATA_LEN; j++) {
+      payloads[i][j] = (uint8_t)(i * 31 + j * 7);
+    }
+  }
+
+  FlowerCareReading_t reading;
+  bench("decode/reading", 500, 10000, [&](size_t i) {
+    const std::vector<uint8_t>& p = payloads[i & 255];
+    sink += fcDecode(p.data(), p.size(), &reading);
+    sink += reading.light;
+  });
+
+  FlowerCareData_t data;
+  bench("decode/data", 500, 10000, [&](size_t i) {
+    const std::vector<uint8_t>& p = payloads[i & 255];
+    sink += FlowerCare::decode(p.data(), p.size(), &data);
+    sink += data.light;
+  });
+
+  uint8_t frame[16];
+  FlowerCareAdv_t adv = {MIBEACON_FLOWERCARE, 0, ADV_LIGHT, 12345};
+  size_t len = fcBuildAdv(&adv, frame, sizeof(frame));
+  bench("decode/adv", 500, 10000, [&](size_t) {
+    sink += fcParseAdv(frame, len, &adv);
+    sink += adv.value;
+  });
+}
+
+// threshold checks and formatting on sensors loaded with varied data
+static void benchCheckFormat() {
+  const size_t n = 64;
+  FlowerCareSim sim;
+  FlowerCareSimTransport link(&sim);
+  std::vector<FlowerCare*> sensors;
+
+  for (size_t i = 0; i < n; i++) {
+    std::string addr = sensorAddr(i);
+    sim.setData(addr, 5 + i % 30, i % 70, (int)(i * 997 % 60000),
+                (int)(i * 37 % 1000));
+    FlowerCare* f = new FlowerCare(addr, (Plant)(i % PLANT_COUNT), &link);
+    f->setSettleTime(0);
+    f->getData();
+    sensors.push_back(f);
+  }
+
+  bench("check/all4", 500, 10000, [&](size_t i) {
+    FlowerCare* f = sensors[i % n];
+    sink += f->checkTemp() + f->checkMoist() + f->checkLight() + f->checkFert();
+  });
+
+  // same readings, thresholds known at compile time
+  typedef FlowerCarePlant<PlantProfile<FICUS>> Ficus;
+  bench("check/all4/profile", 500, 10000, [&](size_t i) {
+    const FlowerCareData_t& d = sensors[i % n]->data();
+    sink += Ficus::checkTemp(d.temp) + Ficus::checkMoist(d.moist) +
+            Ficus::checkLight(d.light) + Ficus::checkFert(d.fert);
+  });
+
+  bench("format/dataStr", 200, 1000, [&](size_t i) {
+    sink += sensors[i % n]->dataStr().length();
+  });
+
+  // into a caller buffer, without heap use
+  static const char* const formats[] = {"text", "json", "influx", "binary"};
+  char buf[FC_FORMAT_MAXLEN];
+  for (int fmt = FORMAT_TEXT; fmt <= FORMAT_BINARY; fmt++) {
+    std::string name = std::string("format/") + formats[fmt];
+    bench(name.c_str(), 200, 1000, [&](size_t i) {
+      sink += sensors[i % n]->format((FC_FORMAT_T)fmt, buf, sizeof(buf),
+                                     1700000000);
+    });
+  }
+
+  // a whole sweep packed for transmission
+  std::vector<char> batchBuf(n * FC_FORMAT_MAXLEN);
+  for (int fmt = FORMAT_JSON; fmt <= FORMAT_BINARY; fmt++) {
+    std::string name = std::string("batch/64/") + formats[fmt];
+    FlowerCareBatch batch(batchBuf.data(), batchBuf.size(), (FC_FORMAT_T)fmt);
+    bench(name.c_str(), 200, 10, [&](size_t) {
+      batch.clear();
+      for (size_t i = 0; i < n; i++) {
+        FlowerCare* f = sensors[i];
+        batch.add(f->addr().c_str(), 1700000000, f->reading());
+      }
+      sink += batch.length();
+    });
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    delete sensors[i];
+  }
+}
+
+// alert status of a 500 sensor fleet: check*() per sensor against one
+// evaluateAll() pass over the struct-of-arrays readings
+static void benchEvaluate() {
+  const size_t n = 500;
+  FlowerCareSim sim;
+  FlowerCareFleet fleet(1, simTransport, &sim);
+  FlowerCareReadings readings;
+
+  for (size_t i = 0; i < n; i++) {
+    std::string addr = sensorAddr(i);
+    sim.setData(addr, 5 + i % 30, i % 70, (int)(i * 997 % 60000),
+                (int)(i * 37 % 1000));
+    FlowerCare* f = new FlowerCare(addr, (Plant)(i % PLANT_COUNT));
+    f->setSettleTime(0);
+    fleet.add(f);
+  }
+  fleet.sweep();
+  fleet.collect(&readings);
+
+  bench("evaluate/500/check", 200, 10, [&](size_t) {
+    for (size_t i = 0; i < n; i++) {
+      FlowerCare* f = fleet.sensor(i);
+      sink += f->checkTemp() | f->checkMoist() | f->checkLight() |
+              f->checkFert();
+    }
+  });
+
+  bench("evaluate/500/soa", 200, 10, [&](size_t) {
+    readings.evaluateAll();
+    sink += readings.alerts(0);
+  });
+}
+
+// time series: append rate and encoded size of a realistic day cycle, one
+// sample every 10 minutes
+static FlowerCareReading_t daySample(size_t i) {
+  size_t minute = (i * 10) % 1440;
+  size_t noon = minute > 720 ? minute - 720 : 720 - minute;
+  FlowerCareReading_t r;
+
+  r.temp = (int16_t)(180 + (720 - noon) / 12 + i % 3);
+  r.moist = (uint8_t)(45 - (i / 144) % 10);
+  r.light = noon < 360 ? (uint32_t)(360 - noon) * 50 + i % 17 : 0;
+  r.fert = (uint16_t)(420 - (i / 288) % 20);
+  return r;
+}
+
+static void benchSeries() {
+  FlowerCareSeries series(64 * 1024, FC_SERIES_BLOCK);
+  bench("series/append", 200, 1000, [&](size_t i) {
+    series.append((uint32_t)(i * 600), daySample(i));
+  });
+
+  // 7 days in the default 4 KB ring
+  FlowerCareSeries week;
+  for (size_t i = 0; i < 7 * 144; i++) {
+    week.append((uint32_t)(i * 600), daySample(i));
+  }
+  if (selected("series/size")) {
+    printf("%-28s %12.2f bytes/sample, %zu of %d samples kept in %d bytes\n",
+           "series/size", (double)week.bytes() / week.size(), week.size(),
+           7 * 144, FC_SERIES_SIZE);
+  }
+
+  FlowerCareSample_t s;
+  bench("series/scan", 200, 10, [&](size_t) {
+    FlowerCareSeries::Iterator it = week.scan();
+    while (it.next(&s)) {
+      sink += s.reading.light;
+    }
+  });
+}
+
+// hour/day/week windows of the 4 metrics, one reading per minute
+static void benchRolling() {
+  FlowerCareRolling rolling;
+  bench("rolling/add", 200, 1000, [&](size_t i) {
+    rolling.add((uint32_t)(i * 60), daySample(i));
+  });
+
+  FlowerCareAgg_t agg;
+  bench("rolling/get", 200, 1000, [&](size_t i) {
+    sink += rolling.get(FIELD_LIGHT, (uint8_t)(i % 3), 200 * 1000 * 60, &agg);
+  });
+}
+
+// lookups in a plant database of 5000 species
+static void benchPlantDB() {
+  std::vector<FlowerCarePlantEntry_t> plants;
+  for (size_t i = 0; i < 5000; i++) {
+    char name[32];
+    snprintf(name, sizeof(name), "Species %05zu", i * 7919 % 100000);
+    FlowerCarePlantEntry_t p = {name, FlowerCarePlants::table[i % PLANT_COUNT]};
+    plants.push_back(p);
+  }
+
+  std::vector<uint8_t> buf;
+  FlowerCarePlantDB db;
+  if (!fcPlantDBBuild(plants, &buf, NULL) || !db.open(buf.data(), buf.size())) {
+    printf("plantdb: build failed\n");
+    return;
+  }
+
+  PlantVal_t val;
+  bench("plantdb/find", 200, 10000, [&](size_t i) {
+    sink += db.find(plants[i % plants.size()].name.c_str(), &val);
+  });
+
+  size_t first;
+  bench("plantdb/search", 200, 10000, [&](size_t i) {
+    char prefix[16];
+    snprintf(prefix, sizeof(prefix), "species %zu", i % 10);
+    sink += db.search(prefix, &first);
+  });
+}
+
+// the ring between acquisition and processing: same thread, then with the
+// consumer on another thread and the producer waiting when the ring is full
+static void benchQueue() {
+  FlowerCareQueue queue(FC_QUEUE_DEPTH);
+  FlowerCareItem_t item = {};
+
+  bench("queue/push+pop", 200, 10000, [&](size_t i) {
+    item.time = (uint32_t)i;
+    queue.push(item);
+    sink += queue.pop(&item);
+  });
+
+  std::atomic<bool> stop(false);
+  std::atomic<uint64_t> consumed(0);
+  std::thread consumer([&] {
+    FlowerCareItem_t it;
+    uint64_t n = 0;
+    while (!stop || queue.depth() > 0) {
+      if (queue.pop(&it)) {
+        n++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    consumed = n;
+  });
+
+  queue.resetStats();
+  bench("queue/spsc", 100, 1000, [&](size_t i) {
+    item.time = (uint32_t)i;
+    while (!queue.push(item)) {
+      std::this_thread::yield();
+    }
+  });
+  stop = true;
+  consumer.join();
+
+  FlowerCareQueueStats_t st;
+  queue.stats(&st);
+  if (selected("queue/spsc")) {
+    printf("%-28s %12u pushed, %llu consumed, max depth %u, %u full\n",
+           "queue/spsc", st.pushed, (unsigned long long)consumed.load(),
+           st.maxDepth, st.dropped);
+  }
+}
+
+// sweeps of virtual fleets. Zero latency measures the library overhead, with
+// a 10 ms connection latency the sweep time must scale with N / connections
+static void benchFleet() {
+  const size_t sizes[] = {10, 100, 1000};
+
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    for (uint8_t conn = 1; conn <= 3; conn += 2) {
+      FlowerCareSim sim;
+      FlowerCareFleet fleet(conn, simTransport, &sim);
+
+      for (size_t i = 0; i < sizes[s]; i++) {
+        std::string addr = sensorAddr(i);
+        sim.addSensor(addr);
+        FlowerCare* f = new FlowerCare(addr, FICUS);
+        f->setSettleTime(0);
+        fleet.add(f);
+      }
+
+      std::vector<FlowerCareFleetResult_t> results(sizes[s]);
+      char name[32];
+      snprintf(name, sizeof(name), "fleet/%zu/conn%u", sizes[s], conn);
+      bench(name, 20, 1, [&](size_t) { sink += fleet.sweep(results.data()); });
+
+      if (sizes[s] == 10) {
+        sim.config.connect_ms = 10;
+        snprintf(name, sizeof(name), "fleet/%zu/conn%u/10ms", sizes[s], conn);
+        bench(name, 5, 1, [&](size_t) { sink += fleet.sweep(results.data()); });
+      }
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    filter = argv[1];
+  }
+
+  printf("sizeof FlowerCare %zu, FlowerCareData_t %zu, "
+         "FlowerCareReading_t %zu\n",
+         sizeof(FlowerCare), sizeof(FlowerCareData_t),
+         sizeof(FlowerCareReading_t));
+
+  benchGetData();
+  benchHandleCache();
+  benchDecode();
+  benchCheckFormat();
+  benchEvaluate();
+  benchSeries();
+  benchRolling();
+  benchPlantDB();
+  benchQueue();
+  benchFleet();
+
+  return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef FLOWERCARE_ALLOCS_H
+#define FLOWERCARE_ALLOCS_H
+
+/* Heap allocation counter of the host harnesses (benchmark, fuzz): replaces
+ * the global operator new/delete, every allocation increments allocs.
+ * Include it in exactly one translation unit of the program
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> allocs(0);
+
+// not inlined, so the compiler does not pair malloc() with delete
+__attribute__((noinline)) void* operator new(size_t size) {
+  allocs.fetch_add(1, std::memory_order_relaxed);
+  void* p = malloc(size ? size : 1);
+  if (p == NULL) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+__attribute__((noinline)) void* operator new[](size_t size) {
+  return operator new(size);
+}
+__attribute__((noinline)) void operator delete(void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete[](void* p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+__attribute__((noinline)) void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+#endif
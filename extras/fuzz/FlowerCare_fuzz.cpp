@@ -0,0 +1,187 @@
+/*******************************************************************************
+ * Fuzz harness of the decoders: fcDecode() and the decoder of every protocol
+ * driver (0x1a01 value) and fcParseAdv() (MiBeacon frames). Every input is
+ * checked against a reference decoder and the decoders must not allocate nor
+ * read past the given length
+ *
+ * Standalone, random and mutated inputs, from the repository root:
+ *   g++ -std=c++11 -O1 -g -fsanitize=address,undefined -Isrc \
+ *       extras/fuzz/FlowerCare_fuzz.cpp src/FlowerCare_Decode.cpp \
+ *       src/FlowerCare_Driver.cpp src/FlowerCare_Adv.cpp -o fc_fuzz
+ *   ./fc_fuzz [iterations] [seed]
+ *
+ * With libFuzzer:
+ *   clang++ -std=c++11 -g -DFC_LIBFUZZER -fsanitize=fuzzer,address -Isrc \
+ *       extras/fuzz/FlowerCare_fuzz.cpp src/FlowerCare_Decode.cpp \
+ *       src/FlowerCare_Driver.cpp src/FlowerCare_Adv.cpp -o fc_fuzz
+ ******************************************************************************/
+#include <FlowerCare_Adv.h>
+#include <FlowerCare_Decode.h>
+#include <FlowerCare_Driver.h>
+#include "../common/FlowerCare_allocs.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+/*******************************************************************************
+ *                                  CHECKS
+ ******************************************************************************/
+
+static void fail(const char* what, const uint8_t* data, size_t len) {
+  fprintf(stderr, "FAIL %s, input:", what);
+  for (size_t i = 0; i < len; i++) {
+    fprintf(stderr, " %02x", data[i]);
+  }
+  fprintf(stderr, "\n");
+  abort();
+}
+
+// straightforward decoding of the 0x1a01 value, byte by byte
+static bool refDecode(const uint8_t* buf, size_t len, int64_t out[4]) {
+  if (len < 10 || (buf[0] == 0xaa && buf[1] == 0xbb && buf[2] == 0xcc)) {
+    return false;
+  }
+
+  int64_t temp = buf[0] + buf[1] * 256;
+  out[0] = temp >= 32768 ? temp - 65536 : temp;
+  out[1] = buf[7];
+  out[2] = 0;
+  for (int i = 6; i >= 3; i--) {
+    out[2] = out[2] * 256 + buf[i];
+  }
+  out[3] = buf[8] + buf[9] * 256;
+
+  return true;
+}
+
+static void checkInput(const uint8_t* data, size_t len) {
+  // exact size copy, so ASan catches any read past len
+  std::vector<uint8_t> copy(data, data + len);
+  const uint8_t* buf = copy.empty() ? NULL : copy.data();
+
+  FlowerCareReading_t reading = {};
+  FlowerCareReading_t byDriver[DRIVER_COUNT] = {};
+  bool okDriver[DRIVER_COUNT];
+  FlowerCareAdv_t adv = {};
+  int64_t ref[4];
+
+  uint64_t before = allocs.load(std::memory_order_relaxed);
+  bool ok = fcDecode(buf, len, &reading);
+  for (uint8_t d = 0; d < DRIVER_COUNT; d++) {
+    okDriver[d] = fcDriver((FC_DRIVER_T)d)->decode(buf, len, &byDriver[d]);
+  }
+  fcParseAdv(buf, len, &adv);
+  if (allocs.load(std::memory_order_relaxed) != before) {
+    fail("decoder allocated", data, len);
+  }
+
+  bool refOk = refDecode(data, len, ref);
+  if (ok != refOk) {
+    fail("fcDecode() accepts a different set of inputs", data, len);
+  }
+
+  if (ok && (reading.temp != ref[0] || reading.moist != ref[1] ||
+             reading.light != ref[2] || reading.fert != ref[3])) {
+    fail("fcDecode() value differs from the reference", data, len);
+  }
+
+  // every known firmware shares the layout, see FlowerCareLayout
+  for (uint8_t d = 0; d < DRIVER_COUNT; d++) {
+    const FlowerCareReading_t& r = byDriver[d];
+    if (okDriver[d] != refOk) {
+      fail("a driver accepts a different set of inputs", data, len);
+    }
+    if (refOk && (r.temp != ref[0] || r.moist != ref[1] ||
+                  r.light != ref[2] || r.fert != ref[3])) {
+      fail("a driver value differs from the reference", data, len);
+    }
+  }
+}
+
+// encode, decode and compare a random reading
+static void checkRoundTrip(std::mt19937& rng) {
+  FlowerCareReading_t in;
+  in.temp = (int16_t)rng();
+  in.moist = (uint8_t)rng();
+  in.light = (uint32_t)rng();
+  in.fert = (uint16_t)rng();
+
+  uint8_t buf[SENSORDATA_LEN] = {};
+  buf[0] = (uint8_t)in.temp;
+  buf[1] = (uint8_t)((uint16_t)in.temp >> 8);
+  for (int i = 0; i < 4; i++) {
+    buf[3 + i] = (uint8_t)(in.light >> (8 * i));
+  }
+  buf[7] = in.moist;
+  buf[8] = (uint8_t)in.fert;
+  buf[9] = (uint8_t)(in.fert >> 8);
+
+  // the only rejected pattern that fits a valid encoding
+  if (buf[0] == 0xaa && buf[1] == 0xbb) {
+    return;
+  }
+
+  FlowerCareReading_t out;
+  if (!fcDecode(buf, sizeof(buf), &out) || out.temp != in.temp ||
+      out.moist != in.moist || out.light != in.light || out.fert != in.fert) {
+    fail("round trip", buf, sizeof(buf));
+  }
+}
+
+/*******************************************************************************
+ *                                   MAIN
+ ******************************************************************************/
+
+#ifdef FC_LIBFUZZER
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t len) {
+  checkInput(data, len);
+  return 0;
+}
+#else
+int main(int argc, char** argv) {
+  unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+  unsigned long seed = argc > 2 ? strtoul(argv[2], NULL, 10) : 1;
+  std::mt19937 rng(seed);
+
+  // seeds: a real value, the value before the mode write, MiBeacon frames
+  std::vector<std::vector<uint8_t>> corpus = {
+      {0xd7, 0x00, 0x00, 0x88, 0x13, 0x00, 0x00, 0x23, 0x90, 0x01, 0x02, 0x3c,
+       0x00, 0xfb, 0x34, 0x9b},
+      {0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x99, 0x88, 0x77, 0x66, 0x00, 0x00,
+       0x00, 0x00, 0x00, 0x00},
+  };
+  const uint16_t objects[] = {ADV_TEMP, ADV_LIGHT, ADV_MOIST, ADV_FERT,
+                              ADV_BATTERY};
+  for (size_t i = 0; i < sizeof(objects) / sizeof(objects[0]); i++) {
+    FlowerCareAdv_t adv = {MIBEACON_FLOWERCARE, 1, objects[i], 1234};
+    std::vector<uint8_t> frame(32);
+    frame.resize(fcBuildAdv(&adv, frame.data(), frame.size()));
+    corpus.push_back(frame);
+  }
+
+  std::vector<uint8_t> input;
+  for (unsigned long n = 0; n < iterations; n++) {
+    if (n & 1) {
+      // mutate a corpus entry: flip bytes, then truncate or extend
+      input = corpus[rng() % corpus.size()];
+      for (unsigned m = rng() % 4; m > 0 && !input.empty(); m--) {
+        input[rng() % input.size()] = (uint8_t)rng();
+      }
+      input.resize(rng() % 24, (uint8_t)rng());
+    } else {
+      input.resize(rng() % 24);
+      for (size_t i = 0; i < input.size(); i++) {
+        input[i] = (uint8_t)rng();
+      }
+    }
+
+    checkInput(input.data(), input.size());
+    checkRoundTrip(rng);
+  }
+
+  printf("OK, %lu inputs\n", iterations);
+  return 0;
+}
+#endif
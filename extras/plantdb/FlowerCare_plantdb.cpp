@@ -0,0 +1,369 @@
+/*******************************************************************************
+ * Host tool of the plant database (FlowerCare_PlantDB.h)
+ *
+ *   fc_plantdb build <plants.csv|plants.json> <plants.fcdb>
+ *   fc_plantdb list <plants.fcdb> [prefix]
+ *   fc_plantdb export          built-in plants of Plants.h as CSV
+ *
+ * CSV, one plant per line, '#' comments, optional header line:
+ *   name,temp_min,temp_max,moist_min,moist_max,light_min,light_max,
+ *   fert_min,fert_max[,dli_min,dli_max]
+ * Without DLI (mol/m^2/day) the targets are derived from the light bounds
+ * Names holding commas or quotes are written in double quotes, "" is a quote
+ *
+ * JSON, an array of objects with the same keys, dli_* optional:
+ *   [{"name": "Ficus benjamina", "temp_min": 10, "temp_max": 24, ...}]
+ *
+ * Build from the repository root:
+ *   g++ -std=c++11 -O2 -Isrc extras/plantdb/FlowerCare_plantdb.cpp \
+ *       src/FlowerCare_PlantDB.cpp src/FlowerCare_Profile.cpp -o fc_plantdb
+ *
+ * On ESP32 the .fcdb file is written to a data partition, e.g.
+ *   parttool.py write_partition --partition-name plants --input plants.fcdb
+ * and opened with FlowerCarePlantDB::openPartition("plants")
+ ******************************************************************************/
+#include <FlowerCare_PlantDB.h>
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const char* fields[] = {"temp_min",  "temp_max",  "moist_min",
+                               "moist_max", "light_min", "light_max",
+                               "fert_min",  "fert_max",  "dli_min",
+                               "dli_max"};
+static const size_t fieldCount = sizeof(fields) / sizeof(fields[0]);
+// fields that must be given, the DLI ones are optional
+static const size_t requiredCount = 8;
+
+/*******************************************************************************
+ *                                  INPUT
+ ******************************************************************************/
+
+// set a field of PlantVal_t by index in fields[]
+static void setField(PlantVal_t* v, size_t i, double val) {
+  switch (i) {
+    case 0: v->temp_min = (float)val; break;
+    case 1: v->temp_max = (float)val; break;
+    case 2: v->moist_min = (int)val; break;
+    case 3: v->moist_max = (int)val; break;
+    case 4: v->light_min = (int)val; break;
+    case 5: v->light_max = (int)val; break;
+    case 6: v->fert_min = (int)val; break;
+    case 7: v->fert_max = (int)val; break;
+    case 8: v->dli_min = (float)val; break;
+    case 9: v->dli_max = (float)val; break;
+  }
+}
+
+// DLI targets held by the light bounds, when not given
+static void defaultDli(PlantVal_t* v) {
+  v->dli_min = fcLuxToDli(v->light_min);
+  v->dli_max = fcLuxToDli(v->light_max);
+}
+
+static bool toNumber(const std::string& str, double* val) {
+  char* end;
+  *val = strtod(str.c_str(), &end);
+  return !str.empty() && *end == '\0';
+}
+
+// split a CSV line, handling quoted fields
+static std::vector<std::string> splitCsv(const std::string& line) {
+  std::vector<std::string> cols(1);
+  bool quoted = false;
+
+  for (size_t i = 0; i < line.size(); i++) {
+    char c = line[i];
+    if (quoted) {
+      if (c == '"' && i + 1 < line.size() && line[i + 1] == '"') {
+        cols.back() += '"';
+        i++;
+      } else if (c == '"') {
+        quoted = false;
+      } else {
+        cols.back() += c;
+      }
+    } else if (c == '"') {
+      quoted = true;
+    } else if (c == ',') {
+      cols.push_back("");
+    } else if (c != '\r') {
+      cols.back() += c;
+    }
+  }
+
+  // trim spaces around unquoted values
+  for (size_t i = 0; i < cols.size(); i++) {
+    size_t a = cols[i].find_first_not_of(" \t");
+    size_t b = cols[i].find_last_not_of(" \t");
+    cols[i] = a == std::string::npos ? "" : cols[i].substr(a, b - a + 1);
+  }
+
+  return cols;
+}
+
+static bool readCsv(std::istream& in,
+                    std::vector<FlowerCarePlantEntry_t>* out) {
+  std::string line;
+  size_t lineNo = 0;
+
+  while (std::getline(in, line)) {
+    lineNo++;
+    std::vector<std::string> cols = splitCsv(line);
+
+    if (line.find_first_not_of(" \t\r") == std::string::npos ||
+        cols[0][0] == '#' || (lineNo == 1 && cols[0] == "name")) {
+      continue;
+    }
+
+    FlowerCarePlantEntry_t p = {cols[0], {}};
+    size_t n = cols.size() - 1;
+    bool ok = n == requiredCount || n == fieldCount;
+
+    for (size_t i = 0; ok && i < n; i++) {
+      double val;
+      ok = toNumber(cols[i + 1], &val);
+      setField(&p.val, i, val);
+    }
+    if (n == requiredCount) {
+      defaultDli(&p.val);
+    }
+
+    if (!ok) {
+      fprintf(stderr, "line %zu: expected name and %zu or %zu numbers\n",
+              lineNo, requiredCount, fieldCount);
+      return false;
+    }
+    out->push_back(p);
+  }
+
+  return true;
+}
+
+/**
+ * @brief Minimal JSON reader, only what a plant list needs: an array of flat
+ * objects holding strings and numbers
+ *
+ */
+class JsonReader {
+ public:
+  JsonReader(const std::string& text) : _s(text), _pos(0) {}
+
+  bool read(std::vector<FlowerCarePlantEntry_t>* out) {
+    if (!expect('[')) return false;
+    if (peek() == ']') return expect(']') && end();
+
+    do {
+      FlowerCarePlantEntry_t p = {"", {}};
+      if (!readObject(&p)) return false;
+      out->push_back(p);
+    } while (peek() == ',' && expect(','));
+
+    return expect(']') && end();
+  }
+
+  size_t pos() { return _pos; }
+
+ private:
+  const std::string& _s;
+  size_t _pos;
+
+  char peek() {
+    while (_pos < _s.size() && isspace((unsigned char)_s[_pos])) _pos++;
+    return _pos < _s.size() ? _s[_pos] : '\0';
+  }
+
+  bool expect(char c) {
+    if (peek() != c) return false;
+    _pos++;
+    return true;
+  }
+
+  bool end() { return peek() == '\0'; }
+
+  bool readString(std::string* str) {
+    if (!expect('"')) return false;
+    str->clear();
+    while (_pos < _s.size() && _s[_pos] != '"') {
+      char c = _s[_pos++];
+      if (c == '\\' && _pos < _s.size()) {
+        c = _s[_pos++];
+        if (c == 'n') c = '\n';
+        if (c == 't') c = '\t';
+        if (c == 'u') return false;  // not needed for names
+      }
+      *str += c;
+    }
+    return expect('"');
+  }
+
+  bool readNumber(double* val) {
+    peek();
+    const char* start = _s.c_str() + _pos;
+    char* end;
+    *val = strtod(start, &end);
+    _pos += end - start;
+    return end != start;
+  }
+
+  bool readObject(FlowerCarePlantEntry_t* p) {
+    unsigned seen = 0;
+
+    if (!expect('{')) return false;
+    do {
+      std::string key;
+      if (!readString(&key) || !expect(':')) return false;
+
+      if (key == "name") {
+        if (!readString(&p->name)) return false;
+        seen |= 1;
+        continue;
+      }
+
+      double val;
+      size_t i = 0;
+      while (i < fieldCount && key != fields[i]) i++;
+      if (i == fieldCount || !readNumber(&val)) return false;
+      setField(&p->val, i, val);
+      seen |= 2u << i;
+    } while (peek() == ',' && expect(','));
+
+    // DLI targets not given are derived from the light bounds
+    PlantVal_t v = p->val;
+    defaultDli(&v);
+    if (!(seen & (2u << 8))) p->val.dli_min = v.dli_min;
+    if (!(seen & (2u << 9))) p->val.dli_max = v.dli_max;
+
+    // name and every required field
+    unsigned required = (2u << requiredCount) - 1;
+    return expect('}') && (seen & required) == required;
+  }
+};
+
+/*******************************************************************************
+ *                                 COMMANDS
+ ******************************************************************************/
+
+static int build(const char* inPath, const char* outPath) {
+  std::ifstream in(inPath, std::ios::binary);
+  if (!in) {
+    fprintf(stderr, "cannot open %s\n", inPath);
+    return 1;
+  }
+
+  std::vector<FlowerCarePlantEntry_t> plants;
+  std::string path(inPath);
+  bool ok;
+
+  if (path.size() > 5 && path.compare(path.size() - 5, 5, ".json") == 0) {
+    std::stringstream text;
+    text << in.rdbuf();
+    std::string str = text.str();
+    JsonReader json(str);
+    ok = json.read(&plants);
+    if (!ok) {
+      fprintf(stderr, "%s: invalid plant list near offset %zu\n", inPath,
+              json.pos());
+    }
+  } else {
+    ok = readCsv(in, &plants);
+  }
+
+  std::vector<uint8_t> db;
+  std::string err;
+  if (!ok) {
+    return 1;
+  }
+  if (!fcPlantDBBuild(plants, &db, &err)) {
+    fprintf(stderr, "%s: %s\n", inPath, err.c_str());
+    return 1;
+  }
+
+  FILE* f = fopen(outPath, "wb");
+  if (f == NULL || fwrite(db.data(), 1, db.size(), f) != db.size() ||
+      fclose(f) != 0) {
+    fprintf(stderr, "cannot write %s\n", outPath);
+    return 1;
+  }
+
+  printf("%zu plants, %zu bytes\n", plants.size(), db.size());
+  return 0;
+}
+
+static void printPlant(const char* name, const PlantVal_t& v) {
+  bool quote = strpbrk(name, ",\"") != NULL;
+
+  if (quote) {
+    putchar('"');
+    for (const char* c = name; *c; c++) {
+      if (*c == '"') putchar('"');
+      putchar(*c);
+    }
+    putchar('"');
+  } else {
+    fputs(name, stdout);
+  }
+  printf(",%g,%g,%d,%d,%d,%d,%d,%d,%g,%g\n", v.temp_min, v.temp_max,
+         v.moist_min, v.moist_max, v.light_min, v.light_max, v.fert_min,
+         v.fert_max, v.dli_min, v.dli_max);
+}
+
+static int list(const char* path, const char* prefix) {
+  FlowerCarePlantDB db;
+  if (!db.openFile(path)) {
+    fprintf(stderr, "%s is not a valid plant database\n", path);
+    return 1;
+  }
+
+  size_t first;
+  size_t n = db.search(prefix, &first);
+  for (size_t i = first; i < first + n; i++) {
+    PlantVal_t v;
+    db.get(i, &v);
+    printPlant(db.name(i), v);
+  }
+
+  return 0;
+}
+
+#define PLANT_NAME(name) #name,
+
+static int exportBuiltin() {
+  static const char* names[] = {"FICUS_GINSEGN", PLANT_LIST(PLANT_NAME)};
+
+  printf("name");
+  for (size_t i = 0; i < fieldCount; i++) {
+    printf(",%s", fields[i]);
+  }
+  printf("\n");
+
+  for (size_t i = 0; i < PLANT_COUNT; i++) {
+    printPlant(names[i], FlowerCarePlants::table[i]);
+  }
+
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  std::string cmd = argc > 1 ? argv[1] : "";
+
+  if (cmd == "build" && argc == 4) {
+    return build(argv[2], argv[3]);
+  } else if (cmd == "list" && (argc == 3 || argc == 4)) {
+    return list(argv[2], argc == 4 ? argv[3] : "");
+  } else if (cmd == "export" && argc == 2) {
+    return exportBuiltin();
+  }
+
+  fprintf(stderr,
+          "usage: %s build <plants.csv|plants.json> <plants.fcdb>\n"
+          "       %s list <plants.fcdb> [prefix]\n"
+          "       %s export\n",
+          argv[0], argv[0], argv[0]);
+  return 2;
+}
@@ -0,0 +1,121 @@
+#include "FlowerCare_Adv.h"
+
+/**
+ * @brief Parse the 0xFE95 service data of an advertisement
+ *
+ * @param data service data
+ * @param len  length of data
+ * @param adv  where to store the frame content
+ * @return true if data holds a clear text object
+ */
+bool fcParseAdv(const uint8_t* data, size_t len, FlowerCareAdv_t* adv) {
+  // frame control, product id, frame counter
+  if (len < 5) {
+    return false;
+  }
+
+  uint16_t frameCtrl = data[0] | data[1] << 8;
+  size_t pos = 5;
+
+  if ((frameCtrl & MIBEACON_FC_ENCRYPTED) ||
+      !(frameCtrl & MIBEACON_FC_OBJECT)) {
+    return false;
+  }
+
+  adv->product = data[2] | data[3] << 8;
+  adv->counter = data[4];
+
+  if (frameCtrl & MIBEACON_FC_MAC) {
+    pos += 6;
+  }
+
+  if (frameCtrl & MIBEACON_FC_CAPABILITY) {
+    // IO capability follows when bit 5 of the capability is set
+    if (pos < len && (data[pos] & 0x20)) {
+      pos += 2;
+    }
+    pos++;
+  }
+
+  // object id, object length, object value
+  if (pos + 3 > len || pos + 3 + data[pos + 2] > len) {
+    return false;
+  }
+
+  adv->object = data[pos] | data[pos + 1] << 8;
+  uint8_t objLen = data[pos + 2];
+  const uint8_t* val = data + pos + 3;
+
+  switch (adv->object) {
+    case ADV_TEMP:
+      if (objLen < 2) return false;
+      adv->value = (int16_t)(val[0] | val[1] << 8);
+      return true;
+
+    case ADV_LIGHT:
+      if (objLen < 3) return false;
+      adv->value = val[0] | val[1] << 8 | (int32_t)val[2] << 16;
+      return true;
+
+    case ADV_MOIST:
+    case ADV_BATTERY:
+      if (objLen < 1) return false;
+      adv->value = val[0];
+      return true;
+
+    case ADV_FERT:
+      if (objLen < 2) return false;
+      adv->value = val[0] | val[1] << 8;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief Build the service data of a clear text MiBeacon frame, the inverse
+ * of fcParseAdv(). Used by the simulation
+ *
+ * @param adv the frame content
+ * @param buf where to store the service data
+ * @param len size of buf
+ * @return the length of the service data, 0 if buf is too small
+ */
+size_t fcBuildAdv(const FlowerCareAdv_t* adv, uint8_t* buf, size_t len) {
+  uint8_t objLen;
+
+  switch (adv->object) {
+    case ADV_TEMP:
+    case ADV_FERT:
+      objLen = 2;
+      break;
+    case ADV_LIGHT:
+      objLen = 3;
+      break;
+    default:
+      objLen = 1;
+      break;
+  }
+
+  if (len < 8u + objLen) {
+    return 0;
+  }
+
+  // version 2, object included
+  uint16_t frameCtrl = 0x2000 | MIBEACON_FC_OBJECT;
+
+  buf[0] = (uint8_t)frameCtrl;
+  buf[1] = (uint8_t)(frameCtrl >> 8);
+  buf[2] = (uint8_t)adv->product;
+  buf[3] = (uint8_t)(adv->product >> 8);
+  buf[4] = adv->counter;
+  buf[5] = (uint8_t)adv->object;
+  buf[6] = (uint8_t)(adv->object >> 8);
+  buf[7] = objLen;
+  for (uint8_t i = 0; i < objLen; i++) {
+    buf[8 + i] = (uint8_t)((uint32_t)adv->value >> (8 * i));
+  }
+
+  return 8u + objLen;
+}
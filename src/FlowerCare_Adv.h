@@ -0,0 +1,60 @@
+#ifndef FLOWERCARE_ADV_H
+#define FLOWERCARE_ADV_H
+
+/* Flower Care sensors broadcast their readings in MiBeacon frames, carried as
+ * service data of UUID 0xFE95. Every frame holds a single object (one metric)
+ * so a full reading needs several advertisements
+ */
+
+#include "FlowerCare_Defs.h"
+
+// service data UUID of MiBeacon frames
+#define MIBEACON_UUID16 0xFE95
+// product id of the Flower Care (HHCCJCY01)
+#define MIBEACON_FLOWERCARE 0x0098
+
+// MiBeacon frame control bits
+#define MIBEACON_FC_ENCRYPTED 0x0008
+#define MIBEACON_FC_MAC 0x0010
+#define MIBEACON_FC_CAPABILITY 0x0020
+#define MIBEACON_FC_OBJECT 0x0040
+
+/**
+ * @brief MiBeacon object ids sent by the Flower Care
+ *
+ */
+enum FC_ADV_OBJ_T {
+  ADV_TEMP = 0x1004,     // int16, 0.1 °C
+  ADV_LIGHT = 0x1007,    // uint24, lux
+  ADV_MOIST = 0x1008,    // uint8, %
+  ADV_FERT = 0x1009,     // uint16, us/cm
+  ADV_BATTERY = 0x100A,  // uint8, %
+};
+
+/**
+ * @brief Fields of FlowerCareData_t, used as bit mask
+ *
+ */
+enum FC_FIELD_T {
+  FIELD_TEMP = 0x01,
+  FIELD_MOIST = 0x02,
+  FIELD_LIGHT = 0x04,
+  FIELD_FERT = 0x08,
+  FIELD_ALL = 0x0F,
+};
+
+/**
+ * @brief Content of a MiBeacon frame
+ *
+ */
+typedef struct FlowerCareAdv {
+  uint16_t product; /**< Product id, MIBEACON_FLOWERCARE */
+  uint8_t counter;  /**< Frame counter, repeated frames have the same one */
+  uint16_t object;  /**< Object id, see FC_ADV_OBJ_T */
+  int32_t value;    /**< Object value, unit given by FC_ADV_OBJ_T */
+} FlowerCareAdv_t;
+
+bool fcParseAdv(const uint8_t*, size_t, FlowerCareAdv_t*);
+size_t fcBuildAdv(const FlowerCareAdv_t*, uint8_t*, size_t);
+
+#endif
@@ -0,0 +1,252 @@
+#include "FlowerCare_Alert.h"
+
+/* FlowerCareAlertMetric_t::flags, states coded on 2 bits: 0 in range,
+ * 1 below min, 2 above max
+ */
+#define ALERT_STATE_SHIFT 0
+#define ALERT_NOTIFIED_SHIFT 2
+#define ALERT_CANDIDATE_SHIFT 4
+#define ALERT_SENT 0x40
+
+static uint8_t getCode(uint8_t flags, int shift) {
+  return (flags >> shift) & 0x03;
+}
+
+static uint8_t setCode(uint8_t flags, int shift, uint8_t code) {
+  return (uint8_t)((flags & ~(0x03 << shift)) | code << shift);
+}
+
+static int toState(uint8_t code) { return code == 1 ? -1 : code == 2; }
+
+static uint8_t toCode(int state) { return state < 0 ? 1 : state > 0 ? 2 : 0; }
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ * @param sensors  number of sensors
+ * @param debounce consecutive samples needed to change state
+ * @param renotify min interval between two notifications of a metric, in s
+ */
+FlowerCareAlerts::FlowerCareAlerts(size_t sensors, uint8_t debounce,
+                                   uint32_t renotify) {
+  _hyst[0] = FC_ALERT_HYST_TEMP;
+  _hyst[1] = FC_ALERT_HYST_MOIST;
+  _hyst[2] = FC_ALERT_HYST_LIGHT;
+  _hyst[3] = FC_ALERT_HYST_FERT;
+  _cb = NULL;
+  _cbArg = NULL;
+
+  setDebounce(debounce);
+  setRenotify(renotify);
+  resize(sensors);
+}
+
+/**
+ * @brief Set the function called on every notified state change
+ *
+ * @param cb  the callback, NULL to stop
+ * @param arg argument passed to cb
+ */
+void FlowerCareAlerts::setCallback(FC_ALERT_CB_T cb, void* arg) {
+  _cb = cb;
+  _cbArg = arg;
+}
+
+/**
+ * @brief Set the hysteresis band of a metric
+ *
+ * @param field the metric, a single FC_FIELD_T
+ * @param band  distance to the bound needed to leave an alert, in the unit of
+ *              the metric (°C for the temperature)
+ */
+void FlowerCareAlerts::setHysteresis(FC_FIELD_T field, float band) {
+  for (uint8_t m = 0; m < 4; m++) {
+    if (field == 1 << m) {
+      _hyst[m] = band;
+    }
+  }
+}
+
+/**
+ * @brief Set the number of consecutive samples needed to change state
+ *
+ * @param debounce 1 accepts every change at once
+ */
+void FlowerCareAlerts::setDebounce(uint8_t debounce) {
+  _debounce = debounce > 0 ? debounce : 1;
+}
+
+/**
+ * @brief Set the min interval between two notifications of a metric
+ *
+ * @param renotify the interval in s, 0 notifies every change
+ */
+void FlowerCareAlerts::setRenotify(uint32_t renotify) { _renotify = renotify; }
+
+/**
+ * @brief Set the number of sensors, new ones start in range
+ *
+ * @param sensors number of sensors
+ */
+void FlowerCareAlerts::resize(size_t sensors) {
+  _states.resize(sensors, FlowerCareAlertState_t());
+}
+
+/**
+ * @brief Get the number of sensors
+ *
+ */
+size_t FlowerCareAlerts::size() { return _states.size(); }
+
+/**
+ * @brief Forget the state of a sensor, e.g. when its plant changes
+ *
+ * @param sensor index of the sensor
+ */
+void FlowerCareAlerts::reset(size_t sensor) {
+  if (sensor < _states.size()) {
+    _states[sensor] = FlowerCareAlertState_t();
+  }
+}
+
+/**
+ * @brief Evaluate a new reading of a sensor, calling the callback for every
+ * notified state change. Call it once per reading, debounce counts the calls
+ *
+ * @param sensor index of the sensor
+ * @param time   time of the reading in s
+ * @param data   the reading
+ * @param plant  the bounds
+ * @param fields FC_FIELD_T of the metrics to evaluate
+ * @return the number of notifications
+ */
+uint8_t FlowerCareAlerts::evaluate(size_t sensor, uint32_t time,
+                                   const FlowerCareData_t& data,
+                                   const PlantVal_t& plant, uint8_t fields) {
+  uint8_t n = 0;
+
+  if (sensor >= _states.size()) {
+    return 0;
+  }
+
+  if (fields & FIELD_TEMP) {
+    n += step(sensor, 0, time, data.temp, plant.temp_min, plant.temp_max);
+  }
+  if (fields & FIELD_MOIST) {
+    n += step(sensor, 1, time, (float)data.moist, (float)plant.moist_min,
+              (float)plant.moist_max);
+  }
+  if (fields & FIELD_LIGHT) {
+    n += step(sensor, 2, time, (float)data.light, (float)plant.light_min,
+              (float)plant.light_max);
+  }
+  if (fields & FIELD_FERT) {
+    n += step(sensor, 3, time, (float)data.fert, (float)plant.fert_min,
+              (float)plant.fert_max);
+  }
+
+  return n;
+}
+
+/**
+ * @brief Get the debounced state of a metric, as FlowerCare::checkTemp()
+ *
+ * @param sensor index of the sensor
+ * @param field  the metric, a single FC_FIELD_T
+ * @return 0 in range, 1 above max, -1 below min
+ */
+int FlowerCareAlerts::state(size_t sensor, FC_FIELD_T field) {
+  if (sensor >= _states.size()) {
+    return 0;
+  }
+
+  for (uint8_t m = 0; m < 4; m++) {
+    if (field == 1 << m) {
+      uint8_t flags = _states[sensor].metric[m].flags;
+      return toState(getCode(flags, ALERT_STATE_SHIFT));
+    }
+  }
+  return 0;
+}
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Evaluate a value of a metric
+ *
+ * @param sensor index of the sensor
+ * @param m      index of the metric
+ * @param time   time of the value in s
+ * @param value  the value
+ * @param min    lower bound
+ * @param max    upper bound
+ * @return true if a change was notified
+ */
+bool FlowerCareAlerts::step(size_t sensor, uint8_t m, uint32_t time,
+                            float value, float min, float max) {
+  FlowerCareAlertMetric_t& s = _states[sensor].metric[m];
+  uint8_t cur = getCode(s.flags, ALERT_STATE_SHIFT);
+  uint8_t raw = toCode(classify(toState(cur), value, min, max, _hyst[m]));
+
+  // debounce
+  if (raw == cur) {
+    s.count = 0;
+  } else {
+    if (s.count == 0 || getCode(s.flags, ALERT_CANDIDATE_SHIFT) != raw) {
+      s.flags = setCode(s.flags, ALERT_CANDIDATE_SHIFT, raw);
+      s.count = 0;
+    }
+    if (++s.count >= _debounce) {
+      s.flags = setCode(s.flags, ALERT_STATE_SHIFT, raw);
+      s.count = 0;
+      cur = raw;
+    }
+  }
+
+  // rate limit
+  uint8_t notified = getCode(s.flags, ALERT_NOTIFIED_SHIFT);
+
+  if (cur == notified ||
+      ((s.flags & ALERT_SENT) && time - s.notified < _renotify)) {
+    return false;
+  }
+
+  s.flags = setCode(s.flags, ALERT_NOTIFIED_SHIFT, cur) | ALERT_SENT;
+  s.notified = time;
+
+  if (_cb != NULL) {
+    FlowerCareAlertEvent_t ev = {(FC_FIELD_T)(1 << m),
+                                 (int8_t)toState(notified),
+                                 (int8_t)toState(cur), value, time};
+    _cb(sensor, &ev, _cbArg);
+  }
+  return true;
+}
+
+/**
+ * @brief Check a value against its bounds, with hysteresis
+ *
+ * @param state current state of the metric
+ * @param value the value
+ * @param min   lower bound
+ * @param max   upper bound
+ * @param band  hysteresis band
+ * @return 0 in range, 1 above max, -1 below min
+ */
+int FlowerCareAlerts::classify(int state, float value, float min, float max,
+                               float band) {
+  int raw = fcCheck(value, min, max);
+
+  if (raw == 0) {
+    // stay in the alert until back by the band
+    if (state < 0 && value < min + band) return -1;
+    if (state > 0 && value > max - band) return 1;
+  }
+  return raw;
+}
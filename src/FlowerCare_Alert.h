@@ -0,0 +1,96 @@
+#ifndef FLOWERCARE_ALERT_H
+#define FLOWERCARE_ALERT_H
+
+/* Alert engine on top of the check results (-1 below min, 0 in range, 1 above
+ * max). A metric enters an alert when it crosses a bound and leaves it only
+ * once it is back by the hysteresis band of the metric. A new state must be
+ * seen on debounce consecutive samples to be accepted, and a metric is not
+ * notified again before the re-notify interval: changes inside the interval
+ * are coalesced and the latest state is notified once it elapses (on the next
+ * evaluation). The state of a sensor is 32 bytes, see FlowerCareAlertState_t
+ */
+
+#include <vector>
+#include "FlowerCare_BLE.h"
+
+// default consecutive samples needed to change state
+#define FC_ALERT_DEBOUNCE 3
+// default min interval between two notifications of a metric, in s
+#define FC_ALERT_RENOTIFY 3600
+// default hysteresis bands
+#define FC_ALERT_HYST_TEMP 0.5f
+#define FC_ALERT_HYST_MOIST 2
+#define FC_ALERT_HYST_LIGHT 200
+#define FC_ALERT_HYST_FERT 20
+
+/**
+ * @brief State change of a metric, sent to FC_ALERT_CB_T
+ *
+ */
+typedef struct FlowerCareAlertEvent {
+  FC_FIELD_T field; /**< The metric */
+  int8_t from;      /**< Previously notified state, -1, 0 or 1 */
+  int8_t to;        /**< New state, -1, 0 or 1 */
+  float value;      /**< Value that confirmed the state, temperature in °C */
+  uint32_t time;    /**< Time of the evaluation in s */
+} FlowerCareAlertEvent_t;
+
+/**
+ * @brief Called on every notified state change
+ *
+ */
+typedef void (*FC_ALERT_CB_T)(size_t sensor, const FlowerCareAlertEvent_t* ev,
+                              void* arg);
+
+/**
+ * @brief Alert state of one metric of a sensor
+ *
+ */
+typedef struct FlowerCareAlertMetric {
+  uint8_t flags;     /**< State, notified state, candidate, see .cpp */
+  uint8_t count;     /**< Consecutive samples of the candidate */
+  uint32_t notified; /**< Time of the last notification in s */
+} FlowerCareAlertMetric_t;
+
+/**
+ * @brief Alert state of a sensor
+ *
+ */
+typedef struct FlowerCareAlertState {
+  FlowerCareAlertMetric_t metric[4]; /**< temp, moist, light, fert */
+} FlowerCareAlertState_t;
+
+/**
+ * @brief Debounced alerts of a set of sensors
+ *
+ */
+class FlowerCareAlerts {
+ public:
+  FlowerCareAlerts(size_t = 1, uint8_t = FC_ALERT_DEBOUNCE,
+                   uint32_t = FC_ALERT_RENOTIFY);
+
+  void setCallback(FC_ALERT_CB_T, void*);
+  void setHysteresis(FC_FIELD_T, float);
+  void setDebounce(uint8_t);
+  void setRenotify(uint32_t);
+  void resize(size_t);
+  size_t size();
+  void reset(size_t);
+
+  uint8_t evaluate(size_t, uint32_t, const FlowerCareData_t&,
+                   const PlantVal_t&, uint8_t = FIELD_ALL);
+  int state(size_t, FC_FIELD_T);
+
+ private:
+  std::vector<FlowerCareAlertState_t> _states; /**< One per sensor */
+  float _hyst[4];           /**< Hysteresis band per metric */
+  uint8_t _debounce;        /**< Consecutive samples to change state */
+  uint32_t _renotify;       /**< Min interval between notifications, s */
+  FC_ALERT_CB_T _cb;        /**< Notification callback or NULL */
+  void* _cbArg;             /**< Argument of _cb */
+
+  bool step(size_t, uint8_t, uint32_t, float, float, float);
+  static int classify(int, float, float, float, float);
+};
+
+#endif
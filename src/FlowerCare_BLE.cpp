@@ -1,8 +1,5 @@
 #include <FlowerCare_BLE.h>
 
-// TODO sequential call to getData() without resetting end with abort() before
-// row 72
-
 /*******************************************************************************
  *                                  PUBLIC
  ******************************************************************************/
@@ -10,30 +7,66 @@
 /**
  * @brief Constructor
  *
- * @param addr the BLE address of the FlowerCare sensor
+ * @param addr      the BLE address of the FlowerCare sensor
+ * @param transport link to the sensor. If NULL on ESP32 a BLE transport is
+ *                  created on the first reading, on host a transport must be
+ *                  given
  */
-FlowerCare::FlowerCare(std::string addr) {
-  _addr = new BLEAddress(addr);
-  _service_uuid = new BLEUUID(SERVICE_UUID);
-  _sensorData_uuid = new BLEUUID(SENSORDATA_UUID);
-  _writeMode_uuid = new BLEUUID(WRITEMODE_UUID);
-  _battVers_uuid = new BLEUUID(VERSIONBATTERY_UUID);
-
-  // initialize BLE and create client
-  BLEDevice::init("");  // better do once for all objects
+FlowerCare::FlowerCare(std::string addr, FlowerCareTransport* transport) {
+  _addr = addr;
+  _transport = transport;
+  _ownTransport = false;
+  _lentFrom = NULL;
+  _lentOwn = false;
+  _lent = false;
 
   // initialize structure for incoming data
   _data = {};
   _plant = {};
+  _seenMask = 0;
+
+  _session = false;
+  _hMode = 0;
+  _hData = 0;
+  _hInfo = 0;
+
+  _battery = 0;
+  _firmware[0] = '\0';
+  _infoTime = 0;
+  _infoValid = false;
+  _settleMs = FC_SETTLE_MS;
+  _driver = fcDriver((const char*)NULL);
+  _driverFixed = false;
+
+  _handleStore = NULL;
+  _handles = {};
+  _handlesLoaded = false;
+  _handlesUsed = false;
+
+  _state = STATE_IDLE;
+  _result = FLCARE_OK;
+  _stateTime = 0;
+  _retried = false;
+  _readCb = NULL;
+  _readCbArg = NULL;
+  _readStart = 0;
+
+  _stats = NULL;
+  _series = NULL;
+  _rolling = NULL;
+  memset(_phaseUs, 0, sizeof(_phaseUs));
 }
 
 /**
  * @brief Constructor
  *
- * @param addr the BLE address of the FlowerCare sensor
- * @param plant the plant type
+ * @param addr      the BLE address of the FlowerCare sensor
+ * @param plant     the plant type
+ * @param transport link to the sensor, see FlowerCare(std::string)
  */
-FlowerCare::FlowerCare(std::string addr, Plant plant) : FlowerCare(addr) {
+FlowerCare::FlowerCare(std::string addr, Plant plant,
+                       FlowerCareTransport* transport)
+    : FlowerCare(addr, transport) {
   // initialize plant maximun and minimum value
   initPlant(plant);
 }
@@ -46,92 +79,554 @@ FlowerCare::FlowerCare(std::string addr, Plant plant) : FlowerCare(addr) {
  * @param moist_L the moisture level of the plant
  * @param light_L the light level of the plant
  * @param fert_L  the EC level of the plant
+ * @param transport link to the sensor, see FlowerCare(std::string)
  */
 FlowerCare::FlowerCare(std::string addr, Level temp_L, Level moist_L,
-                       Level light_L, Level fert_L)
-    : FlowerCare(addr) {
+                       Level light_L, Level fert_L,
+                       FlowerCareTransport* transport)
+    : FlowerCare(addr, transport) {
   // init plant using level
   initLevel(temp_L, moist_L, light_L, fert_L);
 }
 
 /**
- * @brief Get data from the sensor and save them in memory
+ * @brief Constructor
+ *
+ * @param addr      the BLE address of the FlowerCare sensor
+ * @param plant     the plant values, e.g. FlowerCarePlants::table[FICUS]
+ * @param transport link to the sensor, see FlowerCare(std::string)
+ */
+FlowerCare::FlowerCare(std::string addr, const PlantVal_t& plant,
+                       FlowerCareTransport* transport)
+    : FlowerCare(addr, transport) {
+  _plant = plant;
+}
+
+/**
+ * @brief Destructor, release the transport if created by the object
  *
- * @return 0 on success, otherwise an error code is returned
  */
+FlowerCare::~FlowerCare() {
+  disconnect();
+  returnTransport();
+
+  if (_ownTransport) {
+    delete _transport;
+  }
+}
 
-// TODO solve all errors, also in FlowerCare::connect()
+/**
+ * @brief Get data from the sensor and save them in memory.
+ * In session mode the connection is kept open and reused, see setSession()
+ *
+ * @return 0 on success, otherwise an error code is returned
+ */
 FC_RET_T FlowerCare::getData(FlowerCareData_t* dataPtr) {
-  _BLEClient = BLEDevice::createClient();
+  FC_RET_T ret = fetch(false);
 
-  if (_BLEClient->connect(*_addr)) {
-    BLERemoteCharacteristic* pRemoteCharacteristic;
+  if (ret == FLCARE_OK && dataPtr != NULL) {
+    *dataPtr = _data;
+  }
 
-    // get FlowerCare service
-    BLERemoteService* pRemoteService = _BLEClient->getService(*_service_uuid);
+  return ret;
+}
 
-    if (pRemoteService == nullptr) {
-      return ERR_SERVICE;
-    }
+/**
+ * @brief Get data, battery and firmware in the same connection. Battery and
+ * firmware (0x1a02) are read only when older than infoMaxAge
+ *
+ * @param ext        where to copy data, battery and firmware, may be NULL
+ * @param infoMaxAge max age in ms of battery and firmware to skip reading them
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::getDataExt(FlowerCareDataExt_t* ext, uint32_t infoMaxAge) {
+  bool info = !_infoValid || millis() - _infoTime > infoMaxAge;
+  FC_RET_T ret = fetch(info);
+
+  if (ret == FLCARE_OK && ext != NULL) {
+    ext->data = _data;
+    ext->battery = _battery;
+    memcpy(ext->firmware, _firmware, sizeof(ext->firmware));
+  }
 
-    // write particular value to a characteristic to enable data reading
-    // TODO errors occour during this call to getCharacteristic(). In particular
-    // [E][BLERemoteCharacteristic.cpp:308] retrieveDescriptors():
-    //   esp_ble_gattc_get_all_descr: ESP_GATT_NOT_FOUND
-    // [E] [BLERemoteCharacteristic.cpp:315] retrieveDescriptors():
-    // [E] [BLERemoteCharacteristic.cpp:315] retrieveDescriptors():
-    pRemoteCharacteristic = pRemoteService->getCharacteristic(*_writeMode_uuid);
+  return ret;
+}
 
-    // 500 ms was fine
-    delay(500);
+/**
+ * @brief Get the last saved battery value
+ *
+ * @return the battery in %, -1 if never read
+ */
+int FlowerCare::battery() { return _infoValid ? _battery : -1; }
 
-    uint8_t buf[2] = {0xA0, 0x1F};
-    pRemoteCharacteristic->writeValue(buf, 2, true);
+/**
+ * @brief Get the last saved firmware version
+ *
+ * @return the firmware version, empty if never read
+ */
+const char* FlowerCare::firmware() { return _firmware; }
 
-    // add small delay if necessary
-    // delay(100);
+/**
+ * @brief Enable or disable session mode. In session mode the connection and
+ * the characteristic handles are kept across getData() calls and the mode
+ * command is written once per connection, so a reading costs one GATT read.
+ * The sensor does not advertise while connected
+ *
+ * @param enable true to keep the connection open, false closes it
+ */
+void FlowerCare::setSession(bool enable) {
+  _session = enable;
 
-    // get characteristic containing data
-    pRemoteCharacteristic =
-        pRemoteService->getCharacteristic(*_sensorData_uuid);
+  if (!enable) {
+    disconnect();
+  }
+}
 
-    if (pRemoteCharacteristic == nullptr) {
-      return ERR_CHARACT;
-    }
+/**
+ * @brief Set the wait between discovery and mode write
+ *
+ * @param ms wait in ms, FC_SETTLE_MS by default
+ */
+void FlowerCare::setSettleTime(uint32_t ms) { _settleMs = ms; }
 
-    // Read the value of the characteristic.
-    // TODO check if reading successful
-    std::string value = pRemoteCharacteristic->readValue();
+/**
+ * @brief Persist the attribute handles resolved on the first connection.
+ * The next connections, also after a reboot, write and read by handle and
+ * skip the discovery. The entry is dropped when the firmware changes or a
+ * cached handle fails, then the handles are discovered again
+ *
+ * @param store where the handles are kept under the sensor address, not
+ *              owned by the sensor. NULL to always discover
+ */
+void FlowerCare::setHandleCache(FlowerCareStore* store) {
+  _handleStore = store;
+  _handles = {};
+  _handlesLoaded = false;
+  _handlesUsed = false;
+}
 
-    const char* val = value.c_str();
+/**
+ * @brief Drop the cached handles, the next connection discovers them again
+ *
+ */
+void FlowerCare::clearHandles() {
+  // an entry not loaded yet may be in the store
+  bool saved = _handles.data != 0 || !_handlesLoaded;
+
+  _handles = {};
+  _handlesLoaded = true;
+  _handlesUsed = false;
+
+  if (_handleStore != NULL && saved) {
+    char key[FC_STORE_KEYLEN + 1];
+    fcStoreKey('g', _addr, key);
+    _handleStore->save(key, &_handles, sizeof(_handles));
+  }
+}
 
-    /*
-    // print HEX format of the data characteristic
-    Serial.print("Hex: ");
-    for (int i = 0; i < 16; i++) {
-      Serial.print((int)val[i], HEX);
-      Serial.print(" ");
-    }
-    Serial.println(" ");
-    */
+/**
+ * @brief Use a protocol driver whatever the firmware, see FlowerCare_Driver.h.
+ * By default the driver follows the firmware read with getDataExt()
+ *
+ * @param id the driver, DRIVER_COUNT to follow the firmware again
+ */
+void FlowerCare::setDriver(FC_DRIVER_T id) {
+  _driverFixed = id < DRIVER_COUNT;
+  _driver = _driverFixed ? fcDriver(id) : fcDriver(_firmware);
+}
+
+/**
+ * @brief Get the protocol driver in use
+ *
+ */
+const FlowerCareDriver_t* FlowerCare::driver() { return _driver; }
+
+/**
+ * @brief Start an asynchronous reading, driven by poll(). Every poll() call
+ * runs at most one step of the reading and the settle wait does not block,
+ * so one task can keep many readings in flight
+ *
+ * @param cb  called when the reading ends, may be NULL
+ * @param arg argument passed to cb
+ * @return false if a reading is already in flight
+ */
+bool FlowerCare::beginRead(FC_READ_CB_T cb, void* arg) {
+  if (busy()) {
+    return false;
+  }
+
+  _readCb = cb;
+  _readCbArg = arg;
+  _retried = false;
+  _readStart = micros();
+  _state = STATE_CONNECT;
+
+  return true;
+}
+
+/**
+ * @brief Run the next step of the asynchronous reading
+ *
+ * @return the state after the step, STATE_DONE when finished
+ */
+FC_STATE_T FlowerCare::poll() {
+  FC_RET_T ret = FLCARE_OK;
+
+  switch (_state) {
+    case STATE_CONNECT:
+      if (transport() == NULL) {
+        ret = ERR_CONNECT;
+      } else if (_hData != 0 && _transport->isConnected()) {
+        // open session, only the read is needed
+        _state = STATE_READ;
+      } else {
+        ret = openLink();
+        _state = STATE_DISCOVER;
+      }
+      break;
+
+    case STATE_DISCOVER:
+      ret = findMode();
+      _stateTime = millis();
+      _state = STATE_SETTLE;
+      break;
+
+    case STATE_SETTLE:
+      if (!_driver->settle) {
+        _state = STATE_MODE;
+      } else if (millis() - _stateTime >= _settleMs) {
+        phase(PHASE_SETTLE, micros() - (millis() - _stateTime) * 1000);
+        _state = STATE_MODE;
+      }
+      break;
+
+    case STATE_MODE:
+      ret = writeMode();
+      if (ret != FLCARE_OK && ret != ERR_NOCONN && _handlesUsed) {
+        // stale cached handles, discover them on the same link
+        clearHandles();
+        ret = FLCARE_OK;
+        _state = STATE_DISCOVER;
+      } else {
+        _state = STATE_READ;
+      }
+      break;
+
+    case STATE_READ:
+      ret = readData();
+      if (ret == ERR_NOCONN && _session && !_retried) {
+        // link dropped since the previous call, reconnect once
+        _retried = true;
+        ret = FLCARE_OK;
+        _state = STATE_CONNECT;
+      } else if (ret != FLCARE_OK && ret != ERR_NOCONN && _handlesUsed &&
+                 !_retried) {
+        // a cached handle failed, reconnect once with discovery
+        _retried = true;
+        clearHandles();
+        disconnect();
+        ret = FLCARE_OK;
+        _state = STATE_CONNECT;
+      } else if (ret == FLCARE_OK) {
+        finish(ret);
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  if (ret != FLCARE_OK) {
+    finish(ret);
+  }
+
+  return _state;
+}
+
+/**
+ * @brief Check if an asynchronous reading is in flight
+ *
+ */
+bool FlowerCare::busy() {
+  return _state != STATE_IDLE && _state != STATE_DONE;
+}
+
+/**
+ * @brief Get the result of the last asynchronous reading
+ *
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::result() { return _result; }
 
-    _data.temp = ((float)val[0] + val[1] * 256) / 10;
-    _data.moist = val[7];
-    _data.light = val[3] + val[4] * 256;
-    _data.fert = val[8] + val[9] * 256;
+/**
+ * @brief Record the phase durations of every reading, see FlowerCareStats
+ *
+ * @param stats where to record, may be shared by many sensors. NULL to stop
+ */
+void FlowerCare::setStats(FlowerCareStats* stats) { _stats = stats; }
 
-    if (dataPtr != NULL) {
-      dataPtr = &_data;
+/**
+ * @brief Append every reading to a time series, timestamped with time(NULL)
+ *
+ * @param series where to append, not owned by the object. NULL to stop
+ */
+void FlowerCare::setSeries(FlowerCareSeries* series) { _series = series; }
+
+/**
+ * @brief Feed every value, read or advertised, to window statistics,
+ * timestamped with time(NULL)
+ *
+ * @param rolling the statistics, not owned by the sensor. NULL to stop
+ */
+void FlowerCare::setRolling(FlowerCareRolling* rolling) { _rolling = rolling; }
+
+/**
+ * @brief Get the duration of a phase of the last reading
+ *
+ * @param p the phase
+ * @return the duration in us
+ */
+uint32_t FlowerCare::phaseTime(FC_PHASE_T p) {
+  return p < PHASE_COUNT ? _phaseUs[p] : 0;
+}
+
+/**
+ * @brief Close the connection and forget the characteristic handles
+ *
+ */
+void FlowerCare::disconnect() {
+  _hMode = 0;
+  _hData = 0;
+  _hInfo = 0;
+
+  if (_transport == NULL) {
+    return;
+  }
+
+  // also when the link is down: a failed or dropped connection may still
+  // hold the client in the transport
+  bool connected = _transport->isConnected();
+  uint32_t start = micros();
+  _transport->disconnect();
+  if (connected) {
+    phase(PHASE_DISCONNECT, start);
+  }
+}
+
+/**
+ * @brief Get data updated by advertisements when recent enough, otherwise
+ * connect to the sensor. See parseAdv()
+ *
+ * @param maxAge  max age in ms of every field to skip the connection
+ * @param dataPtr where to copy the data, may be NULL
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::getDataCached(uint32_t maxAge, FlowerCareData_t* dataPtr) {
+  if (freshFields(maxAge) != FIELD_ALL) {
+    return getData(dataPtr);
+  }
+
+  if (dataPtr != NULL) {
+    *dataPtr = _data;
+  }
+
+  return FLCARE_OK;
+}
+
+/**
+ * @brief Update data from the MiBeacon service data (UUID 0xFE95) of an
+ * advertisement sent by the sensor
+ *
+ * @param data service data
+ * @param len  length of data
+ * @return true if a field was updated
+ */
+bool FlowerCare::parseAdv(const uint8_t* data, size_t len) {
+  FlowerCareAdv_t adv;
+
+  if (!fcParseAdv(data, len, &adv)) {
+    return false;
+  }
+
+  switch (adv.object) {
+    case ADV_TEMP:
+      _data.temp = (float)adv.value / 10;
+      setSeen(FIELD_TEMP);
+      addRolling(FIELD_TEMP, _data.temp);
+      return true;
+
+    case ADV_MOIST:
+      _data.moist = adv.value;
+      setSeen(FIELD_MOIST);
+      addRolling(FIELD_MOIST, (float)adv.value);
+      return true;
+
+    case ADV_LIGHT:
+      _data.light = adv.value;
+      _dli.add((uint32_t)time(NULL), (uint32_t)adv.value);
+      setSeen(FIELD_LIGHT);
+      addRolling(FIELD_LIGHT, (float)adv.value);
+      return true;
+
+    case ADV_FERT:
+      _data.fert = adv.value;
+      setSeen(FIELD_FERT);
+      addRolling(FIELD_FERT, (float)adv.value);
+      return true;
+
+    case ADV_BATTERY:
+      // the firmware is not advertised, refresh the cache only if known
+      _battery = (uint8_t)adv.value;
+      if (_infoValid) {
+        _infoTime = millis();
+      }
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+/**
+ * @brief Get the fields updated in the last maxAge ms
+ *
+ * @param maxAge max age in ms
+ * @return mask of FC_FIELD_T
+ */
+uint8_t FlowerCare::freshFields(uint32_t maxAge) {
+  uint32_t now = millis();
+  uint8_t mask = 0;
+
+  for (uint8_t i = 0; i < 4; i++) {
+    if ((_seenMask & (1 << i)) && now - _seen[i] <= maxAge) {
+      mask |= 1 << i;
     }
+  }
 
-    // disconnect
-    _BLEClient->disconnect();
+  return mask;
+}
 
-    return FLCARE_OK;
+/**
+ * @brief Change the link used to reach the sensor
+ *
+ * @param transport the new link, not owned by the object. NULL to go back to
+ *                  the default transport
+ */
+void FlowerCare::setTransport(FlowerCareTransport* transport) {
+  // a session can not move to another link
+  disconnect();
+
+  if (_ownTransport) {
+    delete _transport;
   }
+  _transport = transport;
+  _ownTransport = false;
+}
 
-  // unable to connect
-  return ERR_CONNECT;
+/**
+ * @brief Use a borrowed link until returnTransport(), the transport of the
+ * sensor is kept and restored then. Used by FlowerCareFleet for its pool
+ *
+ * @param transport the borrowed link, not owned by the object
+ */
+void FlowerCare::lendTransport(FlowerCareTransport* transport) {
+  // a session can not move to another link
+  disconnect();
+
+  if (!_lent) {
+    _lentFrom = _transport;
+    _lentOwn = _ownTransport;
+    _lent = true;
+  }
+  _transport = transport;
+  _ownTransport = false;
+}
+
+/**
+ * @brief Give back the link of lendTransport() and go back to the transport
+ * of the sensor. Does nothing if no link was lent
+ *
+ */
+void FlowerCare::returnTransport() {
+  if (!_lent) {
+    return;
+  }
+
+  disconnect();
+  _transport = _lentFrom;
+  _ownTransport = _lentOwn;
+  _lentFrom = NULL;
+  _lent = false;
+}
+
+/**
+ * @brief Get the BLE address of the sensor
+ *
+ * @return the address, "XX:XX:XX:XX:XX:XX"
+ */
+const std::string& FlowerCare::addr() { return _addr; }
+
+/**
+ * @brief Decode the value of the data characteristic (0x1a01), see fcDecode()
+ *
+ * @param buf  the value
+ * @param len  length of the value
+ * @param data where to store the decoded data
+ * @return true if the value holds a reading
+ */
+bool FlowerCare::decode(const uint8_t* buf, size_t len,
+                        FlowerCareData_t* data) {
+  FlowerCareReading_t reading;
+
+  if (!fcDecode(buf, len, &reading)) {
+    return false;
+  }
+
+  toData(reading, data);
+  return true;
+}
+
+/**
+ * @brief Get the last saved data
+ *
+ * @return the last saved data
+ */
+const FlowerCareData_t& FlowerCare::data() { return _data; }
+
+/**
+ * @brief Get the last saved data in fixed point
+ *
+ * @return the last saved data
+ */
+FlowerCareReading_t FlowerCare::reading() {
+  FlowerCareReading_t reading;
+  toReading(_data, &reading);
+  return reading;
+}
+
+/**
+ * @brief Get the plant values used by the check functions
+ *
+ * @return the plant values
+ */
+const PlantVal_t& FlowerCare::plant() { return _plant; }
+
+/**
+ * @brief Set the plant values used by the check functions
+ *
+ * @param plant the plant values
+ */
+void FlowerCare::setPlant(const PlantVal_t& plant) { _plant = plant; }
+
+/**
+ * @brief Set the plant values from a plant database, by species name
+ *
+ * @param db   the plant database
+ * @param name the species name, case is ignored
+ * @return true if the plant was found, otherwise the values are unchanged
+ */
+bool FlowerCare::setPlant(const FlowerCarePlantDB& db, const char* name) {
+  return db.find(name, &_plant);
 }
 
 /**
@@ -168,17 +663,24 @@ int FlowerCare::fert() { return _data.fert; }
  * @return a string with the formatted data
  */
 String FlowerCare::dataStr() {
-  String str = "";
-  str += "Temperature: ";
-  str += (String)_data.temp;
-  str += "°C\nMoisture: ";
-  str += (String)_data.moist;
-  str += "%\nLight: ";
-  str += (String)_data.light;
-  str += "lux\nSoil EC: ";
-  str += (String)_data.fert;
-  str += "uS/cm\n";
-  return str;
+  char buf[FC_FORMAT_MAXLEN];
+  fcFormat(FORMAT_TEXT, NULL, 0, reading(), FIELD_ALL, buf, sizeof(buf));
+  return String(buf);
+}
+
+/**
+ * @brief Format the last data into a caller buffer, without heap use. Fields
+ * never updated are left out, see fcFormat()
+ *
+ * @param fmt  the format
+ * @param buf  where to write, FC_FORMAT_MAXLEN bytes are always enough
+ * @param len  size of buf
+ * @param time time of the data in s, 0 if unknown
+ * @return the length written, 0 if buf is too small
+ */
+size_t FlowerCare::format(FC_FORMAT_T fmt, char* buf, size_t len,
+                          uint32_t time) {
+  return fcFormat(fmt, _addr.c_str(), time, reading(), _seenMask, buf, len);
 }
 
 /**
@@ -273,242 +775,527 @@ int FlowerCare::checkFert() {
   return 0;
 }
 
+/**
+ * @brief Check the daily light integral of the last complete day against the
+ * plant targets. The day follows time(NULL), see dli() to set the local
+ * midnight
+ *
+ * @return  0 DLI is ok or not known yet
+ *          1 DLI is too high
+ *         -1 DLI is too low
+ */
+int FlowerCare::checkDli() {
+  return _dli.check(_plant.dli_min, _plant.dli_max);
+}
+
+/**
+ * @brief Get the daily light integral of the sensor, fed by every reading
+ *
+ * @return the light accumulator
+ */
+FlowerCareLight& FlowerCare::dli() { return _dli; }
+
 /*******************************************************************************
  *                                  PRIVATE
  ******************************************************************************/
 
 /**
- * @brief Initialize plant values
+ * @brief Convert a fixed-point reading
  *
- * @param plant the plant name. See Plant.h for available plants
- * @return true if the plant is available
- * @return false if the plant is not available
+ * @param reading the reading
+ * @param data    where to store the converted values
  */
-bool FlowerCare::initPlant(Plant plant) {
-  switch (plant) {
-    case FICUS_GINSEGN:
-      _plant.moist_min = 15;
-      _plant.moist_max = 30;
-      _plant.light_min = 1000;
-      _plant.light_max = 2000;
-      _plant.temp_min = 15.0;
-      _plant.temp_max = 30.0;
-      _plant.fert_min = 300;
-      _plant.fert_max = 600;
+void FlowerCare::toData(const FlowerCareReading_t& reading,
+                        FlowerCareData_t* data) {
+  data->temp = (float)reading.temp / 10;
+  data->moist = reading.moist;
+  data->light = (int)reading.light;
+  data->fert = reading.fert;
+}
 
-      return true;
+/**
+ * @brief Convert values to a fixed-point reading, inverse of toData()
+ *
+ * @param data    the values
+ * @param reading where to store the reading
+ */
+void FlowerCare::toReading(const FlowerCareData_t& data,
+                           FlowerCareReading_t* reading) {
+  float temp = data.temp * 10;
+  reading->temp = (int16_t)(temp < 0 ? temp - 0.5f : temp + 0.5f);
+  reading->moist = (uint8_t)data.moist;
+  reading->light = (uint32_t)data.light;
+  reading->fert = (uint16_t)data.fert;
+}
 
-    case ACALYPHA:
-      initLevel(ACALYPHA_VAL);
-      return true;
+/**
+ * @brief Get the transport, creating the default one if none was given
+ *
+ * @return the transport, NULL on host if none was given
+ */
+FlowerCareTransport* FlowerCare::transport() {
+#ifdef ARDUINO
+  if (_transport == NULL) {
+    _transport = new FlowerCareESP32Transport();
+    _ownTransport = true;
+  }
+#endif
+  return _transport;
+}
 
-    case ANTHURIUM:
-      initLevel(ANTHURIUM_VAL);
-      return true;
+/**
+ * @brief Connect, resolve the characteristics and enable data reading.
+ * Does nothing if a session is already open
+ *
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::connect() {
+  if (transport() == NULL) {
+    return ERR_CONNECT;
+  }
 
-    case CALADIUM:
-      initLevel(CALADIUM_VAL);
-      return true;
+  if (_hData != 0 && _transport->isConnected()) {
+    return FLCARE_OK;
+  }
 
-    case CALATHEA:
-      initLevel(CALATHEA_VAL);
-      return true;
+  FC_RET_T ret = openLink();
 
-    case CISSUS_DISCOLOR:
-      initLevel(CISSUS_DISCOLOR_VAL);
-      return true;
+  if (ret == FLCARE_OK) {
+    ret = findMode();
+  }
 
-    case DIEFFENBACHIA:
-      initLevel(DIEFFENBACHIA_VAL);
-      return true;
+  if (ret != FLCARE_OK) {
+    return ret;
+  }
 
-    case DIZYGOTHECA:
-      initLevel(DIZYGOTHECA_VAL);
-      return true;
+  if (_driver->settle) {
+    uint32_t start = micros();
+    delay(_settleMs);
+    phase(PHASE_SETTLE, start);
+  }
 
-    case SAINTPAULIA:
-      initLevel(SAINTPAULIA_VAL);
-      return true;
+  ret = writeMode();
 
-    case SYNGONIUM:
-      initLevel(SYNGONIUM_VAL);
-      return true;
+  if (ret != FLCARE_OK && ret != ERR_NOCONN && _handlesUsed) {
+    // stale cached handles, discover them on the same link
+    clearHandles();
+    ret = findMode();
+    if (ret == FLCARE_OK) {
+      ret = writeMode();
+    }
+  }
 
-    case APHELANDRA:
-      initLevel(APHELANDRA_VAL);
-      return true;
+  return ret;
+}
 
-    case ARAUCARIA:
-      initLevel(ARAUCARIA_VAL);
-      return true;
+/**
+ * @brief Open the link, cleaning up the leftovers of a dropped session
+ *
+ * @return 0 on success, otherwise ERR_CONNECT
+ */
+FC_RET_T FlowerCare::openLink() {
+  disconnect();
 
-    case ASPARAGUS:
-      initLevel(ASPARAGUS_VAL);
-      return true;
+  uint32_t start = micros();
+  FC_RET_T ret = _transport->connect(_addr);
+  phase(PHASE_CONNECT, start);
 
-    case BEGONIA:
-      initLevel(BEGONIA_VAL);
-      return true;
+  return ret == FLCARE_OK ? FLCARE_OK : ERR_CONNECT;
+}
 
-    case BROMELIADS:
-      initLevel(BROMELIADS_VAL);
-      return true;
+/**
+ * @brief Resolve the mode characteristic, from the handle cache if possible.
+ * Nothing to do when the driver has no mode command
+ *
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::findMode() {
+  // may select the driver of the firmware saved with the handles
+  _handlesUsed = cachedHandles();
 
-    case CITRUS:
-      initLevel(CITRUS_VAL);
-      return true;
+  if (!_driver->modeWrite) {
+    return FLCARE_OK;
+  }
 
-    case COLEUS:
-      initLevel(COLEUS_VAL);
-      return true;
+  // entry of a firmware without mode command
+  _handlesUsed = _handlesUsed && _handles.mode != 0;
 
-    case DRACAENA:
-      initLevel(DRACAENA_VAL);
-      return true;
+  if (_handlesUsed) {
+    _hMode = _handles.mode;
+    return FLCARE_OK;
+  }
 
-    case FERNS:
-      initLevel(FERNS_VAL);
-      return true;
+  uint32_t start = micros();
 
-    case FICUS:
-      initLevel(FICUS_VAL);
-      return true;
+  // write particular value to a characteristic to enable data reading
+  FC_RET_T ret = _transport->getCharacteristic(SERVICE_UUID16,
+                                               WRITEMODE_UUID16, &_hMode);
+  phase(PHASE_DISCOVER, start);
 
-    case GYNURA:
-      initLevel(GYNURA_VAL);
-      return true;
+  return ret;
+}
 
-    case HOYA:
-      initLevel(HOYA_VAL);
-      return true;
+/**
+ * @brief Write the mode command if the driver needs it and resolve the data
+ * characteristic
+ *
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::writeMode() {
+  uint32_t start = micros();
+  FC_RET_T ret;
 
-    case IMPATIENS:
-      initLevel(IMPATIENS_VAL);
-      return true;
+  if (_driver->modeWrite) {
+    uint8_t cmd[2] = {0xA0, 0x1F};
+    ret = _transport->write(_hMode, cmd, sizeof(cmd), true);
+    phase(PHASE_WRITE, start);
 
-    case KALANCHOE:
-      initLevel(KALANCHOE_VAL);
-      return true;
+    if (ret != FLCARE_OK) {
+      return ERR_WRITE;
+    }
+  }
 
-    case MARANTA:
-      initLevel(MARANTA_VAL);
-      return true;
+  // add small delay if necessary
+  // delay(100);
 
-    case MONSTERA:
-      initLevel(MONSTERA_VAL);
-      return true;
+  if (_handlesUsed) {
+    _hData = _handles.data;
+    return FLCARE_OK;
+  }
 
-    case ORCHIDS:
-      initLevel(ORCHIDS_VAL);
-      return true;
+  // get characteristic containing data
+  start = micros();
+  ret = _transport->getCharacteristic(SERVICE_UUID16, SENSORDATA_UUID16,
+                                      &_hData);
+  phase(PHASE_DISCOVER, start);
 
-    case PALM:
-      initLevel(PALM_VAL);
-      return true;
+  return ret;
+}
 
-    case PANDANUS:
-      initLevel(PANDANUS_VAL);
-      return true;
+/**
+ * @brief Read and decode the data characteristic on the open connection
+ *
+ * @return 0 on success, ERR_NOCONN if the link dropped, otherwise ERR_READ
+ */
+FC_RET_T FlowerCare::readData() {
+  uint8_t buf[SENSORDATA_LEN];
+  size_t len = sizeof(buf);
 
-    case PEPEROMIA:
-      initLevel(PEPEROMIA_VAL);
-      return true;
+  // Read the value of the characteristic.
+  uint32_t start = micros();
+  FC_RET_T ret = _transport->read(_hData, buf, &len);
+  phase(PHASE_READ, start);
 
-    case PHILODENDRON:
-      initLevel(PHILODENDRON_VAL);
-      return true;
+  if (ret == ERR_NOCONN) {
+    return ret;
+  }
 
-    case SANSEVIERIA:
-      initLevel(SANSEVIERIA_VAL);
-      return true;
+  FlowerCareReading_t reading;
+  if (ret != FLCARE_OK || !_driver->decode(buf, len, &reading)) {
+    if (ret == FLCARE_OK && !_driver->modeWrite) {
+      // firmware updated to one needing the mode command, back to default
+      selectDriver(NULL);
+    }
+    return ERR_READ;
+  }
 
-    case SCHEFFLERA:
-      initLevel(SCHEFFLERA_VAL);
-      return true;
+  toData(reading, &_data);
+  uint32_t now = (uint32_t)time(NULL);
+  _dli.add(now, reading.light);
+  if (_series != NULL) {
+    _series->append(now, reading);
+  }
+  if (_rolling != NULL) {
+    _rolling->add(now, reading);
+  }
+  storeHandles();
+
+  /*
+  // print HEX format of the data characteristic
+  Serial.print("Hex: ");
+  for (int i = 0; i < 16; i++) {
+    Serial.print((int)buf[i], HEX);
+    Serial.print(" ");
+  }
+  Serial.println(" ");
+  */
 
-    case ASPIDISTRA:
-      initLevel(ASPIDISTRA_VAL);
-      return true;
+  setSeen(FIELD_ALL);
 
-    case CHLOROPHYTUM:
-      initLevel(CHLOROPHYTUM_VAL);
-      return true;
+  return FLCARE_OK;
+}
 
-    case CLIVIA:
-      initLevel(CLIVIA_VAL);
-      return true;
+/**
+ * @brief Read battery and firmware on the open connection
+ *
+ * @return 0 on success, ERR_NOCONN if the link dropped, otherwise an error
+ */
+FC_RET_T FlowerCare::readInfo() {
+  uint8_t buf[SENSORDATA_LEN];
+  size_t len = sizeof(buf);
+  FC_RET_T ret;
 
-    case CUPHEA:
-      initLevel(CUPHEA_VAL);
-      return true;
+  uint32_t start = micros();
 
-    case FATSHEDERA:
-      initLevel(FATSHEDERA_VAL);
-      return true;
+  if (_hInfo == 0 && _handlesUsed) {
+    _hInfo = _handles.info;
+  }
 
-    case FATSIA:
-      initLevel(FATSIA_VAL);
-      return true;
+  if (_hInfo == 0) {
+    ret = _transport->getCharacteristic(SERVICE_UUID16, VERSIONBATTERY_UUID16,
+                                        &_hInfo);
+    phase(PHASE_DISCOVER, start);
+    if (ret != FLCARE_OK) {
+      return ret;
+    }
+    start = micros();
+  }
 
-    case GREVILLEA:
-      initLevel(GREVILLEA_VAL);
-      return true;
+  ret = _transport->read(_hInfo, buf, &len);
+  phase(PHASE_READ, start);
 
-    case HEDERA:
-      initLevel(HEDERA_VAL);
-      return true;
+  if (ret == ERR_NOCONN) {
+    return ret;
+  }
 
-    case HELXINE:
-      initLevel(HELXINE_VAL);
-      return true;
+  // battery %, separator, firmware version as text
+  if (ret != FLCARE_OK || len < 3) {
+    return ERR_READ;
+  }
 
-    case LAURUS:
-      initLevel(LAURUS_VAL);
-      return true;
+  _battery = buf[0];
 
-    case PELARGONIUM:
-      initLevel(PELARGONIUM_VAL);
-      return true;
+  size_t n = 0;
+  for (size_t i = 2; i < len && n < FC_FIRMWARE_LEN - 1 && buf[i] != 0; i++) {
+    _firmware[n++] = (char)buf[i];
+  }
+  _firmware[n] = '\0';
+  selectDriver(_firmware);
 
-    case SAXIFRAGA:
-      initLevel(SAXIFRAGA_VAL);
-      return true;
+  _infoTime = millis();
+  _infoValid = true;
+  storeHandles();
 
-    case SUCCULENTS:
-      initLevel(SUCCULENTS_VAL);
-      return true;
+  return FLCARE_OK;
+}
 
-    case TRADESCANTIA:
-      initLevel(TRADESCANTIA_VAL);
-      return true;
+/**
+ * @brief Read the sensor, connecting if needed, and close the connection
+ * unless in session mode
+ *
+ * @param info true to read also battery and firmware
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::fetch(bool info) {
+  uint32_t start = micros();
+  FC_RET_T ret = connect();
+
+  for (uint8_t attempt = 0; ret == FLCARE_OK; attempt++) {
+    ret = readData();
+    if (ret == FLCARE_OK && info) {
+      ret = readInfo();
+    }
 
-    case VINES:
-      initLevel(VINES_VAL);
-      return true;
+    if (ret == FLCARE_OK || attempt > 0) {
+      break;
+    }
+    if (ret != ERR_NOCONN && _handlesUsed) {
+      // a cached handle failed, reconnect once with discovery
+      clearHandles();
+    } else if (ret != ERR_NOCONN || !_session) {
+      break;
+    }
+    // link dropped since the previous call, reconnect once
+    disconnect();
+    ret = connect();
+  }
 
-    case YUCCA:
-      initLevel(YUCCA_VAL);
-      return true;
+  if (!_session || ret != FLCARE_OK) {
+    disconnect();
+  }
 
-    case ROSMARINUS_OFFICINALIS:
-      initLevel(ROSMARINUS_OFFICINALIS_VAL);
-      return true;
+  phase(PHASE_TOTAL, start);
+  if (_stats != NULL) {
+    _stats->result(ret);
+  }
 
-    case THYMUS_VULGARIS:
-      initLevel(THYMUS_VULGARIS_VAL);
-      return true;
+  return ret;
+}
 
-    case SALVIA_OFFICINALIS_LATIFOLIA:
-      initLevel(SALVIA_OFFICINALIS_LATIFOLIA_VAL);
-      return true;
+/**
+ * @brief Load the handle cache entry on first use and check it against the
+ * firmware read on a previous connection
+ *
+ * @return true if the connection can use the cached handles
+ */
+bool FlowerCare::cachedHandles() {
+  if (_handleStore == NULL) {
+    return false;
+  }
 
-    case OCIMUM_BASILICUM:
-      initLevel(OCIMUM_BASILICUM_VAL);
-      return true;
+  if (!_handlesLoaded) {
+    char key[FC_STORE_KEYLEN + 1];
+    fcStoreKey('g', _addr, key);
+    if (!_handleStore->load(key, &_handles, sizeof(_handles)) ||
+        _handles.data == 0) {
+      _handles = {};
+    }
+    _handles.firmware[FC_FIRMWARE_LEN - 1] = '\0';
+    _handlesLoaded = true;
+  }
 
-    default:
-      return false;
+  if (_handles.data == 0) {
+    return false;
+  }
+
+  // firmware not read since boot, use the one saved with the handles
+  if (!_infoValid) {
+    selectDriver(_handles.firmware);
   }
+
+  // handles resolved with another firmware, the attribute table may differ
+  if (_infoValid && _handles.firmware[0] != '\0' &&
+      strcmp(_handles.firmware, _firmware) != 0) {
+    clearHandles();
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Save the handles of the current connection after a successful read,
+ * writes to the store only when the entry changes
+ *
+ */
+void FlowerCare::storeHandles() {
+  if (_handleStore == NULL) {
+    return;
+  }
+
+  if (_handlesUsed && _infoValid && _handles.firmware[0] != '\0' &&
+      strcmp(_handles.firmware, _firmware) != 0) {
+    // firmware updated since the handles were resolved, discover next time
+    clearHandles();
+    return;
+  }
+
+  FlowerCareHandles_t h = _handles;
+  if (!_handlesUsed) {
+    h = {};
+    h.mode = _hMode;
+    h.data = _hData;
+  }
+  if (_hInfo != 0) {
+    h.info = _hInfo;
+  }
+  if (_infoValid) {
+    strncpy(h.firmware, _firmware, FC_FIRMWARE_LEN);
+  }
+
+  if (h.data == 0 || memcmp(&h, &_handles, sizeof(h)) == 0) {
+    return;
+  }
+
+  char key[FC_STORE_KEYLEN + 1];
+  fcStoreKey('g', _addr, key);
+  _handles = h;
+  _handlesLoaded = true;
+  _handleStore->save(key, &_handles, sizeof(_handles));
+}
+
+/**
+ * @brief Follow the firmware with the protocol driver, unless set by
+ * setDriver()
+ *
+ * @param firmware the firmware version, may be empty
+ */
+void FlowerCare::selectDriver(const char* firmware) {
+  if (!_driverFixed) {
+    _driver = fcDriver(firmware);
+  }
+}
+
+/**
+ * @brief End the asynchronous reading
+ *
+ * @param ret result of the reading
+ */
+void FlowerCare::finish(FC_RET_T ret) {
+  if (!_session || ret != FLCARE_OK) {
+    disconnect();
+  }
+
+  _result = ret;
+  _state = STATE_DONE;
+
+  phase(PHASE_TOTAL, _readStart);
+  if (_stats != NULL) {
+    _stats->result(ret);
+  }
+
+  if (_readCb != NULL) {
+    _readCb(this, ret, _readCbArg);
+  }
+}
+
+/**
+ * @brief Record the duration of a phase
+ *
+ * @param p     the phase
+ * @param start micros() at the beginning of the phase
+ */
+void FlowerCare::phase(FC_PHASE_T p, uint32_t start) {
+  uint32_t us = micros() - start;
+
+  _phaseUs[p] = us;
+  if (_stats != NULL) {
+    _stats->record(p, us);
+  }
+}
+
+/**
+ * @brief Mark fields as just updated
+ *
+ * @param mask mask of FC_FIELD_T
+ */
+void FlowerCare::setSeen(uint8_t mask) {
+  uint32_t now = millis();
+
+  for (uint8_t i = 0; i < 4; i++) {
+    if (mask & (1 << i)) {
+      _seen[i] = now;
+    }
+  }
+  _seenMask |= mask;
+}
+
+/**
+ * @brief Feed an advertised value to the window statistics, if any
+ *
+ * @param field the metric, a single FC_FIELD_T
+ * @param value the value, temperature in °C
+ */
+void FlowerCare::addRolling(FC_FIELD_T field, float value) {
+  if (_rolling != NULL) {
+    _rolling->add((uint32_t)time(NULL), field, value);
+  }
+}
+
+/**
+ * @brief Initialize plant values
+ *
+ * @param plant the plant name. See Plant.h for available plants
+ * @return true if the plant is available
+ * @return false if the plant is not available
+ */
+bool FlowerCare::initPlant(Plant plant) {
+  if (plant < 0 || plant >= PLANT_COUNT) {
+    return false;
+  }
+
+  _plant = FlowerCarePlants::table[plant];
+  return true;
 }
 
 /**
@@ -523,51 +1310,5 @@ bool FlowerCare::initPlant(Plant plant) {
  */
 void FlowerCare::initLevel(Level temp_L, Level moist_L, Level light_L,
                            Level fert_L) {
-  // temp in °C
-  if (temp_L == _LOW) {
-    _plant.temp_min = _LOW_TEMPMIN;
-    _plant.temp_max = _LOW_TEMPMAX;
-  } else if (temp_L == _HIGH) {
-    _plant.temp_min = _HIGH_TEMPMIN;
-    _plant.temp_max = _HIGH_TEMPMAX;
-  } else {
-    _plant.temp_min = _MED_TEMPMIN;
-    _plant.temp_max = _MED_TEMPMAX;
-  }
-
-  // moisture in %
-  if (moist_L == _LOW) {
-    _plant.moist_min = _LOW_MOISTMIN;
-    _plant.moist_max = _LOW_MOISTMAX;
-  } else if (moist_L == _HIGH) {
-    _plant.moist_min = _HIGH_MOISTMIN;
-    _plant.moist_max = _HIGH_MOISTMAX;
-  } else {
-    _plant.moist_min = _MED_MOISTMIN;
-    _plant.moist_max = _MED_MOISTMAX;
-  }
-
-  // light in lux
-  if (light_L == _LOW) {
-    _plant.light_min = _LOW_LIGHTMIN;
-    _plant.light_max = _LOW_LIGHTMAX;
-  } else if (light_L == _HIGH) {
-    _plant.light_min = _HIGH_LIGHTMIN;
-    _plant.light_max = _HIGH_LIGHTMAX;
-  } else {
-    _plant.light_min = _MED_LIGHTMIN;
-    _plant.light_max = _MED_LIGHTMAX;
-  }
-
-  // fert in us/cm
-  if (fert_L == _LOW) {
-    _plant.fert_min = _LOW_FERTMIN;
-    _plant.fert_max = _LOW_FERTMAX;
-  } else if (fert_L == _HIGH) {
-    _plant.fert_min = _HIGH_FERTMIN;
-    _plant.fert_max = _HIGH_FERTMAX;
-  } else {
-    _plant.fert_min = _MED_FERTMIN;
-    _plant.fert_max = _MED_FERTMAX;
-  }
+  _plant = fcLevelVal(temp_L, moist_L, light_L, fert_L);
 }
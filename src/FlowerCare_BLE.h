@@ -1,11 +1,7 @@
 #ifndef FLOWERCARE_BLE_H
 #define FLOWERCARE_BLE_H
 
-// WORKING WITH FLOWER CARE FIRMWARE V3.1.8
-
-/* TODO
- * battery check
- */
+// WORKING WITH FLOWER CARE FIRMWARE V3.1.8, OLDER ONES SEE FlowerCare_Driver.h
 
 /* two errors happens: during connection btc_gattc_call_handler()
  * and after getting data bta_gattc_conn_cback()
@@ -14,60 +10,144 @@
  * try to implement handlers like in the examples
  */
 
-#include <Arduino.h>
-#include <BLEDevice.h>
 #include <string>
-#include "Plants.h"
+#include "FlowerCare_Adv.h"
+#include "FlowerCare_Decode.h"
+#include "FlowerCare_Defs.h"
+#include "FlowerCare_Driver.h"
+#include "FlowerCare_Format.h"
+#include "FlowerCare_History.h"
+#include "FlowerCare_Light.h"
+#include "FlowerCare_PlantDB.h"
+#include "FlowerCare_Profile.h"
+#include "FlowerCare_Rolling.h"
+#include "FlowerCare_Series.h"
+#include "FlowerCare_Stats.h"
+#include "FlowerCare_Store.h"
+#include "FlowerCare_Transport.h"
 
-// UUID for BLE, do some research
-#define SERVICE_UUID "00001204-0000-1000-8000-00805f9b34fb"
-#define SENSORDATA_UUID "00001a01-0000-1000-8000-00805f9b34fb"
-#define WRITEMODE_UUID "00001a00-0000-1000-8000-00805f9b34fb"
-#define VERSIONBATTERY_UUID "00001a02-0000-1000-8000-00805f9b34fb"
+#ifdef ARDUINO
+#include "FlowerCare_ESP32Transport.h"
+#else
+#include "FlowerCare_Sim.h"
+#endif
 
 /**
- * @brief Error code
+ * @brief Struct used to hold all data from a sensor
  *
  */
-enum FC_RET_T {
-  FLCARE_OK = 0,
-  ERR_CONNECT,      // connection error
-  ERR_ALREADYCONN,  // already connected
-  ERR_NOCONN,       // no connection
-  ERR_SERVICE,      // serviceUUID not found
-  ERR_CHARACT,      // characteristicUUID not found
-};
+typedef struct FlowerCareData {
+  float temp;
+  int moist, light, fert;
+} FlowerCareData_t;
+
+// max age of battery and firmware before getDataExt() reads them again, in ms
+#define FC_INFO_MAXAGE 86400000UL
+// firmware string length, "3.1.8" plus terminator
+#define FC_FIRMWARE_LEN 8
 
 /**
- * @brief Struct containing plant values
+ * @brief Struct used to hold data, battery and firmware of a sensor
  *
  */
-typedef struct PlantVal {
-  float temp_max, temp_min;
-  int moist_max, moist_min, light_max, light_min, fert_max, fert_min;
-} PlantVal_t;
+typedef struct FlowerCareDataExt {
+  FlowerCareData_t data;
+  uint8_t battery;                /**< Battery in % */
+  char firmware[FC_FIRMWARE_LEN]; /**< Firmware version, "3.1.8" */
+} FlowerCareDataExt_t;
 
 /**
- * @brief Struct used to hold all data from a sensor
+ * @brief Attribute handles of a sensor, saved to skip the discovery on the
+ * next connections. Valid only for the firmware they were resolved with
+ */
+typedef struct FlowerCareHandles {
+  char firmware[FC_FIRMWARE_LEN]; /**< Firmware version, empty if unknown */
+  FC_HANDLE_T mode;               /**< 0x1a00, 0 if no mode command */
+  FC_HANDLE_T data;               /**< 0x1a01, 0 if no entry */
+  FC_HANDLE_T info;               /**< 0x1a02, 0 if not resolved yet */
+} FlowerCareHandles_t;
+
+// default wait between discovery and mode write, in ms. 500 ms was fine
+#define FC_SETTLE_MS 500
+
+/**
+ * @brief State of an asynchronous reading, see FlowerCare::beginRead()
  *
  */
-typedef struct FlowerCareData {
-  float temp;
-  int moist, light, fert;
-} FlowerCareData_t;
+enum FC_STATE_T {
+  STATE_IDLE = 0,   // no reading started
+  STATE_CONNECT,    // connecting
+  STATE_DISCOVER,   // resolving the mode characteristic
+  STATE_SETTLE,     // waiting before the mode write
+  STATE_MODE,       // writing the mode, resolving the data characteristic
+  STATE_READ,       // reading the data
+  STATE_DONE,       // finished, see FlowerCare::result()
+};
+
+class FlowerCare;
+
+/**
+ * @brief Called when an asynchronous reading ends
+ *
+ */
+typedef void (*FC_READ_CB_T)(FlowerCare* sensor, FC_RET_T ret, void* arg);
 
 class FlowerCare {
  public:
-  FlowerCare(std::string);
-  FlowerCare(std::string, Plant);
-  FlowerCare(std::string, Level, Level, Level, Level);
+  FlowerCare(std::string, FlowerCareTransport* = NULL);
+  FlowerCare(std::string, Plant, FlowerCareTransport* = NULL);
+  FlowerCare(std::string, Level, Level, Level, Level,
+             FlowerCareTransport* = NULL);
+  FlowerCare(std::string, const PlantVal_t&, FlowerCareTransport* = NULL);
+  ~FlowerCare();
+
+  FlowerCare(const FlowerCare&) = delete;
+  FlowerCare& operator=(const FlowerCare&) = delete;
 
   FC_RET_T getData(FlowerCareData_t* = NULL);
+  FC_RET_T getDataCached(uint32_t, FlowerCareData_t* = NULL);
+  FC_RET_T getDataExt(FlowerCareDataExt_t* = NULL, uint32_t = FC_INFO_MAXAGE);
+  int battery();
+  const char* firmware();
+  bool parseAdv(const uint8_t*, size_t);
+  uint8_t freshFields(uint32_t);
+  FC_RET_T syncHistory(FC_HISTORY_CB_T, void*, FlowerCareHistoryCursor_t*,
+                       uint16_t = 0);
+  FC_RET_T syncHistory(FC_HISTORY_CB_T, void*, FlowerCareStore*,
+                       uint16_t = 0);
+  void setTransport(FlowerCareTransport*);
+  void lendTransport(FlowerCareTransport*);
+  void returnTransport();
+  void setSession(bool);
+  void setSettleTime(uint32_t);
+  void setHandleCache(FlowerCareStore*);
+  void clearHandles();
+  void setDriver(FC_DRIVER_T);
+  const FlowerCareDriver_t* driver();
+
+  bool beginRead(FC_READ_CB_T = NULL, void* = NULL);
+  FC_STATE_T poll();
+  bool busy();
+  FC_RET_T result();
+
+  void setStats(FlowerCareStats*);
+  void setSeries(FlowerCareSeries*);
+  void setRolling(FlowerCareRolling*);
+  uint32_t phaseTime(FC_PHASE_T);
+  void disconnect();
+  const std::string& addr();
+  static bool decode(const uint8_t*, size_t, FlowerCareData_t*);
+  const FlowerCareData_t& data();
+  FlowerCareReading_t reading();
+  const PlantVal_t& plant();
+  void setPlant(const PlantVal_t&);
+  bool setPlant(const FlowerCarePlantDB&, const char*);
   float temp();
   int moist();
   int light();
   int fert();
   String dataStr();
+  size_t format(FC_FORMAT_T, char*, size_t, uint32_t = 0);
 
   float getTemp();
   int getMoist();
@@ -78,16 +158,118 @@ class FlowerCare {
   int checkMoist();
   int checkLight();
   int checkFert();
+  int checkDli();
+  FlowerCareLight& dli();
 
  private:
-  BLEAddress* _addr; /**< BLE address of Flower Care sensor */
-  BLEUUID *_service_uuid, *_sensorData_uuid, *_writeMode_uuid, *_battVers_uuid;
+  std::string _addr;      /**< BLE address of Flower Care sensor */
   FlowerCareData_t _data; /**< Struct to hold Flower Care data */
   PlantVal_t _plant;      /**< Struct to hold plant values */
-  BLEClient* _BLEClient;  /**< BLE client */
+  FlowerCareTransport* _transport; /**< Link to the sensor */
+  bool _ownTransport; /**< true if _transport was created by the object */
+  FlowerCareTransport* _lentFrom; /**< Own transport while lent another */
+  bool _lentOwn;      /**< _ownTransport of _lentFrom */
+  bool _lent;         /**< A lent transport is in use */
+  uint32_t _seen[4];   /**< millis() of the last update of every field */
+  uint8_t _seenMask;   /**< FC_FIELD_T of the fields updated at least once */
+  bool _session;       /**< Keep the connection open between readings */
+  FC_HANDLE_T _hMode;  /**< Mode characteristic, 0 when not connected */
+  FC_HANDLE_T _hData;  /**< Data characteristic, 0 when not connected */
+  FC_HANDLE_T _hInfo;  /**< Battery/firmware characteristic, 0 if unknown */
+  uint8_t _battery;    /**< Last battery value in % */
+  char _firmware[FC_FIRMWARE_LEN]; /**< Last firmware version */
+  uint32_t _infoTime;  /**< millis() of the last battery/firmware update */
+  bool _infoValid;     /**< true once battery/firmware have been read */
+  uint32_t _settleMs;  /**< Wait between discovery and mode write */
+  const FlowerCareDriver_t* _driver; /**< Protocol of the firmware */
+  bool _driverFixed;   /**< Driver set by setDriver(), not by firmware */
+
+  // handle cache
+  FlowerCareStore* _handleStore; /**< Where the handles persist or NULL */
+  FlowerCareHandles_t _handles;  /**< Cached handles, data 0 if none */
+  bool _handlesLoaded;           /**< _handles read from _handleStore */
+  bool _handlesUsed;             /**< Connection opened with cached handles */
+
+  // asynchronous reading
+  FC_STATE_T _state;    /**< Current state */
+  FC_RET_T _result;     /**< Result of the last finished reading */
+  uint32_t _stateTime;  /**< millis() when the settle wait started */
+  bool _retried;        /**< Reconnected once after a dropped session */
+  FC_READ_CB_T _readCb; /**< Completion callback or NULL */
+  void* _readCbArg;     /**< Argument of _readCb */
+  uint32_t _readStart;  /**< micros() at beginRead() */
+
+  FlowerCareStats* _stats;         /**< Shared statistics or NULL */
+  uint32_t _phaseUs[PHASE_COUNT];  /**< Phase durations of the last reading */
+  FlowerCareSeries* _series;       /**< Time series of the readings or NULL */
+  FlowerCareRolling* _rolling;     /**< Window statistics or NULL */
+  FlowerCareLight _dli;            /**< Daily light integral */
+
+  void setSeen(uint8_t);
+  void addRolling(FC_FIELD_T, float);
+  static void toData(const FlowerCareReading_t&, FlowerCareData_t*);
+  static void toReading(const FlowerCareData_t&, FlowerCareReading_t*);
+  FlowerCareTransport* transport();
+  FC_RET_T connect();
+  FC_RET_T openLink();
+  FC_RET_T findMode();
+  FC_RET_T writeMode();
+  FC_RET_T readData();
+  FC_RET_T readInfo();
+  FC_RET_T fetch(bool);
+  bool cachedHandles();
+  void storeHandles();
+  void selectDriver(const char*);
+  void finish(FC_RET_T);
+  void phase(FC_PHASE_T, uint32_t);
+  FC_RET_T readHistory(FC_HISTORY_CB_T, void*, FlowerCareHistoryCursor_t*,
+                       uint16_t);
+  FC_RET_T readHistoryEntry(FC_HANDLE_T, FC_HANDLE_T, uint16_t, uint8_t*);
+  FC_RET_T findHistoryCursor(FC_HANDLE_T, FC_HANDLE_T, uint16_t,
+                             FlowerCareHistoryCursor_t*);
 
   bool initPlant(Plant);
   void initLevel(Level, Level, Level, Level);
 };
 
+/**
+ * @brief FlowerCare with the plant profile fixed at compile time. The checks
+ * compare with constants, Profile is PlantProfile<plant> or LevelProfile<...>
+ *
+ *   FlowerCarePlant<PlantProfile<FICUS>> flora("C4:7C:8D:00:00:01");
+ */
+template <class Profile>
+class FlowerCarePlant : public FlowerCare {
+ public:
+  /**
+   * @brief Constructor
+   *
+   * @param addr      the BLE address of the FlowerCare sensor
+   * @param transport link to the sensor, see FlowerCare(std::string)
+   */
+  FlowerCarePlant(std::string addr, FlowerCareTransport* transport = NULL)
+      : FlowerCare(addr, Profile::val, transport) {}
+
+  static constexpr int checkTemp(float temp) {
+    return fcCheck(temp, Profile::val.temp_min, Profile::val.temp_max);
+  }
+  static constexpr int checkMoist(int moist) {
+    return fcCheck(moist, Profile::val.moist_min, Profile::val.moist_max);
+  }
+  static constexpr int checkLight(int light) {
+    return fcCheck(light, Profile::val.light_min, Profile::val.light_max);
+  }
+  static constexpr int checkFert(int fert) {
+    return fcCheck(fert, Profile::val.fert_min, Profile::val.fert_max);
+  }
+
+  int checkTemp() { return checkTemp(temp()); }
+  int checkMoist() { return checkMoist(moist()); }
+  int checkLight() { return checkLight(light()); }
+  int checkFert() { return checkFert(fert()); }
+  int checkDli() {
+    return dli().check(Profile::val.dli_min, Profile::val.dli_max);
+  }
+};
+
 #endif
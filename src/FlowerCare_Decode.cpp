@@ -0,0 +1,18 @@
+#include "FlowerCare_Decode.h"
+#include "FlowerCare_Driver.h"
+
+/**
+ * @brief Decode the value of the 0x1a01 sensor data characteristic
+ *
+ * The value read before the mode command is written (aa bb cc dd ee ff ...)
+ * is rejected, as are values too short to hold a reading. Same decoder as
+ * the DRIVER_MODECMD driver
+ *
+ * @param buf     value of the characteristic
+ * @param len     length of buf
+ * @param reading where to store the reading, untouched on failure
+ * @return true if buf holds a reading
+ */
+bool fcDecode(const uint8_t* buf, size_t len, FlowerCareReading_t* reading) {
+  return fcDecodeAs<DRIVER_MODECMD>(buf, len, reading);
+}
@@ -0,0 +1,35 @@
+#ifndef FLOWERCARE_DECODE_H
+#define FLOWERCARE_DECODE_H
+
+/* Decoding of the 0x1a01 sensor data characteristic into a compact fixed-point
+ * reading. Works on a plain byte span, does not allocate and does not depend
+ * on the BLE stack, so it can also be used on values received some other way
+ *
+ * Layout of the value (little endian):
+ *   0-1  temperature, int16, 0.1 °C
+ *   2    unknown
+ *   3-6  light, uint32, lux
+ *   7    moisture, uint8, %
+ *   8-9  fertility (EC), uint16, us/cm
+ *   10-  unknown
+ */
+
+#include "FlowerCare_Defs.h"
+
+// bytes of the 0x1a01 value needed to decode a reading
+#define SENSORDATA_MINLEN 10
+
+/**
+ * @brief Reading of a sensor in fixed point
+ *
+ */
+typedef struct FlowerCareReading {
+  int16_t temp;   /**< Temperature in 0.1 °C */
+  uint8_t moist;  /**< Moisture in % */
+  uint32_t light; /**< Light in lux */
+  uint16_t fert;  /**< Fertility in us/cm */
+} FlowerCareReading_t;
+
+bool fcDecode(const uint8_t*, size_t, FlowerCareReading_t*);
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef FLOWERCARE_DEFS_H
+#define FLOWERCARE_DEFS_H
+
+/* Common definitions shared by FlowerCare and its transports.
+ *
+ * On the ESP32 the Arduino core is used. On a plain Linux host (no ARDUINO
+ * define) a minimal replacement of the few Arduino functions used by the
+ * library is declared here and implemented in FlowerCare_Host.cpp, so the read
+ * path can be built against the simulated transport (FlowerCare_Sim.h)
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <stdio.h>
+
+/**
+ * @brief Host replacement of the Arduino String, only what the library uses
+ *
+ */
+class String : public std::string {
+ public:
+  String() {}
+  String(const char* str) : std::string(str) {}
+  String(const std::string& str) : std::string(str) {}
+  explicit String(int val) : std::string(std::to_string(val)) {}
+  explicit String(unsigned int val) : std::string(std::to_string(val)) {}
+  explicit String(long val) : std::string(std::to_string(val)) {}
+  explicit String(unsigned long val) : std::string(std::to_string(val)) {}
+  explicit String(float val, unsigned char decimals = 2) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, (double)val);
+    assign(buf);
+  }
+};
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void fcSimClock(bool);
+#endif
+
+// UUID for BLE, do some research
+#define SERVICE_UUID "00001204-0000-1000-8000-00805f9b34fb"
+#define SENSORDATA_UUID "00001a01-0000-1000-8000-00805f9b34fb"
+#define WRITEMODE_UUID "00001a00-0000-1000-8000-00805f9b34fb"
+#define VERSIONBATTERY_UUID "00001a02-0000-1000-8000-00805f9b34fb"
+
+// same UUIDs in 16 bit form (Bluetooth base UUID), used by the transports.
+// Shared compile-time constants, the transports build their UUID objects from
+// them only when needed
+constexpr uint16_t SERVICE_UUID16 = 0x1204;
+constexpr uint16_t SENSORDATA_UUID16 = 0x1a01;
+constexpr uint16_t WRITEMODE_UUID16 = 0x1a00;
+constexpr uint16_t VERSIONBATTERY_UUID16 = 0x1a02;
+
+// history service: control (write), data (read), device time (read)
+constexpr uint16_t HISTORY_UUID16 = 0x1206;
+constexpr uint16_t HISTORYCTRL_UUID16 = 0x1a10;
+constexpr uint16_t HISTORYDATA_UUID16 = 0x1a11;
+constexpr uint16_t DEVICETIME_UUID16 = 0x1a12;
+
+// length in bytes of the 0x1a01 sensor data characteristic
+#define SENSORDATA_LEN 16
+// length in bytes of a 0x1a11 history entry
+#define HISTORYDATA_LEN 16
+
+/**
+ * @brief Error code
+ *
+ */
+enum FC_RET_T {
+  FLCARE_OK = 0,
+  ERR_CONNECT,      // connection error
+  ERR_ALREADYCONN,  // already connected
+  ERR_NOCONN,       // no connection
+  ERR_SERVICE,      // serviceUUID not found
+  ERR_CHARACT,      // characteristicUUID not found
+  ERR_WRITE,        // characteristic write failed
+  ERR_READ,         // characteristic read failed or too short
+  ERR_SKIPPED,      // not tried, sensor in backoff, see FlowerCareHealth
+};
+
+/**
+ * @brief Exponential backoff, base doubled at every failure after the first
+ * and saturating at max
+ *
+ * @param base  wait after the first failure
+ * @param fails failures in a row
+ * @param max   longest wait
+ * @return the wait, at most max
+ */
+inline uint32_t fcBackoff(uint32_t base, uint32_t fails, uint32_t max) {
+  uint32_t wait = base < max ? base : max;
+
+  for (uint32_t i = 1; i < fails && wait < max; i++) {
+    wait = wait > max / 2 ? max : wait * 2;
+  }
+  return wait;
+}
+
+#endif
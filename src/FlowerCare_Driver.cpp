@@ -0,0 +1,68 @@
+#include "FlowerCare_Driver.h"
+
+constexpr FlowerCareDriver_t FlowerCareDrivers::table[];
+
+/**
+ * @brief Parse a firmware version string, "3.1.8"
+ *
+ * @param firmware the version string, may be NULL
+ * @return the version as FC_VERSION(), 0 if not a version
+ */
+uint32_t fcVersion(const char* firmware) {
+  if (firmware == NULL) {
+    return 0;
+  }
+
+  uint32_t version = 0;
+  uint8_t parts = 0;
+  uint32_t part = 0;
+  bool digits = false;
+
+  for (const char* c = firmware;; c++) {
+    if (*c >= '0' && *c <= '9') {
+      part = part * 10 + (uint32_t)(*c - '0');
+      digits = true;
+      if (part > 0xFF) {
+        return 0;
+      }
+    } else if ((*c == '.' || *c == '\0') && digits && parts < 3) {
+      version = version << 8 | part;
+      parts++;
+      part = 0;
+      digits = false;
+      if (*c == '\0') {
+        break;
+      }
+    } else {
+      return 0;
+    }
+  }
+
+  // "3.1" is 3.1.0
+  return version << 8 * (3 - parts);
+}
+
+/**
+ * @brief Pick the driver of a firmware
+ *
+ * @param firmware the version read from 0x1a02, may be NULL or empty
+ * @return the driver, DRIVER_MODECMD if the version is unknown
+ */
+const FlowerCareDriver_t* fcDriver(const char* firmware) {
+  uint32_t version = fcVersion(firmware);
+
+  if (version != 0 && version < FC_VERSION_MODECMD) {
+    return &FlowerCareDrivers::table[DRIVER_LEGACY];
+  }
+  return &FlowerCareDrivers::table[DRIVER_MODECMD];
+}
+
+/**
+ * @brief Get a driver by id
+ *
+ * @param id the driver
+ * @return the driver, DRIVER_MODECMD if id is not valid
+ */
+const FlowerCareDriver_t* fcDriver(FC_DRIVER_T id) {
+  return &FlowerCareDrivers::table[id < DRIVER_COUNT ? id : DRIVER_MODECMD];
+}
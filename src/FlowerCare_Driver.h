@@ -0,0 +1,141 @@
+#ifndef FLOWERCARE_DRIVER_H
+#define FLOWERCARE_DRIVER_H
+
+/* Protocol drivers, one per family of Flower Care firmware. Every driver is a
+ * specialization of FlowerCareProtocol fixed at compile time: command
+ * sequence before reading 0x1a01 and layout of its value. fcDriver() picks
+ * the driver of the firmware string read from 0x1a02:
+ *   < 2.6.6   the data characteristic is readable right after connecting
+ *   >= 2.6.6  0xA01F must be written to 0x1a00 first, some time after the
+ *             discovery (tested with 3.1.8)
+ * Sensors of unknown firmware use the >= 2.6.6 sequence, that works on all
+ */
+
+#include "FlowerCare_Decode.h"
+
+/**
+ * @brief Firmware version as a number, to compare versions
+ *
+ */
+#define FC_VERSION(major, minor, patch) \
+  ((uint32_t)(major) << 16 | (uint32_t)(minor) << 8 | (uint32_t)(patch))
+
+// first firmware needing the 0xA01F mode command
+#define FC_VERSION_MODECMD FC_VERSION(2, 6, 6)
+
+/**
+ * @brief Protocol drivers
+ *
+ */
+enum FC_DRIVER_T {
+  DRIVER_LEGACY = 0,  // firmware before 2.6.6, no mode command
+  DRIVER_MODECMD,     // firmware 2.6.6 and later, mode command and settle
+  DRIVER_COUNT,
+};
+
+/**
+ * @brief Driver as seen by FlowerCare, built from a FlowerCareProtocol
+ *
+ */
+typedef struct FlowerCareDriver {
+  FC_DRIVER_T id;
+  const char* name;
+  bool modeWrite; /**< Write 0xA01F before reading the data */
+  bool settle;    /**< Wait between discovery and mode write, needs modeWrite */
+  bool (*decode)(const uint8_t*, size_t, FlowerCareReading_t*);
+} FlowerCareDriver_t;
+
+/**
+ * @brief Layout of the 0x1a01 value (little endian) shared by every known
+ * firmware, see FlowerCare_Decode.h. The value read before the mode command
+ * (aa bb cc ...) is rejected, also by drivers never sending the command in
+ * case the firmware was misread
+ *
+ */
+struct FlowerCareLayout {
+  static constexpr bool placeholder = true; /**< Rejects aa bb cc ... */
+  static constexpr size_t tempAt = 0, lightAt = 3, moistAt = 7, fertAt = 8;
+  static constexpr size_t minLen = SENSORDATA_MINLEN;
+};
+
+/**
+ * @brief Protocol of a firmware family, specialized for every FC_DRIVER_T.
+ * A family with another layout defines its own offsets
+ *
+ */
+template <FC_DRIVER_T D>
+struct FlowerCareProtocol;
+
+template <>
+struct FlowerCareProtocol<DRIVER_LEGACY> : FlowerCareLayout {
+  static constexpr bool modeWrite = false;
+  static constexpr bool settle = false;
+};
+
+template <>
+struct FlowerCareProtocol<DRIVER_MODECMD> : FlowerCareLayout {
+  static constexpr bool modeWrite = true;
+  static constexpr bool settle = true;
+};
+
+/**
+ * @brief Decode the 0x1a01 value with the layout of a protocol
+ *
+ * @param buf     value of the characteristic
+ * @param len     length of buf
+ * @param reading where to store the reading, untouched on failure
+ * @return true if buf holds a reading
+ */
+template <FC_DRIVER_T D>
+bool fcDecodeAs(const uint8_t* buf, size_t len, FlowerCareReading_t* reading) {
+  typedef FlowerCareProtocol<D> P;
+
+  if (buf == NULL || len < P::minLen) {
+    return false;
+  }
+
+  if (P::placeholder && buf[0] == 0xaa && buf[1] == 0xbb && buf[2] == 0xcc) {
+    return false;
+  }
+
+  const uint8_t* l = buf + P::lightAt;
+  reading->temp = (int16_t)(buf[P::tempAt] | buf[P::tempAt + 1] << 8);
+  reading->light = (uint32_t)l[0] | (uint32_t)l[1] << 8 |
+                   (uint32_t)l[2] << 16 | (uint32_t)l[3] << 24;
+  reading->moist = buf[P::moistAt];
+  reading->fert = (uint16_t)(buf[P::fertAt] | buf[P::fertAt + 1] << 8);
+
+  return true;
+}
+
+/**
+ * @brief Driver of a protocol
+ *
+ * @param name name of the driver
+ * @return the driver
+ */
+template <FC_DRIVER_T D>
+constexpr FlowerCareDriver_t fcDriverOf(const char* name) {
+  return FlowerCareDriver_t{D, name, FlowerCareProtocol<D>::modeWrite,
+                            FlowerCareProtocol<D>::settle, fcDecodeAs<D>};
+}
+
+/**
+ * @brief Table of all the drivers, indexed by FC_DRIVER_T
+ *
+ */
+struct FlowerCareDrivers {
+  static constexpr FlowerCareDriver_t table[] = {
+      fcDriverOf<DRIVER_LEGACY>("legacy"),
+      fcDriverOf<DRIVER_MODECMD>("modecmd")};
+};
+
+static_assert(sizeof(FlowerCareDrivers::table) / sizeof(FlowerCareDriver_t) ==
+                  DRIVER_COUNT,
+              "driver table does not match FC_DRIVER_T");
+
+uint32_t fcVersion(const char*);
+const FlowerCareDriver_t* fcDriver(const char*);
+const FlowerCareDriver_t* fcDriver(FC_DRIVER_T);
+
+#endif
@@ -0,0 +1,425 @@
+#ifdef ARDUINO
+
+#include "FlowerCare_ESP32Transport.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+#include "FlowerCare_Adv.h"
+
+// transports that can receive a read or write by handle, see gattcEvent()
+static std::vector<FlowerCareESP32Transport*> rawTransports;
+static std::mutex rawMutex;
+
+/**
+ * @brief Initialize the BLE stack, once for all transports and scanners
+ *
+ */
+void fcBLEInit() {
+  static std::once_flag once;
+  std::call_once(once, [] { BLEDevice::init(""); });
+}
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ */
+FlowerCareESP32Transport::FlowerCareESP32Transport() {
+  fcBLEInit();
+
+  static std::once_flag once;
+  std::call_once(once, [] { BLEDevice::setCustomGattcHandler(gattcEvent); });
+
+  _BLEClient = nullptr;
+  _nChars = 0;
+
+  _rawDone = xSemaphoreCreateBinary();
+  _rawHandle = 0;
+  _rawStatus = ESP_GATT_OK;
+  _rawBuf = nullptr;
+  _rawLen = 0;
+
+  std::lock_guard<std::mutex> lock(rawMutex);
+  rawTransports.push_back(this);
+}
+
+/**
+ * @brief Destructor, close the connection if still open
+ *
+ */
+FlowerCareESP32Transport::~FlowerCareESP32Transport() {
+  {
+    std::lock_guard<std::mutex> lock(rawMutex);
+    rawTransports.erase(
+        std::find(rawTransports.begin(), rawTransports.end(), this));
+  }
+
+  disconnect();
+  delete _BLEClient;
+  vSemaphoreDelete(_rawDone);
+}
+
+/**
+ * @brief Connect to the sensor
+ *
+ * @param addr BLE address of the sensor
+ * @return FLCARE_OK, ERR_ALREADYCONN or ERR_CONNECT
+ */
+FC_RET_T FlowerCareESP32Transport::connect(const std::string& addr) {
+  // one client for the whole life of the transport, previously a new one was
+  // created on every reading and never released
+  if (_BLEClient == nullptr) {
+    _BLEClient = BLEDevice::createClient();
+  }
+
+  if (_BLEClient->isConnected()) {
+    return ERR_ALREADYCONN;
+  }
+
+  // services and characteristics are discovered again on every connection
+  _nChars = 0;
+
+  if (!_BLEClient->connect(BLEAddress(addr))) {
+    // a timed out attempt may complete later, close it so the client does
+    // not stay half open
+    _BLEClient->disconnect();
+    return ERR_CONNECT;
+  }
+
+  return FLCARE_OK;
+}
+
+/**
+ * @brief Close the connection
+ *
+ */
+void FlowerCareESP32Transport::disconnect() {
+  _nChars = 0;
+
+  if (_BLEClient != nullptr && _BLEClient->isConnected()) {
+    _BLEClient->disconnect();
+  }
+}
+
+/**
+ * @brief Check if the link is up
+ *
+ */
+bool FlowerCareESP32Transport::isConnected() {
+  return _BLEClient != nullptr && _BLEClient->isConnected();
+}
+
+/**
+ * @brief Look up a characteristic of the connected sensor
+ *
+ * @param service 16 bit UUID of the service
+ * @param charact 16 bit UUID of the characteristic
+ * @param handle  where to store the characteristic handle
+ * @return FLCARE_OK, ERR_NOCONN, ERR_SERVICE or ERR_CHARACT
+ */
+FC_RET_T FlowerCareESP32Transport::getCharacteristic(uint16_t service,
+                                                     uint16_t charact,
+                                                     FC_HANDLE_T* handle) {
+  if (!isConnected()) {
+    return ERR_NOCONN;
+  }
+
+  BLERemoteService* pRemoteService = _BLEClient->getService(BLEUUID(service));
+
+  if (pRemoteService == nullptr) {
+    return ERR_SERVICE;
+  }
+
+  // TODO errors occour during this call to getCharacteristic(). In particular
+  // [E][BLERemoteCharacteristic.cpp:308] retrieveDescriptors():
+  //   esp_ble_gattc_get_all_descr: ESP_GATT_NOT_FOUND
+  BLERemoteCharacteristic* pRemoteCharacteristic =
+      pRemoteService->getCharacteristic(BLEUUID(charact));
+
+  if (pRemoteCharacteristic == nullptr) {
+    return ERR_CHARACT;
+  }
+
+  *handle = pRemoteCharacteristic->getHandle();
+
+  if (findChar(*handle) == nullptr) {
+    if (_nChars == FC_ESP32_MAXCHARS) {
+      // table full, forget the oldest entry
+      for (uint8_t i = 1; i < FC_ESP32_MAXCHARS; i++) {
+        _chars[i - 1] = _chars[i];
+      }
+      _nChars--;
+    }
+    _chars[_nChars].handle = *handle;
+    _chars[_nChars].charact = pRemoteCharacteristic;
+    _nChars++;
+  }
+
+  return FLCARE_OK;
+}
+
+/**
+ * @brief Write a characteristic. A handle not resolved on this connection,
+ * e.g. cached from a previous one, is written directly by handle
+ *
+ * @param handle   handle returned by getCharacteristic()
+ * @param buf      data to write
+ * @param len      number of bytes to write
+ * @param response true to wait for the write response
+ * @return FLCARE_OK, ERR_NOCONN, ERR_CHARACT or ERR_WRITE
+ */
+FC_RET_T FlowerCareESP32Transport::write(FC_HANDLE_T handle,
+                                         const uint8_t* buf, size_t len,
+                                         bool response) {
+  if (!isConnected()) {
+    return ERR_NOCONN;
+  }
+
+  BLERemoteCharacteristic* pRemoteCharacteristic = findChar(handle);
+
+  if (pRemoteCharacteristic != nullptr) {
+    pRemoteCharacteristic->writeValue((uint8_t*)buf, len, response);
+    return FLCARE_OK;
+  }
+
+  if (!response) {
+    esp_err_t err = esp_ble_gattc_write_char(
+        _BLEClient->getGattcIf(), _BLEClient->getConnId(), handle, len,
+        (uint8_t*)buf, ESP_GATT_WRITE_TYPE_NO_RSP, ESP_GATT_AUTH_REQ_NONE);
+    return err == ESP_OK ? FLCARE_OK : ERR_WRITE;
+  }
+
+  rawBegin(handle, nullptr, 0);
+  esp_err_t err = esp_ble_gattc_write_char(
+      _BLEClient->getGattcIf(), _BLEClient->getConnId(), handle, len,
+      (uint8_t*)buf, ESP_GATT_WRITE_TYPE_RSP, ESP_GATT_AUTH_REQ_NONE);
+
+  return rawEnd(err, ERR_WRITE);
+}
+
+/**
+ * @brief Read a characteristic. A handle not resolved on this connection,
+ * e.g. cached from a previous one, is read directly by handle
+ *
+ * @param handle handle returned by getCharacteristic()
+ * @param buf    where to store the value
+ * @param len    in: size of buf, out: number of bytes stored
+ * @return FLCARE_OK, ERR_NOCONN, ERR_CHARACT or ERR_READ
+ */
+FC_RET_T FlowerCareESP32Transport::read(FC_HANDLE_T handle, uint8_t* buf,
+                                        size_t* len) {
+  if (!isConnected()) {
+    return ERR_NOCONN;
+  }
+
+  BLERemoteCharacteristic* pRemoteCharacteristic = findChar(handle);
+
+  if (pRemoteCharacteristic == nullptr) {
+    rawBegin(handle, buf, *len);
+    esp_err_t err =
+        esp_ble_gattc_read_char(_BLEClient->getGattcIf(),
+                                _BLEClient->getConnId(), handle,
+                                ESP_GATT_AUTH_REQ_NONE);
+    FC_RET_T ret = rawEnd(err, ERR_READ);
+    *len = ret == FLCARE_OK ? _rawLen : 0;
+    return ret;
+  }
+
+  std::string value = pRemoteCharacteristic->readValue();
+
+  // an empty value means the read failed
+  if (value.empty()) {
+    *len = 0;
+    return ERR_READ;
+  }
+
+  if (value.size() < *len) {
+    *len = value.size();
+  }
+  memcpy(buf, value.data(), *len);
+
+  return FLCARE_OK;
+}
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Find a characteristic resolved on the current connection
+ *
+ * @param handle the characteristic handle
+ * @return the characteristic or nullptr if not resolved
+ */
+BLERemoteCharacteristic* FlowerCareESP32Transport::findChar(
+    FC_HANDLE_T handle) {
+  for (uint8_t i = 0; i < _nChars; i++) {
+    if (_chars[i].handle == handle) {
+      return _chars[i].charact;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Prepare a read or write by handle, before the request is sent
+ *
+ * @param handle the attribute handle
+ * @param buf    where to store the read value, nullptr for a write
+ * @param len    size of buf
+ */
+void FlowerCareESP32Transport::rawBegin(FC_HANDLE_T handle, uint8_t* buf,
+                                        size_t len) {
+  // drop a completion given after the timeout of the previous operation
+  xSemaphoreTake(_rawDone, 0);
+
+  std::lock_guard<std::mutex> lock(rawMutex);
+  _rawHandle = handle;
+  _rawStatus = ESP_GATT_ERROR;
+  _rawBuf = buf;
+  _rawLen = len;
+}
+
+/**
+ * @brief Wait for the end of a read or write by handle
+ *
+ * @param err  result of the request
+ * @param fail error returned when the operation fails
+ * @return FLCARE_OK, ERR_NOCONN, ERR_CHARACT or fail
+ */
+FC_RET_T FlowerCareESP32Transport::rawEnd(esp_err_t err, FC_RET_T fail) {
+  bool done = err == ESP_OK &&
+              xSemaphoreTake(_rawDone, pdMS_TO_TICKS(FC_ESP32_RAWTIMEOUT)) ==
+                  pdTRUE;
+  bool connected = isConnected();
+
+  std::lock_guard<std::mutex> lock(rawMutex);
+  _rawHandle = 0;
+  _rawBuf = nullptr;
+
+  if (!done) {
+    return connected ? fail : ERR_NOCONN;
+  }
+  if (_rawStatus == ESP_GATT_INVALID_HANDLE) {
+    return ERR_CHARACT;
+  }
+  return _rawStatus == ESP_GATT_OK ? FLCARE_OK : fail;
+}
+
+/**
+ * @brief Called by the BLE library for every GATT client event, ends the
+ * read or write by handle in flight on the same connection
+ *
+ * @param event   the event
+ * @param gattcIf GATT client interface of the connection
+ * @param param   event parameters
+ */
+void FlowerCareESP32Transport::gattcEvent(esp_gattc_cb_event_t event,
+                                          esp_gatt_if_t gattcIf,
+                                          esp_ble_gattc_cb_param_t* param) {
+  uint16_t connId;
+  FC_HANDLE_T handle;
+  esp_gatt_status_t status;
+
+  if (event == ESP_GATTC_READ_CHAR_EVT) {
+    connId = param->read.conn_id;
+    handle = param->read.handle;
+    status = param->read.status;
+  } else if (event == ESP_GATTC_WRITE_CHAR_EVT) {
+    connId = param->write.conn_id;
+    handle = param->write.handle;
+    status = param->write.status;
+  } else {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(rawMutex);
+
+  for (size_t i = 0; i < rawTransports.size(); i++) {
+    FlowerCareESP32Transport* t = rawTransports[i];
+    if (t->_rawHandle != handle || t->_BLEClient == nullptr ||
+        t->_BLEClient->getGattcIf() != gattcIf ||
+        t->_BLEClient->getConnId() != connId) {
+      continue;
+    }
+
+    t->_rawStatus = status;
+    if (t->_rawBuf != nullptr && status == ESP_GATT_OK) {
+      t->_rawLen = std::min((size_t)param->read.value_len, t->_rawLen);
+      memcpy(t->_rawBuf, param->read.value, t->_rawLen);
+    }
+    t->_rawHandle = 0;
+    xSemaphoreGive(t->_rawDone);
+  }
+}
+
+/*******************************************************************************
+ *                          FlowerCareESP32Scanner
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ */
+FlowerCareESP32Scanner::FlowerCareESP32Scanner() {
+  fcBLEInit();
+
+  _cb = NULL;
+  _cbArg = NULL;
+}
+
+/**
+ * @brief Passive scan, the sensors are never connected
+ *
+ * @param ms  scan window in ms, rounded up to seconds
+ * @param cb  called for every advertisement with service data
+ * @param arg argument passed to cb
+ * @return FLCARE_OK or ERR_CONNECT if the scan could not start
+ */
+FC_RET_T FlowerCareESP32Scanner::scan(uint32_t ms, FC_ADV_CB_T cb, void* arg) {
+  BLEScan* pBLEScan = BLEDevice::getScan();
+
+  if (pBLEScan == nullptr) {
+    return ERR_CONNECT;
+  }
+
+  _cb = cb;
+  _cbArg = arg;
+
+  // duplicates are needed, the sensor sends one metric per advertisement
+  pBLEScan->setAdvertisedDeviceCallbacks(this, true);
+  pBLEScan->setActiveScan(false);
+  pBLEScan->start((ms + 999) / 1000, false);
+  pBLEScan->clearResults();
+
+  _cb = NULL;
+  _cbArg = NULL;
+
+  return FLCARE_OK;
+}
+
+/**
+ * @brief Called by the BLE library for every advertisement
+ *
+ * @param device the advertiser
+ */
+void FlowerCareESP32Scanner::onResult(BLEAdvertisedDevice device) {
+  if (_cb == NULL || !device.haveServiceData()) {
+    return;
+  }
+
+  BLEUUID uuid = device.getServiceDataUUID();
+  if (!uuid.equals(BLEUUID((uint16_t)MIBEACON_UUID16))) {
+    return;
+  }
+
+  std::string data = device.getServiceData();
+  _cb(device.getAddress().toString(), MIBEACON_UUID16,
+      (const uint8_t*)data.data(), data.size(), device.getRSSI(), _cbArg);
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef FLOWERCARE_ESP32TRANSPORT_H
+#define FLOWERCARE_ESP32TRANSPORT_H
+
+#ifdef ARDUINO
+
+#include <BLEDevice.h>
+#include <esp_gattc_api.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "FlowerCare_Transport.h"
+
+// max number of characteristics resolved on the same connection
+#define FC_ESP32_MAXCHARS 4
+// max wait of a read or write by handle, in ms
+#define FC_ESP32_RAWTIMEOUT 2000
+
+void fcBLEInit();
+
+/**
+ * @brief Transport on top of the ESP32 BLE library (BLEClient)
+ *
+ */
+class FlowerCareESP32Transport : public FlowerCareTransport {
+ public:
+  FlowerCareESP32Transport();
+  ~FlowerCareESP32Transport();
+
+  FC_RET_T connect(const std::string&);
+  void disconnect();
+  bool isConnected();
+  FC_RET_T getCharacteristic(uint16_t, uint16_t, FC_HANDLE_T*);
+  FC_RET_T write(FC_HANDLE_T, const uint8_t*, size_t, bool);
+  FC_RET_T read(FC_HANDLE_T, uint8_t*, size_t*);
+
+ private:
+  BLEClient* _BLEClient; /**< BLE client, created on first connection */
+
+  /**
+   * @brief Characteristics resolved on the current connection
+   *
+   */
+  struct {
+    FC_HANDLE_T handle;
+    BLERemoteCharacteristic* charact;
+  } _chars[FC_ESP32_MAXCHARS];
+  uint8_t _nChars; /**< Number of valid entries in _chars */
+
+  // read or write by handle in flight, for handles not resolved on this
+  // connection. Completed by gattcEvent()
+  SemaphoreHandle_t _rawDone;    /**< Given when the operation ends */
+  FC_HANDLE_T _rawHandle;        /**< Handle of the operation, 0 if none */
+  esp_gatt_status_t _rawStatus;  /**< Status of the ended operation */
+  uint8_t* _rawBuf;              /**< Where to store the read value */
+  size_t _rawLen;                /**< in: size of _rawBuf, out: value len */
+
+  BLERemoteCharacteristic* findChar(FC_HANDLE_T);
+  void rawBegin(FC_HANDLE_T, uint8_t*, size_t);
+  FC_RET_T rawEnd(esp_err_t, FC_RET_T);
+  static void gattcEvent(esp_gattc_cb_event_t, esp_gatt_if_t,
+                         esp_ble_gattc_cb_param_t*);
+};
+
+/**
+ * @brief Passive scanner on top of the ESP32 BLE library (BLEScan)
+ *
+ */
+class FlowerCareESP32Scanner : public FlowerCareScanner,
+                               public BLEAdvertisedDeviceCallbacks {
+ public:
+  FlowerCareESP32Scanner();
+
+  FC_RET_T scan(uint32_t, FC_ADV_CB_T, void*);
+  void onResult(BLEAdvertisedDevice);
+
+ private:
+  FC_ADV_CB_T _cb; /**< Callback of the running scan */
+  void* _cbArg;    /**< Argument of _cb */
+};
+
+#endif
+
+#endif
@@ -0,0 +1,460 @@
+#include "FlowerCare_Fleet.h"
+
+#include <ctype.h>
+
+/**
+ * @brief Normalize a BLE address, libraries differ on the case
+ *
+ * @param addr the address
+ * @return the lower case address
+ */
+static std::string addrKey(const std::string& addr) {
+  std::string key = addr;
+  for (size_t i = 0; i < key.size(); i++) {
+    key[i] = (char)tolower((unsigned char)key[i]);
+  }
+  return key;
+}
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ * @param maxConn    max number of connections in flight
+ * @param factory    creates the transport of each connection. If NULL on
+ *                   ESP32 BLE transports are used, on host it must be given
+ * @param factoryArg argument passed to factory
+ */
+FlowerCareFleet::FlowerCareFleet(uint8_t maxConn,
+                                 FC_TRANSPORT_FACTORY_T factory,
+                                 void* factoryArg) {
+  _factory = factory;
+  _factoryArg = factoryArg;
+  _results = NULL;
+  _cb = NULL;
+  _cbArg = NULL;
+  _scanner = NULL;
+  _ownScanner = false;
+  _maxAge = 0;
+  _stats = NULL;
+  _select = NULL;
+  _handleStore = NULL;
+  _health = NULL;
+
+  for (uint8_t i = 0; i < FC_FLEET_MAXCONN_LIMIT; i++) {
+    _pool[i] = NULL;
+    _workers[i].fleet = this;
+    _workers[i].conn = i;
+  }
+
+  setMaxConnections(maxConn);
+}
+
+/**
+ * @brief Destructor, release sensors and transports
+ *
+ */
+FlowerCareFleet::~FlowerCareFleet() {
+  for (size_t i = 0; i < _sensors.size(); i++) {
+    delete _sensors[i];
+  }
+  for (uint8_t i = 0; i < FC_FLEET_MAXCONN_LIMIT; i++) {
+    delete _pool[i];
+  }
+  if (_ownScanner) {
+    delete _scanner;
+  }
+}
+
+/**
+ * @brief Add a sensor to the fleet
+ *
+ * @param sensor the sensor, owned by the fleet from now on. Sweeps lend it a
+ *               connection of the pool, its own transport is kept
+ * @return the index of the sensor
+ */
+size_t FlowerCareFleet::add(FlowerCare* sensor) {
+  if (_stats != NULL) {
+    sensor->setStats(_stats);
+  }
+  if (_handleStore != NULL) {
+    sensor->setHandleCache(_handleStore);
+  }
+  _index[addrKey(sensor->addr())] = _sensors.size();
+  _sensors.push_back(sensor);
+  return _sensors.size() - 1;
+}
+
+/**
+ * @brief Add a sensor to the fleet
+ *
+ * @param addr  the BLE address of the sensor
+ * @param plant the plant type
+ * @return the index of the sensor
+ */
+size_t FlowerCareFleet::add(std::string addr, Plant plant) {
+  return add(new FlowerCare(addr, plant));
+}
+
+/**
+ * @brief Get the number of sensors
+ *
+ */
+size_t FlowerCareFleet::size() { return _sensors.size(); }
+
+/**
+ * @brief Get a sensor
+ *
+ * @param idx index returned by add()
+ * @return the sensor or NULL if idx is not valid
+ */
+FlowerCare* FlowerCareFleet::sensor(size_t idx) {
+  return idx < _sensors.size() ? _sensors[idx] : NULL;
+}
+
+/**
+ * @brief Set the max number of connections in flight
+ *
+ * @param maxConn 1 to FC_FLEET_MAXCONN_LIMIT
+ */
+void FlowerCareFleet::setMaxConnections(uint8_t maxConn) {
+  if (maxConn < 1) {
+    maxConn = 1;
+  } else if (maxConn > FC_FLEET_MAXCONN_LIMIT) {
+    maxConn = FC_FLEET_MAXCONN_LIMIT;
+  }
+  _maxConn = maxConn;
+}
+
+/**
+ * @brief Read all sensors
+ *
+ * @param results where to store the results, size() entries. May be NULL,
+ *                the data stay available in each sensor anyway
+ * @return the number of sensors read successfully
+ */
+size_t FlowerCareFleet::sweep(FlowerCareFleetResult_t* results) {
+  _select = NULL;
+  _results = results;
+  _cb = NULL;
+  _cbArg = NULL;
+  return run();
+}
+
+/**
+ * @brief Read all sensors, calling cb after every reading
+ *
+ * @param cb  completion callback
+ * @param arg argument passed to cb
+ * @return the number of sensors read successfully
+ */
+size_t FlowerCareFleet::sweep(FC_FLEET_CB_T cb, void* arg) {
+  _select = NULL;
+  _results = NULL;
+  _cb = cb;
+  _cbArg = arg;
+  return run();
+}
+
+/**
+ * @brief Read some of the sensors, with the same connections as a full sweep
+ *
+ * @param select indexes of the sensors to read, each valid and at most once
+ * @param cb     completion callback, may be NULL
+ * @param arg    argument passed to cb
+ * @return the number of sensors read successfully
+ */
+size_t FlowerCareFleet::sweep(const std::vector<size_t>& select,
+                              FC_FLEET_CB_T cb, void* arg) {
+  _select = &select;
+  _results = NULL;
+  _cb = cb;
+  _cbArg = arg;
+  size_t ok = run();
+  _select = NULL;
+  return ok;
+}
+
+/**
+ * @brief Set the scanner used by scan()
+ *
+ * @param scanner the scanner, not owned by the fleet. If never set on ESP32 a
+ *                BLE scanner is created, on host it must be given
+ */
+void FlowerCareFleet::setScanner(FlowerCareScanner* scanner) {
+  if (_ownScanner) {
+    delete _scanner;
+  }
+  _scanner = scanner;
+  _ownScanner = false;
+}
+
+/**
+ * @brief Let sweeps skip the connection to sensors whose advertised data are
+ * all younger than maxAge, see scan()
+ *
+ * @param maxAge max age in ms, 0 always connects
+ */
+void FlowerCareFleet::setMaxAge(uint32_t maxAge) { _maxAge = maxAge; }
+
+/**
+ * @brief Passive scan: update every sensor of the fleet from its
+ * advertisements, without connecting
+ *
+ * @param ms scan window in ms
+ * @return the number of sensors with all fields updated in this window
+ */
+size_t FlowerCareFleet::scan(uint32_t ms) {
+  if (_scanner == NULL) {
+#ifdef ARDUINO
+    _scanner = new FlowerCareESP32Scanner();
+    _ownScanner = true;
+#else
+    return 0;
+#endif
+  }
+
+  uint32_t start = millis();
+
+  if (_scanner->scan(ms, onAdv, this) != FLCARE_OK) {
+    return 0;
+  }
+
+  uint32_t window = millis() - start;
+  size_t updated = 0;
+
+  for (size_t i = 0; i < _sensors.size(); i++) {
+    if (_sensors[i]->freshFields(window) == FIELD_ALL) {
+      updated++;
+    }
+  }
+
+  return updated;
+}
+
+/**
+ * @brief Record the phase durations of every sensor in the same statistics
+ *
+ * @param stats where to record, not owned by the fleet. NULL to stop
+ */
+void FlowerCareFleet::setStats(FlowerCareStats* stats) {
+  _stats = stats;
+  for (size_t i = 0; i < _sensors.size(); i++) {
+    _sensors[i]->setStats(stats);
+  }
+}
+
+/**
+ * @brief Persist the attribute handles of every sensor, see
+ * FlowerCare::setHandleCache()
+ *
+ * @param store where the handles are kept, not owned by the fleet. NULL to
+ *              always discover
+ */
+void FlowerCareFleet::setHandleCache(FlowerCareStore* store) {
+  _handleStore = store;
+  for (size_t i = 0; i < _sensors.size(); i++) {
+    _sensors[i]->setHandleCache(store);
+  }
+}
+
+/**
+ * @brief Retry, back off and skip failing sensors, see FlowerCareHealth.
+ * Skipped sensors report ERR_SKIPPED
+ *
+ * @param health the health tracker, resized to the fleet at every sweep. Not
+ *               owned by the fleet, NULL to read every sensor every time
+ */
+void FlowerCareFleet::setHealth(FlowerCareHealth* health) { _health = health; }
+
+/**
+ * @brief Copy the plant values and the last data of every sensor into a
+ * struct-of-arrays store, for FlowerCareReadings::evaluateAll()
+ *
+ * @param readings where to copy, resized to the fleet size
+ * @param maxAge   values older than this, in ms, are left out
+ */
+void FlowerCareFleet::collect(FlowerCareReadings* readings, uint32_t maxAge) {
+  readings->resize(_sensors.size());
+
+  for (size_t i = 0; i < _sensors.size(); i++) {
+    FlowerCare* s = _sensors[i];
+    const FlowerCareData_t& d = s->data();
+    uint8_t fresh = s->freshFields(maxAge);
+
+    readings->setPlant(i, s->plant());
+    readings->invalidate(i, FIELD_ALL & ~fresh);
+    if (fresh) {
+      readings->set(i, d.temp, d.moist, d.light, d.fert, fresh);
+    }
+  }
+}
+
+/**
+ * @brief Pack the last data of every sensor into one buffer, e.g. after a
+ * sweep, for transmission
+ *
+ * @param batch  where to pack, records are appended
+ * @param time   time of the data in s
+ * @param maxAge values older than this, in ms, are left out. Sensors without
+ *               any value are skipped
+ * @return the number of sensors packed, less than size() if batch is full
+ */
+size_t FlowerCareFleet::encode(FlowerCareBatch* batch, uint32_t time,
+                               uint32_t maxAge) {
+  size_t n = 0;
+
+  for (size_t i = 0; i < _sensors.size(); i++) {
+    FlowerCare* s = _sensors[i];
+    uint8_t fresh = s->freshFields(maxAge);
+
+    if (!fresh) {
+      continue;
+    }
+    if (!batch->add(s->addr().c_str(), time, s->reading(), fresh)) {
+      break;
+    }
+    n++;
+  }
+
+  return n;
+}
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Run a sweep: the caller works as the first connection, one task per
+ * additional connection
+ *
+ * @return the number of sensors read successfully
+ */
+size_t FlowerCareFleet::run() {
+  uint8_t nConn = _maxConn;
+  size_t count = _select != NULL ? _select->size() : _sensors.size();
+
+  if (nConn > count) {
+    nConn = (uint8_t)count;
+  }
+
+  _next = 0;
+  _ok = 0;
+
+  if (_health != NULL) {
+    if (_health->size() != _sensors.size()) {
+      _health->resize(_sensors.size());
+    }
+    _health->begin();
+  }
+
+  for (uint8_t i = 0; i < nConn; i++) {
+    if (_pool[i] == NULL) {
+#ifdef ARDUINO
+      _pool[i] = _factory != NULL ? _factory(_factoryArg)
+                                  : new FlowerCareESP32Transport();
+#else
+      _pool[i] = _factory != NULL ? _factory(_factoryArg) : NULL;
+#endif
+    }
+  }
+
+  for (uint8_t i = 1; i < nConn; i++) {
+    _tasks[i - 1].start(worker, &_workers[i], "flcare_fleet");
+  }
+
+  if (nConn > 0) {
+    worker(&_workers[0]);
+  }
+
+  for (uint8_t i = 1; i < nConn; i++) {
+    _tasks[i - 1].join();
+  }
+
+  return _ok;
+}
+
+/**
+ * @brief Read sensors with one connection until none is left
+ *
+ * @param arg the Worker_t of the connection
+ */
+void FlowerCareFleet::worker(void* arg) {
+  FlowerCareFleet* fleet = ((Worker_t*)arg)->fleet;
+  FlowerCareTransport* transport = fleet->_pool[((Worker_t*)arg)->conn];
+
+  const std::vector<size_t>* select = fleet->_select;
+  size_t count = select != NULL ? select->size() : fleet->_sensors.size();
+
+  for (size_t k = fleet->_next++; k < count; k = fleet->_next++) {
+    size_t i = select != NULL ? (*select)[k] : k;
+    FlowerCare* sensor = fleet->_sensors[i];
+    FlowerCareData_t data = {};
+    FC_RET_T ret = ERR_CONNECT;
+
+    if (fleet->_maxAge > 0 &&
+        sensor->freshFields(fleet->_maxAge) == FIELD_ALL) {
+      // advertised data are recent, no connection needed
+      ret = sensor->getDataCached(fleet->_maxAge, &data);
+    } else if (fleet->_health != NULL &&
+               !fleet->_health->allow(i, millis())) {
+      ret = ERR_SKIPPED;
+    } else if (transport != NULL) {
+      sensor->lendTransport(transport);
+      for (;;) {
+        uint32_t start = millis();
+        ret = sensor->getData(&data);
+        if (fleet->_health == NULL ||
+            !fleet->_health->record(i, ret, start, millis() - start)) {
+          break;
+        }
+      }
+      sensor->returnTransport();
+    }
+
+    if (ret == FLCARE_OK) {
+      fleet->_ok++;
+    }
+
+    if (fleet->_results != NULL) {
+      fleet->_results[i].ret = ret;
+      fleet->_results[i].data = data;
+    }
+
+    if (fleet->_cb != NULL) {
+      std::lock_guard<std::mutex> lock(fleet->_cbMutex);
+      fleet->_cb(i, sensor, ret, fleet->_cbArg);
+    }
+  }
+}
+
+/**
+ * @brief Scanner callback, dispatch the advertisement to its sensor
+ *
+ * @param addr BLE address of the advertiser
+ * @param uuid 16 bit UUID of the service data
+ * @param data service data
+ * @param len  length of data
+ * @param rssi signal strength in dBm
+ * @param arg  the fleet
+ */
+void FlowerCareFleet::onAdv(const std::string& addr, uint16_t uuid,
+                            const uint8_t* data, size_t len, int rssi,
+                            void* arg) {
+  FlowerCareFleet* fleet = (FlowerCareFleet*)arg;
+  (void)rssi;
+
+  if (uuid != MIBEACON_UUID16) {
+    return;
+  }
+
+  std::map<std::string, size_t>::iterator it =
+      fleet->_index.find(addrKey(addr));
+
+  if (it != fleet->_index.end()) {
+    fleet->_sensors[it->second]->parseAdv(data, len);
+  }
+}
@@ -0,0 +1,117 @@
+#ifndef FLOWERCARE_FLEET_H
+#define FLOWERCARE_FLEET_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "FlowerCare_BLE.h"
+#include "FlowerCare_Health.h"
+#include "FlowerCare_Readings.h"
+#include "FlowerCare_Task.h"
+
+// default number of connections in flight, the ESP32 BLE controller
+// accepts 3 connections unless configured otherwise
+#define FC_FLEET_MAXCONN 3
+// hard limit of connections in flight
+#define FC_FLEET_MAXCONN_LIMIT 9
+
+/**
+ * @brief Create a transport for one of the fleet connections
+ *
+ */
+typedef FlowerCareTransport* (*FC_TRANSPORT_FACTORY_T)(void* arg);
+
+/**
+ * @brief Called when a sensor of the sweep has been read. Calls are
+ * serialized, so the callback does not need to be thread safe
+ *
+ */
+typedef void (*FC_FLEET_CB_T)(size_t idx, FlowerCare* sensor, FC_RET_T ret,
+                              void* arg);
+
+/**
+ * @brief Result of the reading of one sensor
+ *
+ */
+typedef struct FlowerCareFleetResult {
+  FC_RET_T ret;
+  FlowerCareData_t data;
+} FlowerCareFleetResult_t;
+
+/**
+ * @brief A set of sensors read with several connections in flight.
+ * The fleet owns a pool of transports, one per connection, and lends them to
+ * the sensors while they are read, so the number of BLE clients does not
+ * grow with the number of sensors
+ */
+class FlowerCareFleet {
+ public:
+  FlowerCareFleet(uint8_t = FC_FLEET_MAXCONN, FC_TRANSPORT_FACTORY_T = NULL,
+                  void* = NULL);
+  ~FlowerCareFleet();
+
+  size_t add(FlowerCare*);
+  size_t add(std::string, Plant);
+  size_t size();
+  FlowerCare* sensor(size_t);
+  void setMaxConnections(uint8_t);
+
+  size_t sweep(FlowerCareFleetResult_t* = NULL);
+  size_t sweep(FC_FLEET_CB_T, void*);
+  size_t sweep(const std::vector<size_t>&, FC_FLEET_CB_T = NULL,
+               void* = NULL);
+
+  void setScanner(FlowerCareScanner*);
+  void setMaxAge(uint32_t);
+  size_t scan(uint32_t);
+  void setStats(FlowerCareStats*);
+  void setHandleCache(FlowerCareStore*);
+  void setHealth(FlowerCareHealth*);
+  void collect(FlowerCareReadings*, uint32_t = UINT32_MAX);
+  size_t encode(FlowerCareBatch*, uint32_t, uint32_t = UINT32_MAX);
+
+  FlowerCareFleet(const FlowerCareFleet&) = delete;
+  FlowerCareFleet& operator=(const FlowerCareFleet&) = delete;
+
+ private:
+  std::vector<FlowerCare*> _sensors; /**< Sensors, owned by the fleet */
+  uint8_t _maxConn;                  /**< Connections in flight */
+  FC_TRANSPORT_FACTORY_T _factory;   /**< Creates the pool transports */
+  void* _factoryArg;                 /**< Argument of _factory */
+  FlowerCareTransport* _pool[FC_FLEET_MAXCONN_LIMIT]; /**< One per conn */
+  FlowerCareTask _tasks[FC_FLEET_MAXCONN_LIMIT - 1];  /**< Extra workers */
+  std::map<std::string, size_t> _index; /**< Lower case address to index */
+  FlowerCareScanner* _scanner; /**< Passive scanner, not owned */
+  bool _ownScanner;            /**< true if _scanner was created by fleet */
+  uint32_t _maxAge; /**< Max age of advertised data to skip the connection */
+  FlowerCareStats* _stats; /**< Statistics of every sensor or NULL */
+  FlowerCareStore* _handleStore; /**< Handle cache of every sensor or NULL */
+  FlowerCareHealth* _health; /**< Backoff and breaker of every sensor */
+
+  // state of the running sweep
+  const std::vector<size_t>* _select; /**< Sensors to read, NULL all */
+  std::atomic<size_t> _next;        /**< Next sensor to read */
+  std::atomic<size_t> _ok;          /**< Sensors read successfully */
+  FlowerCareFleetResult_t* _results; /**< Where to store results or NULL */
+  FC_FLEET_CB_T _cb;                 /**< Completion callback or NULL */
+  void* _cbArg;                      /**< Argument of _cb */
+  std::mutex _cbMutex;               /**< Serializes _cb */
+
+  /**
+   * @brief Argument of a worker
+   *
+   */
+  typedef struct Worker {
+    FlowerCareFleet* fleet;
+    uint8_t conn;
+  } Worker_t;
+  Worker_t _workers[FC_FLEET_MAXCONN_LIMIT];
+
+  size_t run();
+  static void worker(void*);
+  static void onAdv(const std::string&, uint16_t, const uint8_t*, size_t, int,
+                    void*);
+};
+
+#endif
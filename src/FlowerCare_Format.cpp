@@ -0,0 +1,475 @@
+#include "FlowerCare_Format.h"
+
+/**
+ * @brief Bounded writer into a caller buffer, one byte is kept for the NUL
+ *
+ */
+typedef struct Writer {
+  char* buf;
+  size_t len;
+  size_t pos;
+  bool ok; /**< false once something did not fit */
+} Writer_t;
+
+static void putChar(Writer_t* w, char c) {
+  if (w->pos + 1 < w->len) {
+    w->buf[w->pos++] = c;
+  } else {
+    w->ok = false;
+  }
+}
+
+static void putStr(Writer_t* w, const char* str) {
+  while (*str) {
+    putChar(w, *str++);
+  }
+}
+
+static void putUint(Writer_t* w, uint32_t val) {
+  char digits[10];
+  int n = 0;
+
+  do {
+    digits[n++] = (char)('0' + val % 10);
+    val /= 10;
+  } while (val > 0);
+
+  while (n > 0) {
+    putChar(w, digits[--n]);
+  }
+}
+
+/**
+ * @brief Write a value given in tenths
+ *
+ * @param w        the writer
+ * @param deci     the value in tenths
+ * @param decimals 1, or 2 to add a trailing 0 like String(float)
+ */
+static void putDeci(Writer_t* w, int32_t deci, int decimals) {
+  uint32_t abs = deci < 0 ? (uint32_t)-(int64_t)deci : (uint32_t)deci;
+
+  if (deci < 0) {
+    putChar(w, '-');
+  }
+  putUint(w, abs / 10);
+  putChar(w, '.');
+  putChar(w, (char)('0' + abs % 10));
+  if (decimals > 1) {
+    putChar(w, '0');
+  }
+}
+
+/**
+ * @brief Write an id, escaped for the format
+ *
+ * @param w   the writer
+ * @param id  the id
+ * @param fmt FORMAT_JSON (string content) or FORMAT_INFLUX (tag value)
+ */
+static void putId(Writer_t* w, const char* id, FC_FORMAT_T fmt) {
+  for (; *id; id++) {
+    char c = *id;
+    if ((unsigned char)c < 0x20) {
+      continue;
+    }
+    if (fmt == FORMAT_JSON ? c == '"' || c == '\\'
+                           : c == ',' || c == ' ' || c == '=') {
+      putChar(w, '\\');
+    }
+    putChar(w, c);
+  }
+}
+
+/**
+ * @brief Write the separator and the key of a JSON or InfluxDB field
+ *
+ * @param w     the writer
+ * @param fmt   FORMAT_JSON or FORMAT_INFLUX
+ * @param key   the key
+ * @param first true for the first field, no separator
+ */
+static void putKey(Writer_t* w, FC_FORMAT_T fmt, const char* key,
+                   bool* first) {
+  if (!*first) {
+    putChar(w, ',');
+  }
+  *first = false;
+
+  if (fmt == FORMAT_JSON) {
+    putChar(w, '"');
+    putStr(w, key);
+    putStr(w, "\":");
+  } else {
+    putStr(w, key);
+    putChar(w, '=');
+  }
+}
+
+static int hexVal(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+/**
+ * @brief Parse a BLE address "xx:xx:xx:xx:xx:xx"
+ *
+ * @param id   the address
+ * @param addr where to store the 6 bytes, zeroed if id is not an address
+ */
+static void parseAddr(const char* id, uint8_t* addr) {
+  for (int i = 0; id != NULL && i < 6; i++, id += 3) {
+    int hi = hexVal(id[0]);
+    int lo = hi < 0 ? -1 : hexVal(id[1]);
+
+    if (lo < 0 || id[2] != (i < 5 ? ':' : '\0')) {
+      break;
+    }
+    addr[i] = (uint8_t)(hi << 4 | lo);
+    if (i == 5) {
+      return;
+    }
+  }
+  memset(addr, 0, 6);
+}
+
+static void put16(uint8_t* p, uint16_t val) {
+  p[0] = (uint8_t)val;
+  p[1] = (uint8_t)(val >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t val) {
+  put16(p, (uint16_t)val);
+  put16(p + 2, (uint16_t)(val >> 16));
+}
+
+static uint16_t get16(const uint8_t* p) { return p[0] | p[1] << 8; }
+
+static uint32_t get32(const uint8_t* p) {
+  return (uint32_t)get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+/**
+ * @brief Write a binary record
+ *
+ * @return FC_RECORD_LEN, 0 if buf is too small
+ */
+static size_t formatBinary(const char* id, uint32_t time,
+                           const FlowerCareReading_t& r, uint8_t fields,
+                           uint8_t* buf, size_t len) {
+  if (len < FC_RECORD_LEN) {
+    return 0;
+  }
+
+  memset(buf, 0, FC_RECORD_LEN);
+  parseAddr(id, buf);
+  buf[6] = fields & FIELD_ALL;
+  put32(buf + 8, time);
+  if (fields & FIELD_TEMP) put16(buf + 12, (uint16_t)r.temp);
+  if (fields & FIELD_MOIST) buf[14] = r.moist;
+  if (fields & FIELD_LIGHT) put32(buf + 16, r.light);
+  if (fields & FIELD_FERT) put16(buf + 20, r.fert);
+
+  return FC_RECORD_LEN;
+}
+
+/**
+ * @brief Write the dataStr() text
+ *
+ */
+static void formatText(Writer_t* w, const char* id,
+                       const FlowerCareReading_t& r, uint8_t fields) {
+  if (id != NULL && *id) {
+    putStr(w, "Sensor ");
+    putStr(w, id);
+    putChar(w, '\n');
+  }
+  if (fields & FIELD_TEMP) {
+    putStr(w, "Temperature: ");
+    putDeci(w, r.temp, 2);
+    putStr(w, "°C\n");
+  }
+  if (fields & FIELD_MOIST) {
+    putStr(w, "Moisture: ");
+    putUint(w, r.moist);
+    putStr(w, "%\n");
+  }
+  if (fields & FIELD_LIGHT) {
+    putStr(w, "Light: ");
+    putUint(w, r.light);
+    putStr(w, "lux\n");
+  }
+  if (fields & FIELD_FERT) {
+    putStr(w, "Soil EC: ");
+    putUint(w, r.fert);
+    putStr(w, "uS/cm\n");
+  }
+}
+
+/**
+ * @brief Write a JSON object or an InfluxDB line
+ *
+ */
+static void formatFields(Writer_t* w, FC_FORMAT_T fmt, const char* id,
+                         uint32_t time, const FlowerCareReading_t& r,
+                         uint8_t fields) {
+  bool json = fmt == FORMAT_JSON;
+  bool first = true;
+
+  if (json) {
+    putChar(w, '{');
+    if (id != NULL && *id) {
+      putKey(w, fmt, "sensor", &first);
+      putChar(w, '"');
+      putId(w, id, fmt);
+      putChar(w, '"');
+    }
+    if (time != 0) {
+      putKey(w, fmt, "time", &first);
+      putUint(w, time);
+    }
+  } else {
+    putStr(w, "flowercare");
+    if (id != NULL && *id) {
+      putStr(w, ",sensor=");
+      putId(w, id, fmt);
+    }
+    putChar(w, ' ');
+  }
+
+  if (fields & FIELD_TEMP) {
+    putKey(w, fmt, "temperature", &first);
+    putDeci(w, r.temp, 1);
+  }
+  if (fields & FIELD_MOIST) {
+    putKey(w, fmt, "moisture", &first);
+    putUint(w, r.moist);
+    if (!json) putChar(w, 'i');
+  }
+  if (fields & FIELD_LIGHT) {
+    putKey(w, fmt, "light", &first);
+    putUint(w, r.light);
+    if (!json) putChar(w, 'i');
+  }
+  if (fields & FIELD_FERT) {
+    putKey(w, fmt, "conductivity", &first);
+    putUint(w, r.fert);
+    if (!json) putChar(w, 'i');
+  }
+
+  if (json) {
+    putChar(w, '}');
+  } else if (time != 0) {
+    putChar(w, ' ');
+    putUint(w, time);
+  }
+}
+
+/**
+ * @brief Format a reading into a caller buffer, without heap use
+ *
+ * @param fmt     the format
+ * @param id      sensor id, its BLE address. May be NULL
+ * @param time    time of the reading in s, 0 if unknown (left out of the text
+ *                formats)
+ * @param reading the reading
+ * @param fields  FC_FIELD_T of the valid fields
+ * @param buf     where to write, FC_FORMAT_MAXLEN bytes are always enough
+ * @param len     size of buf
+ * @return the length written without the NUL, 0 if buf is too small (or for
+ *         an InfluxDB line without field)
+ */
+size_t fcFormat(FC_FORMAT_T fmt, const char* id, uint32_t time,
+                const FlowerCareReading_t& reading, uint8_t fields, char* buf,
+                size_t len) {
+  if (buf == NULL || len == 0) {
+    return 0;
+  }
+
+  if (fmt == FORMAT_BINARY) {
+    return formatBinary(id, time, reading, fields, (uint8_t*)buf, len);
+  }
+
+  Writer_t w = {buf, len, 0, true};
+
+  if (fmt == FORMAT_TEXT) {
+    formatText(&w, id, reading, fields);
+  } else if (fmt == FORMAT_JSON ||
+             (fmt == FORMAT_INFLUX && (fields & FIELD_ALL))) {
+    formatFields(&w, fmt, id, time, reading, fields);
+  } else {
+    w.ok = false;
+  }
+
+  if (!w.ok) {
+    buf[0] = '\0';
+    return 0;
+  }
+
+  buf[w.pos] = '\0';
+  return w.pos;
+}
+
+/**
+ * @brief Read a binary record, see fcFormat()
+ *
+ * @param data   the record
+ * @param len    length of data
+ * @param record where to store the content
+ * @return false if data is too short
+ */
+bool fcParseRecord(const uint8_t* data, size_t len,
+                   FlowerCareRecord_t* record) {
+  if (data == NULL || len < FC_RECORD_LEN) {
+    return false;
+  }
+
+  memcpy(record->addr, data, 6);
+  record->fields = data[6] & FIELD_ALL;
+  record->time = get32(data + 8);
+  record->reading.temp = (int16_t)get16(data + 12);
+  record->reading.moist = data[14];
+  record->reading.light = get32(data + 16);
+  record->reading.fert = get16(data + 20);
+  return true;
+}
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ * @param buf  where to pack the records, owned by the caller
+ * @param size size of buf
+ * @param fmt  format of the records
+ */
+FlowerCareBatch::FlowerCareBatch(char* buf, size_t size, FC_FORMAT_T fmt) {
+  _buf = buf;
+  _size = size;
+  _fmt = fmt;
+  clear();
+}
+
+/**
+ * @brief Append a record
+ *
+ * @param id      sensor id, its BLE address. May be NULL
+ * @param time    time of the reading in s
+ * @param reading the reading
+ * @param fields  FC_FIELD_T of the valid fields
+ * @return false if the buffer is full, the batch is left unchanged
+ */
+bool FlowerCareBatch::add(const char* id, uint32_t time,
+                          const FlowerCareReading_t& reading, uint8_t fields) {
+  size_t n;
+
+  switch (_fmt) {
+    case FORMAT_BINARY:
+      if (_size < FC_BATCH_HEADLEN || _count >= UINT16_MAX) {
+        return false;
+      }
+      n = fcFormat(_fmt, id, time, reading, fields, _buf + _len,
+                   _size - _len);
+      if (n == 0) {
+        return false;
+      }
+      _len += n;
+      put16((uint8_t*)_buf + 4, (uint16_t)(_count + 1));
+      break;
+
+    case FORMAT_JSON: {
+      // the record replaces the closing bracket, then "]" and NUL follow
+      size_t pos = _len - 1 + (_count > 0);
+      if (_size < 3 || _size - pos < 3) {
+        return false;
+      }
+      n = fcFormat(_fmt, id, time, reading, fields, _buf + pos,
+                   _size - pos - 1);
+      if (n == 0) {
+        _buf[_len - 1] = ']';
+        _buf[_len] = '\0';
+        return false;
+      }
+      if (_count > 0) {
+        _buf[_len - 1] = ',';
+      }
+      _len = pos + n + 1;
+      _buf[_len - 1] = ']';
+      _buf[_len] = '\0';
+      break;
+    }
+
+    default: {
+      // InfluxDB lines end with a newline, the text already does
+      size_t eol = _fmt == FORMAT_INFLUX;
+      if (_size - _len < 2 + eol) {
+        return false;
+      }
+      n = fcFormat(_fmt, id, time, reading, fields, _buf + _len,
+                   _size - _len - eol);
+      if (n == 0) {
+        _buf[_len] = '\0';
+        return false;
+      }
+      _len += n;
+      if (eol) {
+        _buf[_len++] = '\n';
+        _buf[_len] = '\0';
+      }
+      break;
+    }
+  }
+
+  _count++;
+  return true;
+}
+
+/**
+ * @brief Remove all records
+ *
+ */
+void FlowerCareBatch::clear() {
+  _len = 0;
+  _count = 0;
+
+  if (_fmt == FORMAT_BINARY) {
+    if (_size >= FC_BATCH_HEADLEN) {
+      _buf[0] = 'F';
+      _buf[1] = 'C';
+      _buf[2] = FC_BATCH_VERSION;
+      _buf[3] = FC_RECORD_LEN;
+      put16((uint8_t*)_buf + 4, 0);
+      _len = FC_BATCH_HEADLEN;
+    }
+  } else if (_fmt == FORMAT_JSON) {
+    if (_size >= 3) {
+      memcpy(_buf, "[]", 3);
+      _len = 2;
+    }
+  } else if (_size > 0) {
+    _buf[0] = '\0';
+  }
+}
+
+/**
+ * @brief Get the packed records
+ *
+ */
+const char* FlowerCareBatch::data() { return _buf; }
+
+/**
+ * @brief Get the length of the packed records, without the NUL of text
+ * formats
+ *
+ */
+size_t FlowerCareBatch::length() { return _len; }
+
+/**
+ * @brief Get the number of records
+ *
+ */
+size_t FlowerCareBatch::count() { return _count; }
@@ -0,0 +1,88 @@
+#ifndef FLOWERCARE_FORMAT_H
+#define FLOWERCARE_FORMAT_H
+
+/* Formatting of readings into a caller buffer, without heap use:
+ *   FORMAT_TEXT   the dataStr() text, preceded by "Sensor <id>" if id is given
+ *   FORMAT_JSON   {"sensor":"<id>","time":<s>,"temperature":21.5,...}
+ *   FORMAT_INFLUX InfluxDB line protocol, timestamp in s (precision=s)
+ *   FORMAT_BINARY FC_RECORD_LEN bytes record (little endian):
+ *     0-5   sensor BLE address, most significant byte first
+ *     6     FC_FIELD_T of the valid fields
+ *     7     reserved, 0
+ *     8-11  time, uint32, s
+ *     12-13 temperature, int16, 0.1 °C
+ *     14    moisture, uint8, %
+ *     15    reserved, 0
+ *     16-19 light, uint32, lux
+ *     20-21 fertility, uint16, us/cm
+ *     22-23 reserved, 0
+ * Text formats are NUL terminated. Missing fields are left out of the text
+ * formats and zeroed in the binary record
+ *
+ * FlowerCareBatch packs many records into one buffer: a JSON array, lines of
+ * text, or a FC_BATCH_HEADLEN bytes header ("FC", version, record length,
+ * uint16 count) followed by binary records
+ */
+
+#include "FlowerCare_Adv.h"
+#include "FlowerCare_Decode.h"
+
+// length of a binary record
+#define FC_RECORD_LEN 24
+// length of the binary batch header
+#define FC_BATCH_HEADLEN 6
+// version of the binary batch
+#define FC_BATCH_VERSION 1
+// buffer size enough for any single record with a BLE address as id
+#define FC_FORMAT_MAXLEN 160
+
+/**
+ * @brief Output formats
+ *
+ */
+enum FC_FORMAT_T {
+  FORMAT_TEXT = 0,
+  FORMAT_JSON,
+  FORMAT_INFLUX,
+  FORMAT_BINARY,
+};
+
+/**
+ * @brief Content of a binary record
+ *
+ */
+typedef struct FlowerCareRecord {
+  uint8_t addr[6];             /**< BLE address, 0 if the id was not one */
+  uint8_t fields;              /**< FC_FIELD_T of the valid fields */
+  uint32_t time;               /**< Time in s */
+  FlowerCareReading_t reading; /**< The values */
+} FlowerCareRecord_t;
+
+size_t fcFormat(FC_FORMAT_T, const char*, uint32_t, const FlowerCareReading_t&,
+                uint8_t, char*, size_t);
+bool fcParseRecord(const uint8_t*, size_t, FlowerCareRecord_t*);
+
+/**
+ * @brief Many records packed in a caller buffer, see fcFormat()
+ *
+ */
+class FlowerCareBatch {
+ public:
+  FlowerCareBatch(char*, size_t, FC_FORMAT_T = FORMAT_BINARY);
+
+  bool add(const char*, uint32_t, const FlowerCareReading_t&,
+           uint8_t = FIELD_ALL);
+  void clear();
+  const char* data();
+  size_t length();
+  size_t count();
+
+ private:
+  char* _buf;         /**< Caller buffer */
+  size_t _size;       /**< Size of _buf */
+  FC_FORMAT_T _fmt;   /**< Format of the records */
+  size_t _len;        /**< Bytes used, without the NUL of text formats */
+  size_t _count;      /**< Records in the batch */
+};
+
+#endif
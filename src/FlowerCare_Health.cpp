@@ -0,0 +1,192 @@
+#include "FlowerCare_Health.h"
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ * @param sensors number of sensors tracked, see resize()
+ */
+FlowerCareHealth::FlowerCareHealth(size_t sensors) {
+  config.retries = FC_HEALTH_RETRIES;
+  config.backoff = FC_HEALTH_BACKOFF;
+  config.backoffMax = FC_HEALTH_BACKOFF_MAX;
+  config.threshold = FC_HEALTH_THRESHOLD;
+  config.openTime = FC_HEALTH_OPEN;
+  config.probes = FC_HEALTH_PROBES;
+
+  _probes = 0;
+  resize(sensors);
+}
+
+/**
+ * @brief Set the number of sensors tracked, the new ones start healthy
+ *
+ * @param sensors number of sensors, indexed like the fleet
+ */
+void FlowerCareHealth::resize(size_t sensors) {
+  FlowerCareHealthState_t healthy = {};
+  _sensors.resize(sensors, healthy);
+}
+
+/**
+ * @brief Get the number of sensors tracked
+ *
+ */
+size_t FlowerCareHealth::size() { return _sensors.size(); }
+
+/**
+ * @brief Forget the history, every sensor healthy again
+ *
+ */
+void FlowerCareHealth::reset() {
+  for (size_t i = 0; i < _sensors.size(); i++) {
+    _sensors[i] = {};
+  }
+}
+
+/**
+ * @brief Start a sweep, resets the probe budget
+ *
+ */
+void FlowerCareHealth::begin() { _probes = 0; }
+
+/**
+ * @brief Check if a sensor can be read now, call before every reading. An
+ * open breaker turns half open once its time has elapsed, within the probe
+ * budget of the sweep
+ *
+ * @param idx index of the sensor
+ * @param now millis()
+ * @return false if the sensor must be skipped
+ */
+bool FlowerCareHealth::allow(size_t idx, uint32_t now) {
+  if (idx >= _sensors.size()) {
+    return true;
+  }
+
+  FlowerCareHealthState_t& h = _sensors[idx];
+
+  if (h.fails > 0 && (int32_t)(now - h.nextTry) < 0) {
+    h.skipped++;
+    return false;
+  }
+
+  if (h.breaker == BREAKER_OPEN) {
+    if (_probes++ >= config.probes) {
+      h.skipped++;
+      return false;
+    }
+    h.breaker = BREAKER_HALFOPEN;
+  }
+  h.tries = 0;
+
+  return true;
+}
+
+/**
+ * @brief Record the result of an attempt
+ *
+ * @param idx index of the sensor
+ * @param ret result of the attempt
+ * @param now millis() at the start of the attempt
+ * @param ms  duration of the attempt
+ * @return true to retry at once, within the retry budget
+ */
+bool FlowerCareHealth::record(size_t idx, FC_RET_T ret, uint32_t now,
+                              uint32_t ms) {
+  if (idx >= _sensors.size()) {
+    return false;
+  }
+
+  FlowerCareHealthState_t& h = _sensors[idx];
+
+  h.attempts++;
+  h.busyMs += ms;
+  h.lastRet = (int8_t)ret;
+
+  if (ret == FLCARE_OK) {
+    h.readings++;
+    h.successes++;
+    h.fails = 0;
+    h.breaker = BREAKER_CLOSED;
+    h.lastOk = now + ms;
+    return false;
+  }
+
+  // the link came up, the error is likely transient. A probe gets no retry
+  if (ret != ERR_CONNECT && h.breaker != BREAKER_HALFOPEN &&
+      h.tries < config.retries) {
+    h.tries++;
+    return true;
+  }
+
+  h.readings++;
+  if (h.fails < UINT16_MAX) {
+    h.fails++;
+  }
+
+  uint32_t wait = fcBackoff(config.backoff, h.fails, config.backoffMax);
+
+  if (h.breaker == BREAKER_HALFOPEN || h.fails >= config.threshold) {
+    h.breaker = BREAKER_OPEN;
+    wait = config.openTime;
+  }
+  h.nextTry = now + ms + wait;
+
+  return false;
+}
+
+/**
+ * @brief Get the health of a sensor
+ *
+ * @param idx index of the sensor
+ * @return the health or NULL if idx is not tracked
+ */
+const FlowerCareHealthState_t* FlowerCareHealth::get(size_t idx) {
+  return idx < _sensors.size() ? &_sensors[idx] : NULL;
+}
+
+/**
+ * @brief Get the breaker state of a sensor
+ *
+ * @param idx index of the sensor
+ */
+FC_BREAKER_T FlowerCareHealth::breaker(size_t idx) {
+  return idx < _sensors.size() ? (FC_BREAKER_T)_sensors[idx].breaker
+                               : BREAKER_CLOSED;
+}
+
+/**
+ * @brief Get the availability of a sensor
+ *
+ * @param idx index of the sensor
+ * @return successful readings over readings and skips, 1 if never read
+ */
+float FlowerCareHealth::availability(size_t idx) {
+  if (idx >= _sensors.size()) {
+    return 1;
+  }
+
+  const FlowerCareHealthState_t& h = _sensors[idx];
+  uint32_t total = h.readings + h.skipped;
+
+  return total > 0 ? (float)h.successes / total : 1;
+}
+
+/**
+ * @brief Count the sensors with the breaker not closed
+ *
+ */
+size_t FlowerCareHealth::open() {
+  size_t n = 0;
+
+  for (size_t i = 0; i < _sensors.size(); i++) {
+    if (_sensors[i].breaker != BREAKER_CLOSED) {
+      n++;
+    }
+  }
+  return n;
+}
@@ -0,0 +1,96 @@
+#ifndef FLOWERCARE_HEALTH_H
+#define FLOWERCARE_HEALTH_H
+
+/* Failure isolation for fleets. A failed reading is retried at once within a
+ * small retry budget, unless the sensor was not reachable at all: a connect
+ * timeout is the most expensive error and is not retried. After a failure the
+ * sensor waits an exponential backoff before the next attempt. After
+ * `threshold` failures in a row the circuit breaker opens and the sensor is
+ * skipped for `openTime`, then a single probe reading closes the breaker on
+ * success or opens it again. At most `probes` sensors are probed per sweep, so
+ * the number of timeouts per sweep stays bounded however many sensors are
+ * unreachable
+ */
+
+#include <atomic>
+#include <vector>
+#include "FlowerCare_Defs.h"
+
+// default immediate retries of a reading, connect failures excluded
+#define FC_HEALTH_RETRIES 1
+// default first backoff after a failure, doubled at every failure, in ms
+#define FC_HEALTH_BACKOFF 30000UL
+// default longest backoff, in ms
+#define FC_HEALTH_BACKOFF_MAX 1800000UL
+// default failures in a row opening the breaker
+#define FC_HEALTH_THRESHOLD 5
+// default time the breaker stays open before a probe, in ms
+#define FC_HEALTH_OPEN 3600000UL
+// default max probes per sweep, the others wait for the next sweep
+#define FC_HEALTH_PROBES 2
+
+/**
+ * @brief State of the circuit breaker of a sensor
+ *
+ */
+enum FC_BREAKER_T {
+  BREAKER_CLOSED = 0,  // sensor read normally, backoff after failures
+  BREAKER_OPEN,        // sensor skipped until openTime elapses
+  BREAKER_HALFOPEN,    // next reading is a probe
+};
+
+/**
+ * @brief Health configuration, times in ms
+ *
+ */
+typedef struct FlowerCareHealthConfig {
+  uint8_t retries;     /**< Immediate retries of a failed reading */
+  uint32_t backoff;    /**< First wait after a failure */
+  uint32_t backoffMax; /**< Longest wait after a failure */
+  uint8_t threshold;   /**< Failures in a row opening the breaker */
+  uint32_t openTime;   /**< Time the breaker stays open */
+  uint8_t probes;      /**< Max probes per sweep, see begin() */
+} FlowerCareHealthConfig_t;
+
+/**
+ * @brief Health and availability of one sensor
+ *
+ */
+typedef struct FlowerCareHealthState {
+  uint32_t readings;  /**< Readings done, retries not counted */
+  uint32_t successes; /**< Readings that succeeded */
+  uint32_t attempts;  /**< Attempts, retries included */
+  uint32_t skipped;   /**< Readings skipped by backoff or breaker */
+  uint32_t busyMs;    /**< Time spent on the attempts */
+  uint32_t nextTry;   /**< millis() before which the sensor is skipped */
+  uint32_t lastOk;    /**< millis() of the last success */
+  uint16_t fails;     /**< Failed readings in a row */
+  uint8_t tries;      /**< Attempts of the running reading */
+  uint8_t breaker;    /**< FC_BREAKER_T */
+  int8_t lastRet;     /**< FC_RET_T of the last attempt */
+} FlowerCareHealthState_t;
+
+class FlowerCareHealth {
+ public:
+  FlowerCareHealth(size_t = 0);
+
+  void resize(size_t);
+  size_t size();
+  void reset();
+
+  void begin();
+  bool allow(size_t, uint32_t);
+  bool record(size_t, FC_RET_T, uint32_t, uint32_t);
+  const FlowerCareHealthState_t* get(size_t);
+  FC_BREAKER_T breaker(size_t);
+  float availability(size_t);
+  size_t open();
+
+  FlowerCareHealthConfig_t config;
+
+ private:
+  std::vector<FlowerCareHealthState_t> _sensors;
+  std::atomic<uint32_t> _probes; /**< Probes allowed since begin() */
+};
+
+#endif
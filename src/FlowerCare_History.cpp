@@ -0,0 +1,245 @@
+#include <FlowerCare_BLE.h>
+
+/**
+ * @brief Get the sensor time of a history entry
+ *
+ * @param buf the entry, HISTORYDATA_LEN bytes
+ */
+static uint32_t entryTime(const uint8_t* buf) {
+  return buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t)buf[3] << 24;
+}
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Download the history entries recorded after the cursor, streaming
+ * them to cb as they are read. The cursor is advanced after every entry, so
+ * an interrupted sync resumes where it stopped
+ *
+ * @param cb         called for every entry, oldest first
+ * @param arg        argument passed to cb
+ * @param cursor     sync position, updated
+ * @param maxEntries max entries read in this connection, 0 no limit
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::syncHistory(FC_HISTORY_CB_T cb, void* arg,
+                                 FlowerCareHistoryCursor_t* cursor,
+                                 uint16_t maxEntries) {
+  if (transport() == NULL) {
+    return ERR_CONNECT;
+  }
+
+  // an open session is reused and left open
+  bool reuse = _session && _transport->isConnected();
+
+  if (!reuse && _transport->connect(_addr) != FLCARE_OK) {
+    _transport->disconnect();
+    return ERR_CONNECT;
+  }
+
+  FC_RET_T ret = readHistory(cb, arg, cursor, maxEntries);
+
+  if (!reuse) {
+    _transport->disconnect();
+  }
+
+  return ret;
+}
+
+/**
+ * @brief Download the history entries recorded after the last sync. The
+ * cursor is kept in store under the sensor address
+ *
+ * @param cb         called for every entry, oldest first
+ * @param arg        argument passed to cb
+ * @param store      where the cursor is persisted
+ * @param maxEntries max entries read in this connection, 0 no limit
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::syncHistory(FC_HISTORY_CB_T cb, void* arg,
+                                 FlowerCareStore* store, uint16_t maxEntries) {
+  FlowerCareHistoryCursor_t cursor = {};
+  char key[FC_STORE_KEYLEN + 1];
+
+  fcStoreKey('h', _addr, key);
+  store->load(key, &cursor, sizeof(cursor));
+
+  FlowerCareHistoryCursor_t start = cursor;
+  FC_RET_T ret = syncHistory(cb, arg, &cursor, maxEntries);
+
+  // save also on error, the entries delivered before it are synced
+  if (cursor.count != start.count || cursor.devTime != start.devTime) {
+    store->save(key, &cursor, sizeof(cursor));
+  }
+
+  return ret;
+}
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Read the history on an open connection, see syncHistory()
+ *
+ * @param cb         called for every entry, oldest first
+ * @param arg        argument passed to cb
+ * @param cursor     sync position, updated
+ * @param maxEntries max entries read, 0 no limit
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::readHistory(FC_HISTORY_CB_T cb, void* arg,
+                                 FlowerCareHistoryCursor_t* cursor,
+                                 uint16_t maxEntries) {
+  FC_HANDLE_T ctrl, data, devTime;
+  FC_RET_T ret;
+  uint8_t buf[HISTORYDATA_LEN];
+  size_t len;
+
+  if ((ret = _transport->getCharacteristic(HISTORY_UUID16, HISTORYCTRL_UUID16,
+                                           &ctrl)) != FLCARE_OK ||
+      (ret = _transport->getCharacteristic(HISTORY_UUID16, HISTORYDATA_UUID16,
+                                           &data)) != FLCARE_OK ||
+      (ret = _transport->getCharacteristic(HISTORY_UUID16, DEVICETIME_UUID16,
+                                           &devTime)) != FLCARE_OK) {
+    return ret;
+  }
+
+  // sensor time now, to convert entries to wall clock time
+  len = sizeof(buf);
+  if (_transport->read(devTime, buf, &len) != FLCARE_OK || len < 4) {
+    return ERR_READ;
+  }
+  time_t offset = time(NULL) - (time_t)(buf[0] | buf[1] << 8 | buf[2] << 16 |
+                                        (uint32_t)buf[3] << 24);
+
+  // enter history mode and get the number of entries
+  uint8_t cmd[3] = {0xA0, 0x00, 0x00};
+  if (_transport->write(ctrl, cmd, sizeof(cmd), true) != FLCARE_OK) {
+    return ERR_WRITE;
+  }
+
+  len = sizeof(buf);
+  if (_transport->read(data, buf, &len) != FLCARE_OK || len < 2) {
+    return ERR_READ;
+  }
+  uint16_t count = buf[0] | buf[1] << 8;
+
+  // the last synced entry moved (full ring) or is gone (history cleared)
+  if (cursor->count > 0) {
+    bool moved = cursor->count > count;
+    if (!moved) {
+      if ((ret = readHistoryEntry(ctrl, data, cursor->count - 1, buf)) !=
+          FLCARE_OK) {
+        return ret;
+      }
+      moved = entryTime(buf) != cursor->devTime;
+    }
+    if (moved &&
+        (ret = findHistoryCursor(ctrl, data, count, cursor)) != FLCARE_OK) {
+      return ret;
+    }
+  }
+
+  uint16_t end = count;
+  if (maxEntries > 0 && end - cursor->count > maxEntries) {
+    end = cursor->count + maxEntries;
+  }
+
+  for (uint16_t i = cursor->count; i < end; i++) {
+    if ((ret = readHistoryEntry(ctrl, data, i, buf)) != FLCARE_OK) {
+      return ret;
+    }
+
+    // time uint32, temp int16 0.1 °C, light uint32, moist uint8, EC uint16
+    FlowerCareHistory_t entry;
+    entry.index = i;
+    entry.devTime = entryTime(buf);
+    entry.time = offset + (time_t)entry.devTime;
+    entry.temp = (float)(int16_t)(buf[4] | buf[5] << 8) / 10;
+    entry.light =
+        (int)(buf[7] | buf[8] << 8 | buf[9] << 16 | (uint32_t)buf[10] << 24);
+    entry.moist = buf[11];
+    entry.fert = buf[12] | buf[13] << 8;
+
+    cursor->count = i + 1;
+    cursor->devTime = entry.devTime;
+
+    if (!cb(&entry, arg)) {
+      break;
+    }
+  }
+
+  return FLCARE_OK;
+}
+
+/**
+ * @brief Read one history entry, history mode must be entered
+ *
+ * @param ctrl history control handle
+ * @param data history data handle
+ * @param idx  index of the entry
+ * @param buf  where to store the entry, HISTORYDATA_LEN bytes
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::readHistoryEntry(FC_HANDLE_T ctrl, FC_HANDLE_T data,
+                                      uint16_t idx, uint8_t* buf) {
+  uint8_t cmd[3] = {0xA1, (uint8_t)idx, (uint8_t)(idx >> 8)};
+  size_t len = HISTORYDATA_LEN;
+
+  if (_transport->write(ctrl, cmd, sizeof(cmd), true) != FLCARE_OK) {
+    return ERR_WRITE;
+  }
+  if (_transport->read(data, buf, &len) != FLCARE_OK ||
+      len < HISTORYDATA_LEN) {
+    return ERR_READ;
+  }
+
+  return FLCARE_OK;
+}
+
+/**
+ * @brief Find the last synced entry after the history moved. Once the ring of
+ * the sensor is full every new entry drops the oldest one, so the synced
+ * entry moves towards 0. Entries are in time order, binary search on devTime
+ *
+ * @param ctrl   history control handle
+ * @param data   history data handle
+ * @param count  entries in the history
+ * @param cursor sync position, moved after the entry or reset if not found
+ * @return 0 on success, otherwise an error code is returned
+ */
+FC_RET_T FlowerCare::findHistoryCursor(FC_HANDLE_T ctrl, FC_HANDLE_T data,
+                                       uint16_t count,
+                                       FlowerCareHistoryCursor_t* cursor) {
+  uint8_t buf[HISTORYDATA_LEN];
+  FC_RET_T ret;
+
+  // the entry can only move back
+  uint16_t lo = 0;
+  uint16_t hi = cursor->count < count ? cursor->count : count;
+
+  while (lo < hi) {
+    uint16_t mid = lo + (hi - lo) / 2;
+    if ((ret = readHistoryEntry(ctrl, data, mid, buf)) != FLCARE_OK) {
+      return ret;
+    }
+
+    uint32_t time = entryTime(buf);
+    if (time == cursor->devTime) {
+      cursor->count = mid + 1;
+      return FLCARE_OK;
+    }
+    if (time < cursor->devTime) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  // cleared, start again
+  *cursor = {};
+  return FLCARE_OK;
+}
@@ -0,0 +1,46 @@
+#ifndef FLOWERCARE_HISTORY_H
+#define FLOWERCARE_HISTORY_H
+
+/* The sensor keeps one entry per hour, reachable through the history service
+ * 0x1206:
+ * - write 0xA00000 to 0x1a10, then 0x1a11 gives the number of entries
+ * - write 0xA1 + entry index (uint16) to 0x1a10, then 0x1a11 gives the entry
+ * - 0x1a12 gives the sensor time, seconds since the sensor epoch (last boot)
+ * Entries are indexed oldest first, new entries are appended
+ */
+
+#include <time.h>
+#include "FlowerCare_Defs.h"
+
+/**
+ * @brief Struct used to hold a history entry
+ *
+ */
+typedef struct FlowerCareHistory {
+  uint16_t index;   /**< Entry index on the sensor */
+  uint32_t devTime; /**< Sensor time of the entry, s since sensor epoch */
+  time_t time;      /**< Wall clock time of the entry */
+  float temp;
+  int moist, light, fert;
+} FlowerCareHistory_t;
+
+/**
+ * @brief Sync position, only entries after the cursor are downloaded.
+ * Zero initialized means "download everything". devTime finds the synced
+ * entry again once a full ring drops old entries, if it is gone the history
+ * was cleared and the sync starts again
+ *
+ */
+typedef struct FlowerCareHistoryCursor {
+  uint16_t count;   /**< Entries already synced */
+  uint32_t devTime; /**< Sensor time of the last synced entry */
+} FlowerCareHistoryCursor_t;
+
+/**
+ * @brief Called for every downloaded entry, oldest first
+ *
+ * @return false to stop the sync
+ */
+typedef bool (*FC_HISTORY_CB_T)(const FlowerCareHistory_t* entry, void* arg);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef ARDUINO
+
+#include "FlowerCare_Defs.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/*******************************************************************************
+ *                         HOST ARDUINO REPLACEMENTS
+ ******************************************************************************/
+
+static const std::chrono::steady_clock::time_point hostStart =
+    std::chrono::steady_clock::now();
+
+// simulated clock, see fcSimClock()
+static std::atomic<bool> simClock(false);
+static std::atomic<uint64_t> simUs(0);
+
+/**
+ * @brief Microseconds elapsed since program start on the real clock
+ *
+ */
+static uint64_t hostUs() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - hostStart)
+      .count();
+}
+
+/**
+ * @brief Switch millis(), micros() and delay() to a simulated clock. The
+ * simulated time only moves with delay(), that returns at once, so hours of
+ * schedule run in a few ms. With several threads calling delay() their waits
+ * add up, the time is exact with one thread
+ *
+ * @param enable true for the simulated clock, false for the real one
+ */
+void fcSimClock(bool enable) {
+  if (enable && !simClock) {
+    // continue from the real time, millis() never goes back
+    simUs = hostUs();
+  }
+  simClock = enable;
+}
+
+/**
+ * @brief Milliseconds elapsed since program start, like Arduino millis()
+ *
+ * @return elapsed time in ms
+ */
+unsigned long millis() {
+  return (unsigned long)((simClock ? simUs.load() : hostUs()) / 1000);
+}
+
+/**
+ * @brief Microseconds elapsed since program start, like Arduino micros()
+ *
+ * @return elapsed time in us
+ */
+unsigned long micros() {
+  return (unsigned long)(simClock ? simUs.load() : hostUs());
+}
+
+/**
+ * @brief Block the calling thread, like Arduino delay()
+ *
+ * @param ms time to wait in ms
+ */
+void delay(unsigned long ms) {
+  if (simClock) {
+    simUs += (uint64_t)ms * 1000;
+  } else if (ms > 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+}
+
+#endif
@@ -0,0 +1,201 @@
+#include "FlowerCare_Light.h"
+
+#define DAY_S 86400
+
+/**
+ * @brief Constructor
+ *
+ * @param offset local time minus UTC in s, see setDayStart()
+ * @param ppfd   PPFD in umol/m^2/s per lux, see setConversion()
+ */
+FlowerCareLight::FlowerCareLight(int32_t offset, float ppfd) {
+  _offset = offset;
+  _ppfd = ppfd;
+  reset();
+}
+
+/**
+ * @brief Set when the day starts: local midnight given as local time minus
+ * UTC, e.g. 3600 for CET. Also usable to start the day at another hour
+ *
+ * @param offset the offset in s
+ */
+void FlowerCareLight::setDayStart(int32_t offset) { _offset = offset; }
+
+/**
+ * @brief Set the lux to PPFD conversion, it depends on the light source
+ *
+ * @param ppfd PPFD in umol/m^2/s per lux
+ */
+void FlowerCareLight::setConversion(float ppfd) { _ppfd = ppfd; }
+
+/**
+ * @brief Add a light sample, O(1). The light between two samples is taken
+ * as linear, samples more than FC_LIGHT_MAXGAP apart are not joined
+ *
+ * @param time time of the sample, s since the epoch (UTC)
+ * @param lux  the light
+ */
+void FlowerCareLight::add(uint32_t time, uint32_t lux) {
+  if (!_started) {
+    _started = true;
+    _time = time;
+    _lux = lux;
+    return;
+  }
+
+  // out of order samples are dropped, a repeated time updates the value
+  if (time <= _time) {
+    if (time == _time) {
+      _lux = lux;
+    }
+    return;
+  }
+
+  bool join = time - _time <= FC_LIGHT_MAXGAP;
+
+  // split the interval at every midnight it crosses
+  while (day(_time) != day(time)) {
+    uint32_t midnight = (uint32_t)((day(_time) + 1) * DAY_S - _offset);
+    uint32_t luxMid = _lux;
+
+    if (join) {
+      luxMid = (uint32_t)(_lux + ((int64_t)lux - _lux) *
+                                     (int64_t)(midnight - _time) /
+                                     (int64_t)(time - _time));
+      integrate(midnight - _time, _lux, luxMid);
+    }
+    rollover();
+    _time = midnight;
+    _lux = luxMid;
+
+    // whole days without samples, the last one is an empty day
+    if (!join && day(_time) != day(time)) {
+      rollover();
+      _time = (uint32_t)(day(time) * DAY_S - _offset);
+    }
+  }
+
+  if (join) {
+    integrate(time - _time, _lux, lux);
+  }
+  _time = time;
+  _lux = lux;
+}
+
+/**
+ * @brief Forget everything
+ *
+ */
+void FlowerCareLight::reset() {
+  _started = false;
+  _time = 0;
+  _lux = 0;
+  _sum = 0;
+  _covered = 0;
+  _lit = 0;
+  _lastSum = 0;
+  _lastCovered = 0;
+  _lastLit = 0;
+  _hasLast = false;
+}
+
+/**
+ * @brief Get the light received since the local midnight
+ *
+ * @return DLI so far, mol/m^2
+ */
+float FlowerCareLight::today() const { return _sum * _ppfd / 1e6f; }
+
+/**
+ * @brief Get the DLI of the last complete day
+ *
+ * @return DLI in mol/m^2/day, 0 if no day has been completed
+ */
+float FlowerCareLight::lastDay() const { return _lastSum * _ppfd / 1e6f; }
+
+/**
+ * @brief Get the part of the last complete day covered by samples, the DLI of
+ * a day with holes is too low
+ *
+ * @return 0 to 1
+ */
+float FlowerCareLight::lastCoverage() const {
+  return (float)_lastCovered / DAY_S;
+}
+
+/**
+ * @brief Get the time the plant has been lit since the local midnight
+ *
+ * @return time above FC_LIGHT_LITLUX, s
+ */
+uint32_t FlowerCareLight::litTime() const { return _lit; }
+
+/**
+ * @brief Get the photoperiod of the last complete day
+ *
+ * @return time above FC_LIGHT_LITLUX, s
+ */
+uint32_t FlowerCareLight::lastLitTime() const { return _lastLit; }
+
+/**
+ * @brief Check the DLI of the last complete day
+ *
+ * @param min lower target, mol/m^2/day
+ * @param max upper target, mol/m^2/day
+ * @return 0 DLI ok or not known (no complete day covered for at least
+ *         FC_LIGHT_MINCOVER), 1 too high, -1 too low
+ */
+int FlowerCareLight::check(float min, float max) const {
+  if (!_hasLast || lastCoverage() < FC_LIGHT_MINCOVER) {
+    return 0;
+  }
+
+  float dli = lastDay();
+  return dli < min ? -1 : dli > max ? 1 : 0;
+}
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Local day of a time
+ *
+ * @param time s since the epoch
+ * @return days since the epoch, local time
+ */
+int64_t FlowerCareLight::day(uint32_t time) const {
+  int64_t local = (int64_t)time + _offset;
+  return local >= 0 ? local / DAY_S : (local - DAY_S + 1) / DAY_S;
+}
+
+/**
+ * @brief Add a linear interval to the current day
+ *
+ * @param dt   length of the interval, s
+ * @param lux0 light at the start
+ * @param lux1 light at the end
+ */
+void FlowerCareLight::integrate(uint32_t dt, uint32_t lux0, uint32_t lux1) {
+  _sum += ((uint64_t)lux0 + lux1) * dt / 2;
+  _covered += dt;
+  if ((uint64_t)lux0 + lux1 >= 2 * FC_LIGHT_LITLUX) {
+    _lit += dt;
+  }
+}
+
+/**
+ * @brief Close the current day
+ *
+ */
+void FlowerCareLight::rollover() {
+  _lastSum = _sum;
+  _lastCovered = _covered;
+  _lastLit = _lit;
+  _hasLast = true;
+
+  _sum = 0;
+  _covered = 0;
+  _lit = 0;
+}
@@ -0,0 +1,75 @@
+#ifndef FLOWERCARE_LIGHT_H
+#define FLOWERCARE_LIGHT_H
+
+/* Daily light integral (DLI): the light received by the plant over a day, in
+ * mol/m^2/day, is what matters for growth rather than single lux samples.
+ * FlowerCareLight integrates lux over irregular sample intervals (trapezoids)
+ * in O(1) per sample, splits the intervals at the local midnight and keeps
+ * the total of the current and of the last complete day.
+ * Lux are converted to PPFD (umol/m^2/s) with a fixed factor, 0.0185 for
+ * sunlight, LED grow lights are usually between 0.014 and 0.02
+ */
+
+#include "FlowerCare_Defs.h"
+
+// PPFD in umol/m^2/s per lux, sunlight
+#define FC_LIGHT_PPFD 0.0185f
+// photoperiod in hours used to derive DLI targets from lux levels
+#define FC_LIGHT_PHOTOPERIOD 12
+// samples further apart than this, in s, are not integrated (sensor offline)
+#define FC_LIGHT_MAXGAP 7200
+// lux above which the plant counts as lit, for the photoperiod
+#define FC_LIGHT_LITLUX 100
+// min fraction of a day covered by samples to check its DLI
+#define FC_LIGHT_MINCOVER 0.75f
+
+/**
+ * @brief DLI reached in a photoperiod at a constant light level
+ *
+ * @param lux the light level
+ * @return DLI in mol/m^2/day
+ */
+constexpr float fcLuxToDli(int lux) {
+  return lux * FC_LIGHT_PPFD * FC_LIGHT_PHOTOPERIOD * 3600 / 1000000;
+}
+
+/**
+ * @brief Incremental daily light integral of a sensor
+ *
+ */
+class FlowerCareLight {
+ public:
+  FlowerCareLight(int32_t = 0, float = FC_LIGHT_PPFD);
+
+  void setDayStart(int32_t);
+  void setConversion(float);
+  void add(uint32_t, uint32_t);
+  void reset();
+
+  float today() const;
+  float lastDay() const;
+  float lastCoverage() const;
+  uint32_t litTime() const;
+  uint32_t lastLitTime() const;
+  int check(float, float) const;
+
+ private:
+  int32_t _offset;   /**< Local time minus UTC at midnight, in s */
+  float _ppfd;       /**< PPFD per lux */
+  bool _started;     /**< false until the first sample */
+  uint32_t _time;    /**< Time of the last sample, s */
+  uint32_t _lux;     /**< Lux of the last sample */
+  uint64_t _sum;     /**< Integral of today, lux * s */
+  uint32_t _covered; /**< Seconds of today covered by samples */
+  uint32_t _lit;     /**< Seconds of today above FC_LIGHT_LITLUX */
+  uint64_t _lastSum;     /**< Integral of the last complete day */
+  uint32_t _lastCovered; /**< Seconds covered of the last complete day */
+  uint32_t _lastLit;     /**< Seconds lit of the last complete day */
+  bool _hasLast;         /**< true once a day has been completed */
+
+  int64_t day(uint32_t) const;
+  void integrate(uint32_t, uint32_t, uint32_t);
+  void rollover();
+};
+
+#endif
@@ -0,0 +1,335 @@
+#include "FlowerCare_Pipeline.h"
+
+static_assert(sizeof(FlowerCareItem_t) % sizeof(uint32_t) == 0,
+              "FlowerCareItem_t must be made of whole words");
+
+/**
+ * @brief Round a capacity up to a power of 2
+ *
+ * @param n the capacity
+ * @return the rounded capacity, at least 2
+ */
+static size_t roundCapacity(size_t n) {
+  size_t cap = 2;
+  while (cap < n && cap < 0x80000000UL) {
+    cap <<= 1;
+  }
+  return cap;
+}
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor, the only allocation of the ring
+ *
+ * @param capacity max readings waiting, rounded up to a power of 2
+ * @param policy   what to do when the ring is full
+ */
+FlowerCareQueue::FlowerCareQueue(size_t capacity, FC_QUEUE_POLICY_T policy)
+    : _slots(roundCapacity(capacity) * WORDS) {
+  _mask = (uint32_t)(roundCapacity(capacity) - 1);
+  _policy = policy;
+  _head = 0;
+  _tail = 0;
+  resetStats();
+}
+
+/**
+ * @brief Add a reading, producer side
+ *
+ * @param item the reading
+ * @return false if the ring is full and the policy is QUEUE_DROP
+ */
+bool FlowerCareQueue::push(const FlowerCareItem_t& item) {
+  uint32_t h = _head.load(std::memory_order_relaxed);
+  uint32_t t = _tail.load(std::memory_order_acquire);
+
+  if (h - t > _mask) {
+    if (_policy == QUEUE_DROP) {
+      bump(&_dropped);
+      return false;
+    }
+    // take the oldest slot, if the CAS fails the consumer freed it already
+    if (_tail.compare_exchange_strong(t, t + 1, std::memory_order_acq_rel)) {
+      bump(&_overwritten);
+    }
+  }
+
+  uint32_t words[WORDS];
+  std::atomic<uint32_t>* slot = &_slots[(h & _mask) * WORDS];
+
+  memcpy(words, &item, sizeof(words));
+  for (size_t i = 0; i < WORDS; i++) {
+    slot[i].store(words[i], std::memory_order_relaxed);
+  }
+  _head.store(h + 1, std::memory_order_release);
+
+  bump(&_pushed);
+  uint32_t depth = h + 1 - _tail.load(std::memory_order_relaxed);
+  if (depth > _maxDepth.load(std::memory_order_relaxed)) {
+    _maxDepth.store(depth, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+/**
+ * @brief Take the oldest reading, consumer side
+ *
+ * @param item where to store the reading
+ * @return false if the ring is empty
+ */
+bool FlowerCareQueue::pop(FlowerCareItem_t* item) {
+  uint32_t t = _tail.load(std::memory_order_acquire);
+  uint32_t words[WORDS];
+
+  for (;;) {
+    if (t == _head.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    std::atomic<uint32_t>* slot = &_slots[(t & _mask) * WORDS];
+    for (size_t i = 0; i < WORDS; i++) {
+      words[i] = slot[i].load(std::memory_order_relaxed);
+    }
+
+    // fails if the producer overwrote the slot meanwhile, t is reloaded
+    if (_tail.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel,
+                                    std::memory_order_acquire)) {
+      break;
+    }
+  }
+
+  memcpy(item, words, sizeof(words));
+  bump(&_popped);
+  return true;
+}
+
+/**
+ * @brief Get the number of readings waiting
+ *
+ */
+size_t FlowerCareQueue::depth() {
+  uint32_t t = _tail.load(std::memory_order_acquire);
+  return _head.load(std::memory_order_acquire) - t;
+}
+
+/**
+ * @brief Get the max number of readings waiting
+ *
+ */
+size_t FlowerCareQueue::capacity() { return (size_t)_mask + 1; }
+
+/**
+ * @brief Get the counters
+ *
+ * @param stats where to store the counters
+ */
+void FlowerCareQueue::stats(FlowerCareQueueStats_t* stats) {
+  stats->pushed = _pushed.load(std::memory_order_relaxed);
+  stats->popped = _popped.load(std::memory_order_relaxed);
+  stats->dropped = _dropped.load(std::memory_order_relaxed);
+  stats->overwritten = _overwritten.load(std::memory_order_relaxed);
+  stats->depth = (uint32_t)depth();
+  stats->maxDepth = _maxDepth.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Clear the counters, while producer and consumer are idle
+ *
+ */
+void FlowerCareQueue::resetStats() {
+  _pushed = 0;
+  _popped = 0;
+  _dropped = 0;
+  _overwritten = 0;
+  _maxDepth = 0;
+}
+
+/**
+ * @brief Constructor
+ *
+ * @param fleet    sensors to read, not owned
+ * @param capacity max readings waiting between the tasks
+ * @param policy   what to do when the processing falls behind
+ */
+FlowerCarePipeline::FlowerCarePipeline(FlowerCareFleet* fleet,
+                                       size_t capacity,
+                                       FC_QUEUE_POLICY_T policy)
+    : _queue(capacity, policy) {
+  _fleet = fleet;
+  _cb = NULL;
+  _cbArg = NULL;
+  _interval = FC_PIPELINE_INTERVAL;
+  _stop = false;
+  _acqDone = true;
+  _sweeps = 0;
+}
+
+/**
+ * @brief Destructor, stop the tasks
+ *
+ */
+FlowerCarePipeline::~FlowerCarePipeline() { stop(); }
+
+/**
+ * @brief Set the function called by the processing task for every reading
+ *
+ * @param cb  the callback, NULL to discard the readings
+ * @param arg argument passed to cb
+ */
+void FlowerCarePipeline::setConsumer(FC_PIPELINE_CB_T cb, void* arg) {
+  _cb = cb;
+  _cbArg = arg;
+}
+
+/**
+ * @brief Set the time between two sweeps
+ *
+ * @param interval time in ms, 0 to sweep continuously
+ */
+void FlowerCarePipeline::setInterval(uint32_t interval) {
+  _interval = interval;
+}
+
+/**
+ * @brief Start the acquisition and processing tasks
+ *
+ * @param acqCore  core of the acquisition task, -1 for any. ESP32 only
+ * @param procCore core of the processing task, -1 for any. ESP32 only
+ * @return false if already running or a task could not start
+ */
+bool FlowerCarePipeline::start(int acqCore, int procCore) {
+  if (running()) {
+    return false;
+  }
+
+  _stop = false;
+  _acqDone = false;
+
+  if (!_proc.start(process, this, "flcare_proc", procCore)) {
+    _acqDone = true;
+    return false;
+  }
+  if (!_acq.start(acquire, this, "flcare_acq", acqCore)) {
+    _acqDone = true;
+    _proc.join();
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Stop the tasks: the current sweep ends, then the readings left in
+ * the ring are processed
+ *
+ */
+void FlowerCarePipeline::stop() {
+  _stop = true;
+  _acq.join();
+  _proc.join();
+}
+
+/**
+ * @brief Check if the tasks are running
+ *
+ */
+bool FlowerCarePipeline::running() { return _acq.running() || _proc.running(); }
+
+/**
+ * @brief Get the number of sweeps done since the creation
+ *
+ */
+uint32_t FlowerCarePipeline::sweeps() { return _sweeps; }
+
+/**
+ * @brief Get the ring, for its counters
+ *
+ */
+FlowerCareQueue& FlowerCarePipeline::queue() { return _queue; }
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Count an event of the only thread writing the counter, no RMW needed
+ *
+ * @param counter the counter
+ */
+void FlowerCareQueue::bump(std::atomic<uint32_t>* counter) {
+  counter->store(counter->load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+}
+
+/**
+ * @brief Acquisition task: sweep the fleet every interval until stopped
+ *
+ * @param arg the pipeline
+ */
+void FlowerCarePipeline::acquire(void* arg) {
+  FlowerCarePipeline* p = (FlowerCarePipeline*)arg;
+
+  while (!p->_stop) {
+    p->_fleet->sweep(onRead, p);
+    p->_sweeps++;
+
+    for (uint32_t waited = 0; waited < p->_interval && !p->_stop;
+         waited += FC_PIPELINE_TICK) {
+      delay(FC_PIPELINE_TICK);
+    }
+  }
+
+  p->_acqDone = true;
+}
+
+/**
+ * @brief Processing task: hand every reading to the consumer until the
+ * acquisition is done and the ring is empty
+ *
+ * @param arg the pipeline
+ */
+void FlowerCarePipeline::process(void* arg) {
+  FlowerCarePipeline* p = (FlowerCarePipeline*)arg;
+  FlowerCareItem_t item;
+
+  for (;;) {
+    // read before pop(), every push of a finished acquisition is visible
+    bool done = p->_acqDone;
+
+    if (p->_queue.pop(&item)) {
+      if (p->_cb != NULL) {
+        p->_cb(&item, p->_cbArg);
+      }
+    } else if (done) {
+      break;
+    } else {
+      delay(FC_PIPELINE_IDLE);
+    }
+  }
+}
+
+/**
+ * @brief Sweep callback, runs on the acquisition side. The fleet serializes
+ * the calls, so there is a single producer at a time
+ *
+ * @param idx    index of the sensor
+ * @param sensor the sensor
+ * @param ret    result of the reading
+ * @param arg    the pipeline
+ */
+void FlowerCarePipeline::onRead(size_t idx, FlowerCare* sensor, FC_RET_T ret,
+                                void* arg) {
+  FlowerCarePipeline* p = (FlowerCarePipeline*)arg;
+  FlowerCareItem_t item;
+
+  item.time = (uint32_t)time(NULL);
+  item.sensor = (uint16_t)idx;
+  item.fields = ret == FLCARE_OK ? FIELD_ALL : 0;
+  item.ret = (int8_t)ret;
+  item.reading = sensor->reading();
+
+  p->_queue.push(item);
+}
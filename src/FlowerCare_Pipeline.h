@@ -0,0 +1,149 @@
+#ifndef FLOWERCARE_PIPELINE_H
+#define FLOWERCARE_PIPELINE_H
+
+/* Pipeline mode: an acquisition task, pinned to one core, sweeps a fleet and
+ * pushes every reading into a lock-free single producer / single consumer
+ * ring. A processing task on the other core pops the readings and hands them
+ * to a callback (checks, aggregation, export), so a slow export does not
+ * stall the BLE reads and the other way round. On host the tasks are threads
+ *
+ * The ring has a fixed capacity. When it is full the newest reading is
+ * dropped (QUEUE_DROP) or the oldest one is overwritten (QUEUE_OVERWRITE):
+ * the producer then takes the oldest slot from the consumer with a CAS on the
+ * read index and a consumer that was copying it retries. Slots are stored as
+ * atomic words so this race stays well defined
+ */
+
+#include <atomic>
+#include <vector>
+#include "FlowerCare_Fleet.h"
+#include "FlowerCare_Task.h"
+
+// default ring capacity, rounded up to a power of 2
+#define FC_QUEUE_DEPTH 64
+// default cores of the pipeline tasks: the ESP32 BLE stack runs on core 0,
+// the Arduino loop on core 1
+#define FC_PIPELINE_ACQCORE 0
+#define FC_PIPELINE_PROCCORE 1
+// default time between two sweeps in ms
+#define FC_PIPELINE_INTERVAL 600000UL
+// granularity of the wait between sweeps, in ms
+#define FC_PIPELINE_TICK 10
+// sleep of the processing task when the ring is empty, in ms
+#define FC_PIPELINE_IDLE 1
+
+/**
+ * @brief What to do when the ring is full
+ *
+ */
+enum FC_QUEUE_POLICY_T {
+  QUEUE_DROP = 0,   // drop the new reading
+  QUEUE_OVERWRITE,  // overwrite the oldest reading
+};
+
+/**
+ * @brief Reading passed through the ring
+ *
+ */
+typedef struct FlowerCareItem {
+  uint32_t time;               /**< time(NULL) of the reading */
+  uint16_t sensor;             /**< Index of the sensor in the fleet */
+  uint8_t fields;              /**< FC_FIELD_T of the valid fields */
+  int8_t ret;                  /**< FC_RET_T of the reading */
+  FlowerCareReading_t reading; /**< The values */
+} FlowerCareItem_t;
+
+/**
+ * @brief Counters of a ring, since its creation or resetStats()
+ *
+ */
+typedef struct FlowerCareQueueStats {
+  uint32_t pushed;      /**< Readings accepted */
+  uint32_t popped;      /**< Readings consumed */
+  uint32_t dropped;     /**< New readings dropped, QUEUE_DROP */
+  uint32_t overwritten; /**< Old readings overwritten, QUEUE_OVERWRITE */
+  uint32_t depth;       /**< Readings waiting */
+  uint32_t maxDepth;    /**< Highest depth seen by the producer */
+} FlowerCareQueueStats_t;
+
+/**
+ * @brief Bounded lock-free SPSC ring of readings. push() must be called from
+ * one producer at a time and pop() from one consumer at a time
+ *
+ */
+class FlowerCareQueue {
+ public:
+  FlowerCareQueue(size_t = FC_QUEUE_DEPTH, FC_QUEUE_POLICY_T = QUEUE_DROP);
+
+  bool push(const FlowerCareItem_t&);
+  bool pop(FlowerCareItem_t*);
+  size_t depth();
+  size_t capacity();
+  void stats(FlowerCareQueueStats_t*);
+  void resetStats();
+
+  FlowerCareQueue(const FlowerCareQueue&) = delete;
+  FlowerCareQueue& operator=(const FlowerCareQueue&) = delete;
+
+ private:
+  static const size_t WORDS = sizeof(FlowerCareItem_t) / sizeof(uint32_t);
+
+  std::vector<std::atomic<uint32_t>> _slots; /**< WORDS words per slot */
+  uint32_t _mask;                /**< Capacity - 1 */
+  FC_QUEUE_POLICY_T _policy;     /**< Policy when full */
+  std::atomic<uint32_t> _head;   /**< Write index, free running */
+  std::atomic<uint32_t> _tail;   /**< Read index, free running */
+
+  // written by the producer only
+  std::atomic<uint32_t> _pushed, _dropped, _overwritten, _maxDepth;
+  // written by the consumer only
+  std::atomic<uint32_t> _popped;
+
+  static void bump(std::atomic<uint32_t>*);
+};
+
+/**
+ * @brief Called by the processing task for every reading
+ *
+ */
+typedef void (*FC_PIPELINE_CB_T)(const FlowerCareItem_t* item, void* arg);
+
+/**
+ * @brief Acquisition and processing of a fleet on two tasks
+ *
+ */
+class FlowerCarePipeline {
+ public:
+  FlowerCarePipeline(FlowerCareFleet*, size_t = FC_QUEUE_DEPTH,
+                     FC_QUEUE_POLICY_T = QUEUE_OVERWRITE);
+  ~FlowerCarePipeline();
+
+  void setConsumer(FC_PIPELINE_CB_T, void*);
+  void setInterval(uint32_t);
+  bool start(int = FC_PIPELINE_ACQCORE, int = FC_PIPELINE_PROCCORE);
+  void stop();
+  bool running();
+  uint32_t sweeps();
+  FlowerCareQueue& queue();
+
+  FlowerCarePipeline(const FlowerCarePipeline&) = delete;
+  FlowerCarePipeline& operator=(const FlowerCarePipeline&) = delete;
+
+ private:
+  FlowerCareFleet* _fleet;      /**< Sensors, not owned */
+  FlowerCareQueue _queue;       /**< Readings from _acq to _proc */
+  FC_PIPELINE_CB_T _cb;         /**< Consumer callback or NULL */
+  void* _cbArg;                 /**< Argument of _cb */
+  uint32_t _interval;           /**< Time between sweeps in ms */
+  std::atomic<bool> _stop;      /**< Set by stop() */
+  std::atomic<bool> _acqDone;   /**< Set when _acq has pushed its last one */
+  std::atomic<uint32_t> _sweeps; /**< Sweeps done */
+  FlowerCareTask _acq;          /**< Acquisition task */
+  FlowerCareTask _proc;         /**< Processing task */
+
+  static void acquire(void*);
+  static void process(void*);
+  static void onRead(size_t, FlowerCare*, FC_RET_T, void*);
+};
+
+#endif
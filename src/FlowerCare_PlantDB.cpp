@@ -0,0 +1,457 @@
+#include "FlowerCare_PlantDB.h"
+
+#ifndef ARDUINO
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#endif
+
+// little endian readers, the records are not aligned
+static uint16_t get16(const uint8_t* p) { return p[0] | p[1] << 8; }
+
+static uint32_t get32(const uint8_t* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+// ASCII lowercase, independent of the locale so host and ESP32 sort the same
+static inline int lower(unsigned char c) {
+  return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+/**
+ * @brief Compare two names ignoring case, as ordered in the database
+ *
+ * @param a      first name
+ * @param b      second name
+ * @param prefix true to compare only the first strlen(b) chars
+ * @return <0, 0 or >0 as strcmp()
+ */
+static int nameCmp(const char* a, const char* b, bool prefix) {
+  for (;; a++, b++) {
+    if (*b == '\0' && prefix) {
+      return 0;
+    }
+
+    int ca = lower(*a);
+    int cb = lower(*b);
+    if (ca != cb || ca == '\0') {
+      return ca - cb;
+    }
+  }
+}
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor, the database is closed
+ *
+ */
+FlowerCarePlantDB::FlowerCarePlantDB() {
+  _data = NULL;
+  _len = 0;
+  _count = 0;
+  _names = NULL;
+  _mapped = false;
+}
+
+/**
+ * @brief Destructor
+ *
+ */
+FlowerCarePlantDB::~FlowerCarePlantDB() { close(); }
+
+/**
+ * @brief Use a database already in memory, e.g. a const array (kept in flash
+ * on ESP32). The data is not copied and must outlive the object. The whole
+ * database is validated, so the accessors need no further checks
+ *
+ * @param data the database
+ * @param len  length of data
+ * @return true if data holds a valid database
+ */
+bool FlowerCarePlantDB::open(const uint8_t* data, size_t len) {
+  close();
+
+  if (data == NULL || len < FC_PLANTDB_HEADLEN ||
+      memcmp(data, FC_PLANTDB_MAGIC, 4) != 0 ||
+      get16(data + 4) != FC_PLANTDB_VERSION ||
+      get16(data + 6) != FC_PLANTDB_RECLEN) {
+    return false;
+  }
+
+  uint32_t count = get32(data + 8);
+  uint32_t namesOff = get32(data + 12);
+
+  if (count > (len - FC_PLANTDB_HEADLEN) / FC_PLANTDB_RECLEN ||
+      namesOff < FC_PLANTDB_HEADLEN + (size_t)count * FC_PLANTDB_RECLEN ||
+      namesOff > len) {
+    return false;
+  }
+
+  const char* names = (const char*)data + namesOff;
+  size_t namesLen = len - namesOff;
+
+  for (uint32_t i = 0; i < count; i++) {
+    const uint8_t* rec = data + FC_PLANTDB_HEADLEN + i * FC_PLANTDB_RECLEN;
+    uint32_t off = get32(rec);
+    uint8_t nameLen = rec[4];
+
+    // name inside the names area and terminated
+    if (off >= namesLen || namesLen - off <= nameLen ||
+        names[off + nameLen] != '\0') {
+      return false;
+    }
+
+    // sorted and without duplicates, binary search relies on it
+    if (i > 0) {
+      const char* prev = names + get32(rec - FC_PLANTDB_RECLEN);
+      if (nameCmp(prev, names + off, false) >= 0) {
+        return false;
+      }
+    }
+  }
+
+  _data = data;
+  _len = len;
+  _count = count;
+  _names = names;
+
+  return true;
+}
+
+#ifdef ARDUINO
+/**
+ * @brief Use a database written to a data partition, mapped from flash
+ *
+ * @param label label of the partition, see the partition table
+ * @return true if the partition holds a valid database
+ */
+bool FlowerCarePlantDB::openPartition(const char* label) {
+  close();
+
+  const esp_partition_t* part = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+  const void* ptr;
+  spi_flash_mmap_handle_t handle;
+
+  if (part == NULL ||
+      esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &ptr,
+                         &handle) != ESP_OK) {
+    return false;
+  }
+
+  if (!open((const uint8_t*)ptr, part->size)) {
+    spi_flash_munmap(handle);
+    return false;
+  }
+
+  _mmap = handle;
+  _mapped = true;
+
+  return true;
+}
+#else
+/**
+ * @brief Use a database file, mapped in memory
+ *
+ * @param path the file
+ * @return true if the file holds a valid database
+ */
+bool FlowerCarePlantDB::openFile(const char* path) {
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  struct stat st;
+
+  if (fd < 0) {
+    return false;
+  }
+
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+
+  void* ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+
+  if (ptr == MAP_FAILED) {
+    return false;
+  }
+
+  if (!open((const uint8_t*)ptr, st.st_size)) {
+    munmap(ptr, st.st_size);
+    return false;
+  }
+
+  _mapped = true;
+
+  return true;
+}
+#endif
+
+/**
+ * @brief Release the database
+ *
+ */
+void FlowerCarePlantDB::close() {
+  if (_mapped) {
+#ifdef ARDUINO
+    spi_flash_munmap(_mmap);
+#else
+    munmap((void*)_data, _len);
+#endif
+    _mapped = false;
+  }
+
+  _data = NULL;
+  _len = 0;
+  _count = 0;
+  _names = NULL;
+}
+
+/**
+ * @brief Get the number of plants
+ *
+ * @return the number of plants, 0 when closed
+ */
+size_t FlowerCarePlantDB::size() const { return _count; }
+
+/**
+ * @brief Get the name of a plant
+ *
+ * @param i index of the plant, in name order
+ * @return the name, NULL if i is out of range
+ */
+const char* FlowerCarePlantDB::name(size_t i) const {
+  if (i >= _count) {
+    return NULL;
+  }
+
+  return _names + get32(_data + FC_PLANTDB_HEADLEN + i * FC_PLANTDB_RECLEN);
+}
+
+/**
+ * @brief Get the values of a plant
+ *
+ * @param i   index of the plant, in name order
+ * @param val where to store the values
+ * @return true if i is in range
+ */
+bool FlowerCarePlantDB::get(size_t i, PlantVal_t* val) const {
+  if (i >= _count) {
+    return false;
+  }
+
+  const uint8_t* rec = _data + FC_PLANTDB_HEADLEN + i * FC_PLANTDB_RECLEN;
+
+  val->moist_min = rec[5];
+  val->moist_max = rec[6];
+  val->temp_min = (float)(int16_t)get16(rec + 8) / 10;
+  val->temp_max = (float)(int16_t)get16(rec + 10) / 10;
+  val->fert_min = get16(rec + 12);
+  val->fert_max = get16(rec + 14);
+  val->light_min = (int)get32(rec + 16);
+  val->light_max = (int)get32(rec + 20);
+  val->dli_min = (float)get16(rec + 24) / 10;
+  val->dli_max = (float)get16(rec + 26) / 10;
+
+  return true;
+}
+
+/**
+ * @brief Look a plant up by name, ignoring case. O(log n)
+ *
+ * @param name the name
+ * @param val  where to store the values
+ * @return true if the plant exists
+ */
+bool FlowerCarePlantDB::find(const char* name, PlantVal_t* val) const {
+  size_t i = lowerBound(name, false);
+
+  return i < _count && compare(i, name, false) == 0 && get(i, val);
+}
+
+/**
+ * @brief Find the plants whose name starts with a prefix, ignoring case.
+ * They are consecutive, O(log n)
+ *
+ * @param prefix the prefix, "" matches all the plants
+ * @param first  where to store the index of the first match
+ * @return the number of matches
+ */
+size_t FlowerCarePlantDB::search(const char* prefix, size_t* first) const {
+  size_t lo = lowerBound(prefix, true);
+  size_t hi = lo;
+
+  // upper bound: first name greater than the prefix
+  size_t n = _count - lo;
+  while (n > 0) {
+    size_t half = n / 2;
+    if (compare(hi + half, prefix, true) <= 0) {
+      hi += half + 1;
+      n -= half + 1;
+    } else {
+      n = half;
+    }
+  }
+
+  *first = lo;
+  return hi - lo;
+}
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Compare the name of a record with a name or a prefix
+ *
+ * @param i      index of the record
+ * @param name   the name or prefix
+ * @param prefix true to compare only the first strlen(name) chars
+ * @return <0, 0 or >0 as strcmp()
+ */
+int FlowerCarePlantDB::compare(size_t i, const char* name, bool prefix) const {
+  return nameCmp(this->name(i), name, prefix);
+}
+
+/**
+ * @brief Find the first record not lower than a name or a prefix
+ *
+ * @param name   the name or prefix
+ * @param prefix true to compare only the first strlen(name) chars
+ * @return index of the record, size() if none
+ */
+size_t FlowerCarePlantDB::lowerBound(const char* name, bool prefix) const {
+  size_t lo = 0;
+  size_t n = _count;
+
+  while (n > 0) {
+    size_t half = n / 2;
+    if (compare(lo + half, name, prefix) < 0) {
+      lo += half + 1;
+      n -= half + 1;
+    } else {
+      n = half;
+    }
+  }
+
+  return lo;
+}
+
+#ifndef ARDUINO
+/*******************************************************************************
+ *                                  BUILDER
+ ******************************************************************************/
+
+static void put16(std::vector<uint8_t>* out, uint16_t val) {
+  out->push_back((uint8_t)val);
+  out->push_back((uint8_t)(val >> 8));
+}
+
+static void put32(std::vector<uint8_t>* out, uint32_t val) {
+  put16(out, (uint16_t)val);
+  put16(out, (uint16_t)(val >> 16));
+}
+
+// temperature or DLI in tenths, rounded
+static int32_t deci(float val) {
+  return (int32_t)(val * 10 + (val < 0 ? -0.5f : 0.5f));
+}
+
+/**
+ * @brief Build a database, used by the host tool of extras/plantdb
+ *
+ * @param plants the plants, in any order
+ * @param out    where to store the database
+ * @param err    where to store the reason of a failure, can be NULL
+ * @return true on success, false on invalid names or values
+ */
+bool fcPlantDBBuild(std::vector<FlowerCarePlantEntry_t> plants,
+                    std::vector<uint8_t>* out, std::string* err) {
+  std::string dummy;
+  std::string& why = err != NULL ? *err : dummy;
+
+  std::sort(plants.begin(), plants.end(),
+            [](const FlowerCarePlantEntry_t& a,
+               const FlowerCarePlantEntry_t& b) {
+              return nameCmp(a.name.c_str(), b.name.c_str(), false) < 0;
+            });
+
+  for (size_t i = 0; i < plants.size(); i++) {
+    const FlowerCarePlantEntry_t& p = plants[i];
+    const PlantVal_t& v = p.val;
+
+    if (p.name.empty() || p.name.size() > FC_PLANTDB_NAMELEN ||
+        p.name.find('\0') != std::string::npos) {
+      why = "invalid name \"" + p.name + "\"";
+      return false;
+    }
+    if (i > 0 && nameCmp(plants[i - 1].name.c_str(), p.name.c_str(),
+                         false) == 0) {
+      why = "duplicate name \"" + p.name + "\"";
+      return false;
+    }
+    if (v.temp_min < -3276.8f || v.temp_max > 3276.7f ||
+        v.temp_min > v.temp_max || v.moist_min < 0 || v.moist_max > 255 ||
+        v.moist_min > v.moist_max || v.fert_min < 0 || v.fert_max > 65535 ||
+        v.fert_min > v.fert_max || v.light_min < 0 ||
+        v.light_min > v.light_max || v.dli_min < 0 || v.dli_max > 6553.5f ||
+        v.dli_min > v.dli_max) {
+      why = "values out of range for \"" + p.name + "\"";
+      return false;
+    }
+  }
+
+  uint32_t namesOff = FC_PLANTDB_HEADLEN + plants.size() * FC_PLANTDB_RECLEN;
+  uint32_t nameOff = 0;
+  size_t namesLen = 0;
+
+  for (size_t i = 0; i < plants.size(); i++) {
+    namesLen += plants[i].name.size() + 1;
+  }
+
+  out->clear();
+  out->reserve(namesOff + namesLen);
+  out->insert(out->end(), FC_PLANTDB_MAGIC, FC_PLANTDB_MAGIC + 4);
+  put16(out, FC_PLANTDB_VERSION);
+  put16(out, FC_PLANTDB_RECLEN);
+  put32(out, (uint32_t)plants.size());
+  put32(out, namesOff);
+
+  for (size_t i = 0; i < plants.size(); i++) {
+    const PlantVal_t& v = plants[i].val;
+
+    put32(out, nameOff);
+    out->push_back((uint8_t)plants[i].name.size());
+    out->push_back((uint8_t)v.moist_min);
+    out->push_back((uint8_t)v.moist_max);
+    out->push_back(0);
+    put16(out, (uint16_t)deci(v.temp_min));
+    put16(out, (uint16_t)deci(v.temp_max));
+    put16(out, (uint16_t)v.fert_min);
+    put16(out, (uint16_t)v.fert_max);
+    put32(out, (uint32_t)v.light_min);
+    put32(out, (uint32_t)v.light_max);
+    put16(out, (uint16_t)deci(v.dli_min));
+    put16(out, (uint16_t)deci(v.dli_max));
+
+    nameOff += plants[i].name.size() + 1;
+  }
+
+  for (size_t i = 0; i < plants.size(); i++) {
+    const std::string& name = plants[i].name;
+    out->insert(out->end(), name.begin(), name.end());
+    out->push_back('\0');
+  }
+
+  return true;
+}
+#endif
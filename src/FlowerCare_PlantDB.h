@@ -0,0 +1,93 @@
+#ifndef FLOWERCARE_PLANTDB_H
+#define FLOWERCARE_PLANTDB_H
+
+/* External plant database in a compact binary format, used in place of the
+ * built-in profiles of Plants.h when thousands of species are needed. The
+ * file is used where it lies (flash partition, const array or mmap'd file on
+ * host), nothing is copied to RAM. Records are sorted by name, ignoring case,
+ * so lookup by name and prefix search are binary searches
+ *
+ * Format, little endian:
+ *   header   "FCDB", uint16 version, uint16 record size, uint32 count,
+ *            uint32 offset of the names
+ *   records  count x FC_PLANTDB_RECLEN bytes, sorted by name:
+ *            uint32 name offset, uint8 name length, uint8 moist min,
+ *            uint8 moist max, uint8 reserved, int16 temp min (0.1 °C),
+ *            int16 temp max, uint16 fert min, uint16 fert max,
+ *            uint32 light min, uint32 light max, uint16 DLI min
+ *            (0.1 mol/m^2/day), uint16 DLI max
+ *   names    '\0' terminated names, offsets relative to the names start
+ *
+ * Files are built on host by fcPlantDBBuild(), see extras/plantdb
+ */
+
+#include <vector>
+#include "FlowerCare_Defs.h"
+#include "FlowerCare_Profile.h"
+
+#ifdef ARDUINO
+#include <esp_partition.h>
+#endif
+
+#define FC_PLANTDB_MAGIC "FCDB"
+#define FC_PLANTDB_VERSION 2
+#define FC_PLANTDB_HEADLEN 16
+#define FC_PLANTDB_RECLEN 28
+// max name length, without terminator
+#define FC_PLANTDB_NAMELEN 255
+
+/**
+ * @brief Entry of the plant database
+ *
+ */
+typedef struct FlowerCarePlantEntry {
+  std::string name; /**< Species name */
+  PlantVal_t val;   /**< Plant values */
+} FlowerCarePlantEntry_t;
+
+/**
+ * @brief Read-only access to a plant database
+ *
+ */
+class FlowerCarePlantDB {
+ public:
+  FlowerCarePlantDB();
+  ~FlowerCarePlantDB();
+
+  FlowerCarePlantDB(const FlowerCarePlantDB&) = delete;
+  FlowerCarePlantDB& operator=(const FlowerCarePlantDB&) = delete;
+
+  bool open(const uint8_t*, size_t);
+#ifdef ARDUINO
+  bool openPartition(const char*);
+#else
+  bool openFile(const char*);
+#endif
+  void close();
+
+  size_t size() const;
+  const char* name(size_t) const;
+  bool get(size_t, PlantVal_t*) const;
+  bool find(const char*, PlantVal_t*) const;
+  size_t search(const char*, size_t*) const;
+
+ private:
+  const uint8_t* _data; /**< Start of the database, NULL when closed */
+  size_t _len;          /**< Length of the database */
+  uint32_t _count;      /**< Number of records */
+  const char* _names;   /**< Start of the names */
+#ifdef ARDUINO
+  spi_flash_mmap_handle_t _mmap; /**< Mapping of the partition */
+#endif
+  bool _mapped; /**< true if _data must be unmapped by close() */
+
+  int compare(size_t, const char*, bool) const;
+  size_t lowerBound(const char*, bool) const;
+};
+
+#ifndef ARDUINO
+bool fcPlantDBBuild(std::vector<FlowerCarePlantEntry_t>, std::vector<uint8_t>*,
+                    std::string* = NULL);
+#endif
+
+#endif
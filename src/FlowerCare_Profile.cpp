@@ -0,0 +1,3 @@
+#include "FlowerCare_Profile.h"
+
+constexpr PlantVal_t FlowerCarePlants::table[];
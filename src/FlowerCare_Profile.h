@@ -0,0 +1,119 @@
+#ifndef FLOWERCARE_PROFILE_H
+#define FLOWERCARE_PROFILE_H
+
+/* Plant profiles resolved at compile time. The levels of Plants.h are turned
+ * into thresholds by constexpr functions and every plant of PLANT_LIST gets
+ * its entry in FlowerCarePlants::table, indexed by Plant. PlantProfile and
+ * LevelProfile carry a profile as a type, for FlowerCarePlant<Profile>
+ */
+
+#include "FlowerCare_Light.h"
+#include "Plants.h"
+
+/**
+ * @brief Struct containing plant values
+ *
+ */
+typedef struct PlantVal {
+  float temp_max, temp_min;
+  int moist_max, moist_min, light_max, light_min, fert_max, fert_min;
+  float dli_max, dli_min; /**< Daily light integral, mol/m^2/day */
+} PlantVal_t;
+
+/**
+ * @brief Pick the value of a level, _ND uses the _MED value
+ *
+ * @param level the level
+ * @param low   value of _LOW
+ * @param med   value of _MED
+ * @param high  value of _HIGH
+ * @return the value of level
+ */
+constexpr int fcLevel(Level level, int low, int med, int high) {
+  return level == _LOW ? low : level == _HIGH ? high : med;
+}
+
+/**
+ * @brief Plant values of the given levels, see FlowerCare::initLevel(). The
+ * DLI targets are the light levels held for FC_LIGHT_PHOTOPERIOD hours
+ *
+ * @param temp_L  temperature level
+ * @param moist_L moisture level
+ * @param light_L light level
+ * @param fert_L  soil EC level
+ * @return the plant values
+ */
+constexpr PlantVal_t fcLevelVal(Level temp_L, Level moist_L, Level light_L,
+                                Level fert_L) {
+  return PlantVal_t{
+      (float)fcLevel(temp_L, _LOW_TEMPMAX, _MED_TEMPMAX, _HIGH_TEMPMAX),
+      (float)fcLevel(temp_L, _LOW_TEMPMIN, _MED_TEMPMIN, _HIGH_TEMPMIN),
+      fcLevel(moist_L, _LOW_MOISTMAX, _MED_MOISTMAX, _HIGH_MOISTMAX),
+      fcLevel(moist_L, _LOW_MOISTMIN, _MED_MOISTMIN, _HIGH_MOISTMIN),
+      fcLevel(light_L, _LOW_LIGHTMAX, _MED_LIGHTMAX, _HIGH_LIGHTMAX),
+      fcLevel(light_L, _LOW_LIGHTMIN, _MED_LIGHTMIN, _HIGH_LIGHTMIN),
+      fcLevel(fert_L, _LOW_FERTMAX, _MED_FERTMAX, _HIGH_FERTMAX),
+      fcLevel(fert_L, _LOW_FERTMIN, _MED_FERTMIN, _HIGH_FERTMIN),
+      fcLuxToDli(
+          fcLevel(light_L, _LOW_LIGHTMAX, _MED_LIGHTMAX, _HIGH_LIGHTMAX)),
+      fcLuxToDli(
+          fcLevel(light_L, _LOW_LIGHTMIN, _MED_LIGHTMIN, _HIGH_LIGHTMIN))};
+}
+
+/**
+ * @brief Compare a value with a range, without branches
+ *
+ * @param val the value
+ * @param min lower limit
+ * @param max upper limit
+ * @return 0 in range, 1 above max, -1 below min
+ */
+template <typename T>
+constexpr int fcCheck(T val, T min, T max) {
+  return (int)(val > max) - (int)(val < min);
+}
+
+#define PLANT_TABLE(name) fcLevelVal(name##_VAL),
+
+/**
+ * @brief Profile table of all the plants, indexed by Plant
+ *
+ */
+struct FlowerCarePlants {
+  static constexpr PlantVal_t table[] = {
+      // FICUS_GINSEGN, test plant
+      {30.0, 15.0, 30, 15, 2000, 1000, 600, 300, fcLuxToDli(2000),
+       fcLuxToDli(1000)},
+      PLANT_LIST(PLANT_TABLE)};
+};
+
+static_assert(sizeof(FlowerCarePlants::table) / sizeof(PlantVal_t) ==
+                  PLANT_COUNT,
+              "profile table does not match the Plant enum");
+
+/**
+ * @brief Profile of a plant as a type
+ *
+ */
+template <Plant P>
+struct PlantProfile {
+  static_assert(P >= 0 && P < PLANT_COUNT, "unknown plant");
+  static constexpr PlantVal_t val = FlowerCarePlants::table[P];
+};
+
+template <Plant P>
+constexpr PlantVal_t PlantProfile<P>::val;
+
+/**
+ * @brief Profile of the given levels as a type
+ *
+ */
+template <Level T, Level M, Level L, Level F>
+struct LevelProfile {
+  static constexpr PlantVal_t val = fcLevelVal(T, M, L, F);
+};
+
+template <Level T, Level M, Level L, Level F>
+constexpr PlantVal_t LevelProfile<T, M, L, F>::val;
+
+#endif
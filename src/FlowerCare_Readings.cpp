@@ -0,0 +1,360 @@
+#include "FlowerCare_Readings.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// temperature in 0.1 °C, rounded
+static int16_t deci(float temp) {
+  return (int16_t)(temp * 10 + (temp < 0 ? -0.5f : 0.5f));
+}
+
+/**
+ * @brief Pack 32 bytes of 0/1 into bits
+ *
+ * @param bytes the bytes
+ * @return bit j set if bytes[j] is 1
+ */
+static inline uint32_t pack32(const uint8_t* bytes) {
+#if defined(__SSE2__)
+  // move the 0/1 of every byte to its top bit and collect the top bits
+  __m128i lo = _mm_loadu_si128((const __m128i*)bytes);
+  __m128i hi = _mm_loadu_si128((const __m128i*)(bytes + 16));
+  return (uint32_t)_mm_movemask_epi8(_mm_slli_epi16(lo, 7)) |
+         (uint32_t)_mm_movemask_epi8(_mm_slli_epi16(hi, 7)) << 16;
+#else
+  // 8 bytes at a time, the multiplication moves byte j to bit 56 + j
+  uint32_t bits = 0;
+  for (size_t i = 0; i < 4; i++) {
+    uint64_t x;
+    memcpy(&x, bytes + i * 8, 8);
+    bits |= (uint32_t)((x * 0x0102040810204080ULL) >> 56) << (i * 8);
+  }
+  return bits;
+#endif
+}
+
+/**
+ * @brief Bitmap of a[i] < b[i], n multiple of 32. The comparisons of a word
+ * are a fixed count loop without branches, which the compiler vectorizes
+ *
+ * @param a     first array
+ * @param b     second array
+ * @param mask  bitmap to AND the result with
+ * @param words where to store the bitmap, n / 32 words
+ * @param n     length of the arrays
+ */
+template <typename T>
+static void lessThan(const T* __restrict__ a, const T* __restrict__ b,
+                     const uint32_t* mask, uint32_t* words, size_t n) {
+  for (size_t w = 0; w < n / 32; w++) {
+    uint8_t lt[32];
+
+    for (size_t j = 0; j < 32; j++) {
+      lt[j] = a[w * 32 + j] < b[w * 32 + j];
+    }
+    words[w] = pack32(lt) & mask[w];
+  }
+}
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ * @param size number of sensors, bounds all 0 until set by setPlant()
+ */
+FlowerCareReadings::FlowerCareReadings(size_t size) {
+  _size = 0;
+  _cap = 0;
+  resize(size);
+}
+
+/**
+ * @brief Add a sensor, without values
+ *
+ * @param plant bounds of the sensor
+ * @return index of the sensor
+ */
+size_t FlowerCareReadings::add(const PlantVal_t& plant) {
+  size_t idx = _size;
+
+  resize(_size + 1);
+  setPlant(idx, plant);
+
+  return idx;
+}
+
+/**
+ * @brief Set the number of sensors. New sensors have no values and bounds 0
+ *
+ * @param size number of sensors
+ */
+void FlowerCareReadings::resize(size_t size) {
+  size_t cap = (size + 31) & ~(size_t)31;
+
+  // sensors dropped by a shrink must not come back with old values or bounds
+  for (size_t i = size; i < _size; i++) {
+    invalidate(i);
+    _tempMin[i] = _tempMax[i] = 0;
+    _moistMin[i] = _moistMax[i] = 0;
+    _lightMin[i] = _lightMax[i] = 0;
+    _fertMin[i] = _fertMax[i] = 0;
+  }
+
+  if (cap != _cap) {
+    std::vector<int16_t>* i16[] = {&_temp,  &_tempMin,  &_tempMax,
+                                   &_moist, &_moistMin, &_moistMax};
+    std::vector<int32_t>* i32[] = {&_light, &_lightMin, &_lightMax,
+                                   &_fert,  &_fertMin,  &_fertMax};
+
+    for (size_t i = 0; i < 6; i++) {
+      i16[i]->resize(cap, 0);
+      i32[i]->resize(cap, 0);
+    }
+    for (size_t m = 0; m < FC_METRICS; m++) {
+      _low[m].resize(cap / 32, 0);
+      _high[m].resize(cap / 32, 0);
+      _valid[m].resize(cap / 32, 0);
+    }
+    _cap = cap;
+  }
+
+  _size = size;
+}
+
+/**
+ * @brief Get the number of sensors
+ *
+ * @return the number of sensors
+ */
+size_t FlowerCareReadings::size() const { return _size; }
+
+/**
+ * @brief Get the number of words of the bitmaps
+ *
+ * @return (size() + 31) / 32
+ */
+size_t FlowerCareReadings::words() const { return _cap / 32; }
+
+/**
+ * @brief Set the bounds of a sensor
+ *
+ * @param idx   index of the sensor
+ * @param plant the bounds
+ */
+void FlowerCareReadings::setPlant(size_t idx, const PlantVal_t& plant) {
+  if (idx >= _size) {
+    return;
+  }
+
+  _tempMin[idx] = deci(plant.temp_min);
+  _tempMax[idx] = deci(plant.temp_max);
+  _moistMin[idx] = (int16_t)plant.moist_min;
+  _moistMax[idx] = (int16_t)plant.moist_max;
+  _lightMin[idx] = plant.light_min;
+  _lightMax[idx] = plant.light_max;
+  _fertMin[idx] = plant.fert_min;
+  _fertMax[idx] = plant.fert_max;
+}
+
+/**
+ * @brief Set the values of a sensor
+ *
+ * @param idx     index of the sensor
+ * @param reading the values
+ * @param fields  FC_FIELD_T of the values to set
+ */
+void FlowerCareReadings::set(size_t idx, const FlowerCareReading_t& reading,
+                             uint8_t fields) {
+  set(idx, (float)reading.temp / 10, reading.moist, (int)reading.light,
+      reading.fert, fields);
+}
+
+/**
+ * @brief Set the values of a sensor
+ *
+ * @param idx    index of the sensor
+ * @param temp   temperature in °C
+ * @param moist  moisture in %
+ * @param light  light in lux
+ * @param fert   fertility in us/cm
+ * @param fields FC_FIELD_T of the values to set
+ */
+void FlowerCareReadings::set(size_t idx, float temp, int moist, int light,
+                             int fert, uint8_t fields) {
+  if (idx >= _size) {
+    return;
+  }
+
+  if (fields & FIELD_TEMP) {
+    _temp[idx] = deci(temp);
+  }
+  if (fields & FIELD_MOIST) {
+    _moist[idx] = (int16_t)moist;
+  }
+  if (fields & FIELD_LIGHT) {
+    _light[idx] = light;
+  }
+  if (fields & FIELD_FERT) {
+    _fert[idx] = fert;
+  }
+
+  setValid(idx, fields, true);
+}
+
+/**
+ * @brief Forget values of a sensor, they are no longer reported
+ *
+ * @param idx    index of the sensor
+ * @param fields FC_FIELD_T of the values to forget
+ */
+void FlowerCareReadings::invalidate(size_t idx, uint8_t fields) {
+  if (idx < _size) {
+    setValid(idx, fields, false);
+  }
+}
+
+/**
+ * @brief Compare every value with its bounds and update the bitmaps. For each
+ * metric and bound one pass over the contiguous arrays, 32 sensors at a time:
+ * vectorized comparisons, then the results are packed (SSE2 on host when
+ * available)
+ *
+ */
+void FlowerCareReadings::evaluateAll() {
+  lessThan(_temp.data(), _tempMin.data(), _valid[0].data(), _low[0].data(),
+           _cap);
+  lessThan(_tempMax.data(), _temp.data(), _valid[0].data(), _high[0].data(),
+           _cap);
+
+  lessThan(_moist.data(), _moistMin.data(), _valid[1].data(), _low[1].data(),
+           _cap);
+  lessThan(_moistMax.data(), _moist.data(), _valid[1].data(),
+           _high[1].data(), _cap);
+
+  lessThan(_light.data(), _lightMin.data(), _valid[2].data(), _low[2].data(),
+           _cap);
+  lessThan(_lightMax.data(), _light.data(), _valid[2].data(),
+           _high[2].data(), _cap);
+
+  lessThan(_fert.data(), _fertMin.data(), _valid[3].data(), _low[3].data(),
+           _cap);
+  lessThan(_fertMax.data(), _fert.data(), _valid[3].data(), _high[3].data(),
+           _cap);
+}
+
+/**
+ * @brief Get the below min bitmap of a metric, see evaluateAll()
+ *
+ * @param field the metric, a single FC_FIELD_T
+ * @return words() words
+ */
+const uint32_t* FlowerCareReadings::low(FC_FIELD_T field) const {
+  return _low[metric(field)].data();
+}
+
+/**
+ * @brief Get the above max bitmap of a metric, see evaluateAll()
+ *
+ * @param field the metric, a single FC_FIELD_T
+ * @return words() words
+ */
+const uint32_t* FlowerCareReadings::high(FC_FIELD_T field) const {
+  return _high[metric(field)].data();
+}
+
+/**
+ * @brief Get the bitmap of the sensors with a value for a metric
+ *
+ * @param field the metric, a single FC_FIELD_T
+ * @return words() words
+ */
+const uint32_t* FlowerCareReadings::valid(FC_FIELD_T field) const {
+  return _valid[metric(field)].data();
+}
+
+/**
+ * @brief Get the sensors with at least one metric out of range
+ *
+ * @param word word of the bitmaps, sensors word * 32 to word * 32 + 31
+ * @return bit set for every sensor in alert
+ */
+uint32_t FlowerCareReadings::alerts(size_t word) const {
+  if (word >= words()) {
+    return 0;
+  }
+
+  uint32_t bits = 0;
+  for (size_t m = 0; m < FC_METRICS; m++) {
+    bits |= _low[m][word] | _high[m][word];
+  }
+  return bits;
+}
+
+/**
+ * @brief Get the status of a metric of a sensor, as FlowerCare::checkTemp()
+ *
+ * @param idx   index of the sensor
+ * @param field the metric, a single FC_FIELD_T
+ * @return 0 ok or no value, 1 too high, -1 too low
+ */
+int FlowerCareReadings::status(size_t idx, FC_FIELD_T field) const {
+  if (idx >= _size) {
+    return 0;
+  }
+
+  size_t m = metric(field);
+  uint32_t bit = 1u << (idx % 32);
+
+  return (int)((_high[m][idx / 32] & bit) != 0) -
+         (int)((_low[m][idx / 32] & bit) != 0);
+}
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Index of the arrays of a metric
+ *
+ * @param field a single FC_FIELD_T
+ * @return 0 temp, 1 moist, 2 light, 3 fert
+ */
+size_t FlowerCareReadings::metric(FC_FIELD_T field) {
+  switch (field) {
+    case FIELD_MOIST:
+      return 1;
+    case FIELD_LIGHT:
+      return 2;
+    case FIELD_FERT:
+      return 3;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * @brief Update the valid bitmaps of a sensor
+ *
+ * @param idx    index of the sensor
+ * @param fields FC_FIELD_T of the metrics
+ * @param valid  new state
+ */
+void FlowerCareReadings::setValid(size_t idx, uint8_t fields, bool valid) {
+  uint32_t bit = 1u << (idx % 32);
+
+  for (size_t m = 0; m < FC_METRICS; m++) {
+    if (fields & (1 << m)) {
+      if (valid) {
+        _valid[m][idx / 32] |= bit;
+      } else {
+        _valid[m][idx / 32] &= ~bit;
+        _low[m][idx / 32] &= ~bit;
+        _high[m][idx / 32] &= ~bit;
+      }
+    }
+  }
+}
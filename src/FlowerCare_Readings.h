@@ -0,0 +1,66 @@
+#ifndef FLOWERCARE_READINGS_H
+#define FLOWERCARE_READINGS_H
+
+/* Readings and thresholds of many sensors in struct-of-arrays layout: one
+ * contiguous array per metric and per bound, in fixed point. evaluateAll()
+ * compares every sensor with its bounds in one pass without branches and packs
+ * the result in bitmaps, 32 sensors per word:
+ *   low(metric)[w]  bit set if the value is below the min
+ *   high(metric)[w] bit set if the value is above the max
+ * both clear means ok or no value, see valid(). Sensor i is bit i % 32 of
+ * word i / 32
+ */
+
+#include <vector>
+#include "FlowerCare_Adv.h"
+#include "FlowerCare_Decode.h"
+#include "FlowerCare_Profile.h"
+
+// number of metrics: temp, moist, light, fert
+#define FC_METRICS 4
+
+/**
+ * @brief Fleet readings in struct-of-arrays layout
+ *
+ */
+class FlowerCareReadings {
+ public:
+  FlowerCareReadings(size_t = 0);
+
+  size_t add(const PlantVal_t&);
+  void resize(size_t);
+  size_t size() const;
+  size_t words() const;
+
+  void setPlant(size_t, const PlantVal_t&);
+  void set(size_t, const FlowerCareReading_t&, uint8_t = FIELD_ALL);
+  void set(size_t, float, int, int, int, uint8_t = FIELD_ALL);
+  void invalidate(size_t, uint8_t = FIELD_ALL);
+
+  void evaluateAll();
+
+  const uint32_t* low(FC_FIELD_T) const;
+  const uint32_t* high(FC_FIELD_T) const;
+  const uint32_t* valid(FC_FIELD_T) const;
+  uint32_t alerts(size_t) const;
+  int status(size_t, FC_FIELD_T) const;
+
+ private:
+  size_t _size; /**< Number of sensors */
+  size_t _cap;  /**< Array length, multiple of 32 */
+
+  // values and bounds, padding entries are 0 (never out of range)
+  std::vector<int16_t> _temp, _tempMin, _tempMax;    /**< 0.1 °C */
+  std::vector<int16_t> _moist, _moistMin, _moistMax; /**< % */
+  std::vector<int32_t> _light, _lightMin, _lightMax; /**< lux */
+  std::vector<int32_t> _fert, _fertMin, _fertMax;    /**< us/cm */
+
+  std::vector<uint32_t> _low[FC_METRICS];   /**< Below min bitmaps */
+  std::vector<uint32_t> _high[FC_METRICS];  /**< Above max bitmaps */
+  std::vector<uint32_t> _valid[FC_METRICS]; /**< Has a value bitmaps */
+
+  static size_t metric(FC_FIELD_T);
+  void setValid(size_t, uint8_t, bool);
+};
+
+#endif
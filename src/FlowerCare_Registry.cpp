@@ -0,0 +1,357 @@
+#include "FlowerCare_Registry.h"
+
+/**
+ * @brief Header of the saved registry, followed by FC_REGISTRY_MAX entries
+ *
+ */
+typedef struct RegHeader {
+  uint8_t version;   /**< FC_REGISTRY_VERSION */
+  uint8_t count;     /**< Valid entries */
+  uint16_t entryLen; /**< sizeof(FlowerCareRegEntry_t) */
+} RegHeader_t;
+
+// size of the saved registry, fixed so a load can check it
+#define REGISTRY_LEN \
+  (sizeof(RegHeader_t) + FC_REGISTRY_MAX * sizeof(FlowerCareRegEntry_t))
+
+static char lower(char c) { return c >= 'A' && c <= 'Z' ? c + 'a' - 'A' : c; }
+
+/**
+ * @brief Compare BLE addresses, libraries differ on the case
+ *
+ * @param a first address
+ * @param b second address
+ * @return true if equal
+ */
+static bool sameAddr(const char* a, const std::string& b) {
+  size_t i = 0;
+  for (; i < b.size(); i++) {
+    if (lower(a[i]) != lower(b[i])) {
+      return false;
+    }
+  }
+  return a[i] == '\0';
+}
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ * @param store where to save the registry, not owned. NULL to keep it in RAM
+ */
+FlowerCareRegistry::FlowerCareRegistry(FlowerCareStore* store) {
+  _store = store;
+  _scanner = NULL;
+  _found = 0;
+  _dirty = false;
+  _entries.reserve(FC_REGISTRY_MAX);
+}
+
+/**
+ * @brief Destructor
+ *
+ */
+FlowerCareRegistry::~FlowerCareRegistry() { delete _scanner; }
+
+/**
+ * @brief Scan for Flower Care sensors and add the new ones to the registry.
+ * The RSSI and last seen time of the known ones are refreshed
+ *
+ * @param ms      scan window in ms
+ * @param scanner scanner to use. If NULL on ESP32 a BLE scanner is created,
+ *                on host it must be given
+ * @return the number of new sensors
+ */
+size_t FlowerCareRegistry::discover(uint32_t ms, FlowerCareScanner* scanner) {
+  if (scanner == NULL) {
+#ifdef ARDUINO
+    if (_scanner == NULL) {
+      _scanner = new FlowerCareESP32Scanner();
+    }
+    scanner = _scanner;
+#else
+    return 0;
+#endif
+  }
+
+  _found = 0;
+  if (scanner->scan(ms, onAdv, this) != FLCARE_OK) {
+    return 0;
+  }
+
+  commit();
+  return _found;
+}
+
+/**
+ * @brief Restore the registry saved by save()
+ *
+ * @return false if there is no store or no valid saved registry, the
+ *         registry is then left unchanged
+ */
+bool FlowerCareRegistry::load() {
+  if (_store == NULL) {
+    return false;
+  }
+
+  std::vector<uint8_t> buf(REGISTRY_LEN);
+  RegHeader_t head;
+
+  if (!_store->load(FC_REGISTRY_KEY, buf.data(), buf.size())) {
+    return false;
+  }
+
+  memcpy(&head, buf.data(), sizeof(head));
+  if (head.version != FC_REGISTRY_VERSION ||
+      head.entryLen != sizeof(FlowerCareRegEntry_t) ||
+      head.count > FC_REGISTRY_MAX) {
+    return false;
+  }
+
+  _entries.resize(head.count);
+  for (size_t i = 0; i < head.count; i++) {
+    FlowerCareRegEntry_t& e = _entries[i];
+    memcpy(&e, buf.data() + sizeof(head) + i * sizeof(e), sizeof(e));
+    e.addr[sizeof(e.addr) - 1] = '\0';
+    e.firmware[sizeof(e.firmware) - 1] = '\0';
+  }
+
+  _dirty = false;
+  return true;
+}
+
+/**
+ * @brief Save the registry. Called by the methods changing it, only when
+ * something worth a flash write changed (not RSSI or last seen time)
+ *
+ * @return false if there is no store or the write failed
+ */
+bool FlowerCareRegistry::save() {
+  if (_store == NULL) {
+    return false;
+  }
+
+  std::vector<uint8_t> buf(REGISTRY_LEN, 0);
+  RegHeader_t head = {FC_REGISTRY_VERSION, (uint8_t)_entries.size(),
+                      (uint16_t)sizeof(FlowerCareRegEntry_t)};
+
+  memcpy(buf.data(), &head, sizeof(head));
+  if (!_entries.empty()) {
+    memcpy(buf.data() + sizeof(head), _entries.data(),
+           _entries.size() * sizeof(FlowerCareRegEntry_t));
+  }
+
+  if (!_store->save(FC_REGISTRY_KEY, buf.data(), buf.size())) {
+    return false;
+  }
+
+  _dirty = false;
+  return true;
+}
+
+/**
+ * @brief Get the number of known sensors
+ *
+ */
+size_t FlowerCareRegistry::size() { return _entries.size(); }
+
+/**
+ * @brief Get a known sensor
+ *
+ * @param idx 0 to size() - 1
+ * @return the entry or NULL if idx is not valid
+ */
+const FlowerCareRegEntry_t* FlowerCareRegistry::get(size_t idx) {
+  return idx < _entries.size() ? &_entries[idx] : NULL;
+}
+
+/**
+ * @brief Find a sensor
+ *
+ * @param addr BLE address, any case
+ * @return the index or -1
+ */
+int FlowerCareRegistry::find(const std::string& addr) {
+  for (size_t i = 0; i < _entries.size(); i++) {
+    if (sameAddr(_entries[i].addr, addr)) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+/**
+ * @brief Add a sensor by hand, e.g. one out of range during discover(). Saved
+ * at once, like the other changes
+ *
+ * @param addr BLE address
+ * @param rssi RSSI in dBm, 0 if unknown
+ * @return the index, -1 if the registry is full or addr is not valid
+ */
+int FlowerCareRegistry::add(const std::string& addr, int rssi) {
+  int idx = insert(addr, rssi);
+
+  commit();
+  return idx;
+}
+
+/**
+ * @brief Forget a sensor
+ *
+ * @param addr BLE address
+ * @return false if the sensor is not known
+ */
+bool FlowerCareRegistry::remove(const std::string& addr) {
+  int idx = find(addr);
+
+  if (idx < 0) {
+    return false;
+  }
+
+  _entries.erase(_entries.begin() + idx);
+  _dirty = true;
+  commit();
+  return true;
+}
+
+/**
+ * @brief Assign a plant to a sensor
+ *
+ * @param addr  BLE address
+ * @param plant the plant
+ * @return false if the sensor is not known
+ */
+bool FlowerCareRegistry::setPlant(const std::string& addr, Plant plant) {
+  int idx = find(addr);
+
+  if (idx < 0) {
+    return false;
+  }
+
+  if (_entries[idx].plant != (uint8_t)plant) {
+    _entries[idx].plant = (uint8_t)plant;
+    _dirty = true;
+  }
+  commit();
+  return true;
+}
+
+/**
+ * @brief Copy what a sensor learned on its connections (firmware version)
+ *
+ * @param sensor the sensor, e.g. after getDataExt()
+ * @return false if the sensor is not known
+ */
+bool FlowerCareRegistry::update(FlowerCare* sensor) {
+  int idx = find(sensor->addr());
+
+  if (idx < 0) {
+    return false;
+  }
+
+  FlowerCareRegEntry_t& e = _entries[idx];
+  const char* fw = sensor->firmware();
+
+  if (fw[0] != '\0' && strncmp(e.firmware, fw, sizeof(e.firmware)) != 0) {
+    strncpy(e.firmware, fw, sizeof(e.firmware) - 1);
+    _dirty = true;
+  }
+  commit();
+  return true;
+}
+
+/**
+ * @brief Add every known sensor to a fleet
+ *
+ * @param fleet the fleet
+ * @param plant plant of the sensors without assigned plant
+ * @return the number of sensors added
+ */
+size_t FlowerCareRegistry::addTo(FlowerCareFleet* fleet, Plant plant) {
+  for (size_t i = 0; i < _entries.size(); i++) {
+    const FlowerCareRegEntry_t& e = _entries[i];
+    fleet->add(e.addr, e.plant < PLANT_COUNT ? (Plant)e.plant : plant);
+  }
+  return _entries.size();
+}
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Add a sensor without saving, discover() adds many sensors and saves
+ * once
+ *
+ * @param addr BLE address
+ * @param rssi RSSI in dBm, 0 if unknown
+ * @return the index, -1 if the registry is full or addr is not valid
+ */
+int FlowerCareRegistry::insert(const std::string& addr, int rssi) {
+  int idx = find(addr);
+
+  if (idx >= 0) {
+    return idx;
+  }
+
+  FlowerCareRegEntry_t e = {};
+  if (_entries.size() >= FC_REGISTRY_MAX || addr.empty() ||
+      addr.size() >= sizeof(e.addr)) {
+    return -1;
+  }
+
+  memcpy(e.addr, addr.data(), addr.size());
+  e.rssi = (int8_t)rssi;
+  e.plant = FC_PLANT_NONE;
+  _entries.push_back(e);
+  _dirty = true;
+
+  return (int)_entries.size() - 1;
+}
+
+/**
+ * @brief Save if something changed and there is a store
+ *
+ */
+void FlowerCareRegistry::commit() {
+  if (_dirty && _store != NULL) {
+    save();
+  }
+}
+
+/**
+ * @brief Scanner callback, register the Flower Care advertisers
+ *
+ * @param addr BLE address of the advertiser
+ * @param uuid 16 bit UUID of the service data
+ * @param data service data
+ * @param len  length of data
+ * @param rssi signal strength in dBm
+ * @param arg  the registry
+ */
+void FlowerCareRegistry::onAdv(const std::string& addr, uint16_t uuid,
+                               const uint8_t* data, size_t len, int rssi,
+                               void* arg) {
+  FlowerCareRegistry* reg = (FlowerCareRegistry*)arg;
+
+  // frame control, product id: present in every frame, even encrypted ones
+  if (uuid != MIBEACON_UUID16 || len < 4 ||
+      (data[2] | data[3] << 8) != MIBEACON_FLOWERCARE) {
+    return;
+  }
+
+  int idx = reg->find(addr);
+  if (idx < 0) {
+    idx = reg->insert(addr, rssi);
+    if (idx < 0) {
+      return;
+    }
+    reg->_found++;
+  }
+
+  reg->_entries[idx].rssi = (int8_t)rssi;
+  reg->_entries[idx].seen = (uint32_t)time(NULL);
+}
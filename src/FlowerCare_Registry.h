@@ -0,0 +1,76 @@
+#ifndef FLOWERCARE_REGISTRY_H
+#define FLOWERCARE_REGISTRY_H
+
+/* Discovery of the sensors in range and registry of the known ones, so the
+ * addresses do not have to be hard-coded. Flower Care sensors are recognized
+ * by the product id of their MiBeacon service data. The registry (address,
+ * RSSI, firmware, assigned plant) is saved to a FlowerCareStore, after a
+ * reboot load() restores it and polling resumes without scanning
+ */
+
+#include <vector>
+#include "FlowerCare_Fleet.h"
+#include "FlowerCare_Store.h"
+
+// max number of sensors in the registry
+#define FC_REGISTRY_MAX 32
+// default scan window of discover() in ms
+#define FC_DISCOVERY_MS 5000
+// assigned plant of a sensor without plant
+#define FC_PLANT_NONE 0xFF
+// store key of the registry
+#define FC_REGISTRY_KEY "registry"
+// version of the saved registry, bumped when FlowerCareRegEntry_t changes
+#define FC_REGISTRY_VERSION 1
+
+/**
+ * @brief A known sensor
+ *
+ */
+typedef struct FlowerCareRegEntry {
+  char addr[18];                  /**< BLE address, as advertised */
+  int8_t rssi;                    /**< Last RSSI in dBm */
+  uint8_t plant;                  /**< Assigned Plant or FC_PLANT_NONE */
+  char firmware[FC_FIRMWARE_LEN]; /**< Firmware version, empty if unknown */
+  uint32_t seen;                  /**< time(NULL) of the last advertisement */
+} FlowerCareRegEntry_t;
+
+/**
+ * @brief Registry of the known sensors
+ *
+ */
+class FlowerCareRegistry {
+ public:
+  FlowerCareRegistry(FlowerCareStore* = NULL);
+  ~FlowerCareRegistry();
+
+  size_t discover(uint32_t = FC_DISCOVERY_MS, FlowerCareScanner* = NULL);
+  bool load();
+  bool save();
+
+  size_t size();
+  const FlowerCareRegEntry_t* get(size_t);
+  int find(const std::string&);
+  int add(const std::string&, int = 0);
+  bool remove(const std::string&);
+  bool setPlant(const std::string&, Plant);
+  bool update(FlowerCare*);
+  size_t addTo(FlowerCareFleet*, Plant = FICUS_GINSEGN);
+
+  FlowerCareRegistry(const FlowerCareRegistry&) = delete;
+  FlowerCareRegistry& operator=(const FlowerCareRegistry&) = delete;
+
+ private:
+  std::vector<FlowerCareRegEntry_t> _entries; /**< Known sensors */
+  FlowerCareStore* _store;     /**< Where to save, not owned. May be NULL */
+  FlowerCareScanner* _scanner; /**< Scanner created by discover() or NULL */
+  size_t _found;               /**< New sensors of the running discover() */
+  bool _dirty;                 /**< Changed since the last save() */
+
+  int insert(const std::string&, int);
+  void commit();
+  static void onAdv(const std::string&, uint16_t, const uint8_t*, size_t, int,
+                    void*);
+};
+
+#endif
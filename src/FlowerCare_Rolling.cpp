@@ -0,0 +1,390 @@
+#include "FlowerCare_Rolling.h"
+
+#include <math.h>
+
+// default windows of FlowerCareRolling: hour, day, week
+static const uint32_t defaultSpans[] = {3600, 86400, 7 * 86400};
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor, the only allocation of the window
+ *
+ * @param span    length of the window in s, rounded down to a multiple of
+ *                buckets
+ * @param buckets number of buckets, the resolution of the window
+ */
+FlowerCareWindow::FlowerCareWindow(uint32_t span, uint16_t buckets) {
+  _nBuckets = buckets > 0 ? buckets : 1;
+  _width = span / _nBuckets > 0 ? span / _nBuckets : 1;
+  _b.resize(_nBuckets);
+  _minQ.buf.resize(_nBuckets);
+  _maxQ.buf.resize(_nBuckets);
+  reset();
+}
+
+/**
+ * @brief Add a sample. Samples older than the newest bucket are dropped
+ *
+ * @param time  time of the sample in s
+ * @param value the sample
+ */
+void FlowerCareWindow::add(uint32_t time, float value) {
+  uint32_t idx = time / _width;
+
+  if (!_started) {
+    _started = true;
+    _cur = idx;
+    slot(idx) = Bucket_t{idx, 0, 0, 0, 0, 0};
+  } else if (idx < _cur) {
+    return;
+  } else {
+    advance(idx);
+  }
+
+  Bucket_t& b = slot(idx);
+  float d = value - b.mean;
+
+  b.count++;
+  b.mean += d / b.count;
+  b.m2 += d * (value - b.mean);
+
+  if (b.count == 1 || value < b.min) {
+    b.min = value;
+    push(&_minQ, idx, true);
+  }
+  if (b.count == 1 || value > b.max) {
+    b.max = value;
+    push(&_maxQ, idx, false);
+  }
+
+  // window totals, Welford
+  _n++;
+  double dn = value - _mean;
+  _mean += dn / _n;
+  _m2 += dn * (value - _mean);
+}
+
+/**
+ * @brief Get the statistics of the window ending at a given time
+ *
+ * @param now end of the window in s, buckets before now - span expire
+ * @param agg where to store the statistics
+ * @return false if the window has no sample
+ */
+bool FlowerCareWindow::get(uint32_t now, FlowerCareAgg_t* agg) {
+  if (_started) {
+    advance(now / _width);
+  }
+
+  if (_n == 0) {
+    *agg = FlowerCareAgg_t{0, 0, 0, 0, 0};
+    return false;
+  }
+
+  fill(_n, (float)_mean, (float)_m2, slot(_minQ.buf[_minQ.head]).min,
+       slot(_maxQ.buf[_maxQ.head]).max, agg);
+  return true;
+}
+
+/**
+ * @brief Drop all samples
+ *
+ */
+void FlowerCareWindow::reset() {
+  for (uint16_t i = 0; i < _nBuckets; i++) {
+    _b[i].count = 0;
+  }
+  _started = false;
+  _cur = 0;
+  _n = 0;
+  _mean = 0;
+  _m2 = 0;
+  _minQ.head = _minQ.len = 0;
+  _maxQ.head = _maxQ.len = 0;
+}
+
+/**
+ * @brief Get the length of the window
+ *
+ * @return the length in s
+ */
+uint32_t FlowerCareWindow::span() const { return _width * _nBuckets; }
+
+/**
+ * @brief Get the number of buckets
+ *
+ */
+uint16_t FlowerCareWindow::buckets() const { return _nBuckets; }
+
+/**
+ * @brief Get a bucket, the downsampled series of the window. Buckets are
+ * relative to the newest one, expired ones are only dropped by add() and get()
+ *
+ * @param i     0 for the oldest bucket to buckets() - 1 for the newest
+ * @param agg   where to store the statistics of the bucket
+ * @param start where to store the start time of the bucket in s, may be NULL
+ * @return false if i is not valid or the bucket has no sample
+ */
+bool FlowerCareWindow::bucket(uint16_t i, FlowerCareAgg_t* agg,
+                              uint32_t* start) const {
+  uint32_t back = (uint32_t)(_nBuckets - 1 - i);
+
+  if (!_started || i >= _nBuckets || back > _cur) {
+    return false;
+  }
+
+  uint32_t idx = _cur - back;
+  const Bucket_t& b = slot(idx);
+
+  if (b.idx != idx || b.count == 0) {
+    return false;
+  }
+
+  fill(b.count, b.mean, b.m2, b.min, b.max, agg);
+  if (start != NULL) {
+    *start = idx * _width;
+  }
+  return true;
+}
+
+/**
+ * @brief Constructor, the only allocation of the windows
+ *
+ * @param spans   length in s of every window, NULL for one hour, one day and
+ *                one week
+ * @param nSpans  number of spans, up to FC_ROLLING_MAXSPANS
+ * @param buckets number of buckets of every window
+ */
+FlowerCareRolling::FlowerCareRolling(const uint32_t* spans, uint8_t nSpans,
+                                     uint16_t buckets) {
+  if (spans == NULL) {
+    spans = defaultSpans;
+    nSpans = sizeof(defaultSpans) / sizeof(defaultSpans[0]);
+  }
+  _nSpans = nSpans < FC_ROLLING_MAXSPANS ? nSpans : FC_ROLLING_MAXSPANS;
+
+  _windows.reserve(4 * _nSpans);
+  for (int m = 0; m < 4; m++) {
+    for (uint8_t s = 0; s < _nSpans; s++) {
+      _windows.push_back(FlowerCareWindow(spans[s], buckets));
+    }
+  }
+}
+
+/**
+ * @brief Add a reading to every window of its metrics
+ *
+ * @param time    time of the reading in s
+ * @param reading the reading
+ * @param fields  FC_FIELD_T of the metrics to add
+ */
+void FlowerCareRolling::add(uint32_t time, const FlowerCareReading_t& reading,
+                            uint8_t fields) {
+  if (fields & FIELD_TEMP) add(time, FIELD_TEMP, (float)reading.temp / 10);
+  if (fields & FIELD_MOIST) add(time, FIELD_MOIST, reading.moist);
+  if (fields & FIELD_LIGHT) add(time, FIELD_LIGHT, (float)reading.light);
+  if (fields & FIELD_FERT) add(time, FIELD_FERT, reading.fert);
+}
+
+/**
+ * @brief Add a value to every window of a metric
+ *
+ * @param time  time of the value in s
+ * @param field the metric, a single FC_FIELD_T
+ * @param value the value, temperature in °C
+ */
+void FlowerCareRolling::add(uint32_t time, FC_FIELD_T field, float value) {
+  int m = metric(field);
+
+  if (m < 0) {
+    return;
+  }
+
+  for (uint8_t s = 0; s < _nSpans; s++) {
+    _windows[m * _nSpans + s].add(time, value);
+  }
+}
+
+/**
+ * @brief Get the statistics of a window
+ *
+ * @param field the metric, a single FC_FIELD_T
+ * @param span  index of the window in the spans given to the constructor
+ * @param now   end of the window in s
+ * @param agg   where to store the statistics
+ * @return false if the window does not exist or has no sample
+ */
+bool FlowerCareRolling::get(FC_FIELD_T field, uint8_t span, uint32_t now,
+                            FlowerCareAgg_t* agg) {
+  FlowerCareWindow* w = window(field, span);
+  return w != NULL && w->get(now, agg);
+}
+
+/**
+ * @brief Get a window, for its buckets
+ *
+ * @param field the metric, a single FC_FIELD_T
+ * @param span  index of the window in the spans given to the constructor
+ * @return the window or NULL
+ */
+FlowerCareWindow* FlowerCareRolling::window(FC_FIELD_T field, uint8_t span) {
+  int m = metric(field);
+  return m >= 0 && span < _nSpans ? &_windows[m * _nSpans + span] : NULL;
+}
+
+/**
+ * @brief Get the number of windows per metric
+ *
+ */
+uint8_t FlowerCareRolling::spans() const { return _nSpans; }
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Get the ring slot of a bucket
+ *
+ * @param idx time / width of the bucket
+ */
+FlowerCareWindow::Bucket_t& FlowerCareWindow::slot(uint32_t idx) {
+  return _b[idx % _nBuckets];
+}
+
+const FlowerCareWindow::Bucket_t& FlowerCareWindow::slot(uint32_t idx) const {
+  return _b[idx % _nBuckets];
+}
+
+/**
+ * @brief Move the newest bucket forward, expiring the buckets leaving the
+ * window. At most buckets() steps, a longer gap empties the window
+ *
+ * @param idx time / width of the new newest bucket
+ */
+void FlowerCareWindow::advance(uint32_t idx) {
+  if (idx <= _cur) {
+    return;
+  }
+
+  if (idx - _cur >= _nBuckets) {
+    reset();
+    _started = true;
+    _cur = idx;
+    slot(idx) = Bucket_t{idx, 0, 0, 0, 0, 0};
+    return;
+  }
+
+  while (_cur < idx) {
+    _cur++;
+    Bucket_t& b = slot(_cur);
+    expire(b);
+    b = Bucket_t{_cur, 0, 0, 0, 0, 0};
+  }
+
+  // buckets before _cur - _nBuckets + 1 left the window
+  while (_minQ.len > 0 && _minQ.buf[_minQ.head] + _nBuckets <= _cur) {
+    _minQ.head = (_minQ.head + 1) % _nBuckets;
+    _minQ.len--;
+  }
+  while (_maxQ.len > 0 && _maxQ.buf[_maxQ.head] + _nBuckets <= _cur) {
+    _maxQ.head = (_maxQ.head + 1) % _nBuckets;
+    _maxQ.len--;
+  }
+}
+
+/**
+ * @brief Remove the samples of a bucket from the window totals, reverse of
+ * Chan's parallel merge
+ *
+ * @param b the bucket
+ */
+void FlowerCareWindow::expire(const Bucket_t& b) {
+  if (b.count == 0) {
+    return;
+  }
+
+  uint32_t n = _n - b.count;
+
+  if (n == 0) {
+    _n = 0;
+    _mean = 0;
+    _m2 = 0;
+    return;
+  }
+
+  double mean = _mean + (_mean - b.mean) * b.count / n;
+  double d = b.mean - mean;
+
+  _m2 -= b.m2 + d * d * b.count * n / _n;
+  if (_m2 < 0) {
+    _m2 = 0;
+  }
+  _mean = mean;
+  _n = n;
+}
+
+/**
+ * @brief Push the newest bucket after its min (or max) changed, dropping the
+ * buckets that can no longer be the min (max) of the window
+ *
+ * @param q     _minQ or _maxQ
+ * @param idx   the newest bucket
+ * @param isMin true for _minQ
+ */
+void FlowerCareWindow::push(Deque_t* q, uint32_t idx, bool isMin) {
+  const Bucket_t& b = slot(idx);
+
+  while (q->len > 0) {
+    const Bucket_t& back = slot(q->buf[(q->head + q->len - 1) % _nBuckets]);
+    if (isMin ? back.min < b.min : back.max > b.max) {
+      break;
+    }
+    q->len--;
+  }
+
+  q->buf[(q->head + q->len) % _nBuckets] = idx;
+  q->len++;
+}
+
+/**
+ * @brief Fill the statistics of a set of samples
+ *
+ * @param count number of samples
+ * @param mean  mean
+ * @param m2    sum of the squared differences to the mean
+ * @param min   min
+ * @param max   max
+ * @param agg   where to store the statistics
+ */
+void FlowerCareWindow::fill(uint32_t count, float mean, float m2, float min,
+                            float max, FlowerCareAgg_t* agg) {
+  agg->count = count;
+  agg->mean = mean;
+  agg->stddev = count > 0 ? sqrtf(m2 / count) : 0;
+  agg->min = min;
+  agg->max = max;
+}
+
+/**
+ * @brief Index of the windows of a metric
+ *
+ * @param field a single FC_FIELD_T
+ * @return the index or -1
+ */
+int FlowerCareRolling::metric(FC_FIELD_T field) {
+  switch (field) {
+    case FIELD_TEMP:
+      return 0;
+    case FIELD_MOIST:
+      return 1;
+    case FIELD_LIGHT:
+      return 2;
+    case FIELD_FERT:
+      return 3;
+    default:
+      return -1;
+  }
+}
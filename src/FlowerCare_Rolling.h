@@ -0,0 +1,109 @@
+#ifndef FLOWERCARE_ROLLING_H
+#define FLOWERCARE_ROLLING_H
+
+/* Streaming statistics over sliding time windows (last hour, day, week...).
+ * A window of span s is split in fixed buckets of s / buckets seconds, each
+ * holding count, mean, M2 (Welford), min and max of its samples: the buckets
+ * are also the downsampled series of the window. The window totals are kept
+ * up to date by merging every sample and removing every expired bucket
+ * (Chan's formulas), min and max come from monotonic deques of buckets. An
+ * update is O(1) amortized, memory is fixed at construction and queries do
+ * not scan the samples
+ */
+
+#include <vector>
+#include "FlowerCare_Adv.h"
+#include "FlowerCare_Decode.h"
+
+// default buckets per window
+#define FC_WINDOW_BUCKETS 24
+// max windows per metric of FlowerCareRolling
+#define FC_ROLLING_MAXSPANS 4
+
+/**
+ * @brief Statistics of a window or of a bucket
+ *
+ */
+typedef struct FlowerCareAgg {
+  uint32_t count; /**< Number of samples */
+  float mean;
+  float stddev; /**< Population standard deviation */
+  float min, max;
+} FlowerCareAgg_t;
+
+/**
+ * @brief Sliding window statistics of one metric
+ *
+ */
+class FlowerCareWindow {
+ public:
+  FlowerCareWindow(uint32_t = 3600, uint16_t = FC_WINDOW_BUCKETS);
+
+  void add(uint32_t, float);
+  bool get(uint32_t, FlowerCareAgg_t*);
+  void reset();
+
+  uint32_t span() const;
+  uint16_t buckets() const;
+  bool bucket(uint16_t, FlowerCareAgg_t*, uint32_t* = NULL) const;
+
+ private:
+  /**
+   * @brief Samples of a bucket
+   *
+   */
+  typedef struct Bucket {
+    uint32_t idx; /**< time / width of the bucket */
+    uint32_t count;
+    float mean, m2, min, max;
+  } Bucket_t;
+
+  /**
+   * @brief Fixed capacity deque of bucket indexes
+   *
+   */
+  typedef struct Deque {
+    std::vector<uint32_t> buf;
+    uint16_t head, len;
+  } Deque_t;
+
+  uint32_t _width;              /**< Seconds per bucket */
+  uint16_t _nBuckets;           /**< Buckets of the window */
+  std::vector<Bucket_t> _b;     /**< Ring of buckets, by idx % _nBuckets */
+  bool _started;                /**< false until the first sample */
+  uint32_t _cur;                /**< idx of the newest bucket */
+  uint32_t _n;                  /**< Samples in the window */
+  double _mean, _m2;            /**< Welford totals, double as they drift */
+  Deque_t _minQ, _maxQ;         /**< Buckets with increasing min / max */
+
+  Bucket_t& slot(uint32_t);
+  const Bucket_t& slot(uint32_t) const;
+  void advance(uint32_t);
+  void expire(const Bucket_t&);
+  void push(Deque_t*, uint32_t, bool);
+  static void fill(uint32_t, float, float, float, float, FlowerCareAgg_t*);
+};
+
+/**
+ * @brief Sliding windows of several spans for every metric of a sensor
+ *
+ */
+class FlowerCareRolling {
+ public:
+  FlowerCareRolling(const uint32_t* = NULL, uint8_t = 0,
+                    uint16_t = FC_WINDOW_BUCKETS);
+
+  void add(uint32_t, const FlowerCareReading_t&, uint8_t = FIELD_ALL);
+  void add(uint32_t, FC_FIELD_T, float);
+  bool get(FC_FIELD_T, uint8_t, uint32_t, FlowerCareAgg_t*);
+  FlowerCareWindow* window(FC_FIELD_T, uint8_t);
+  uint8_t spans() const;
+
+ private:
+  uint8_t _nSpans;                       /**< Windows per metric */
+  std::vector<FlowerCareWindow> _windows; /**< Metric * _nSpans + span */
+
+  static int metric(FC_FIELD_T);
+};
+
+#endif
@@ -0,0 +1,209 @@
+#include "FlowerCare_Scheduler.h"
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor, default: 2 minutes to 1 hour, 3 s per reading, 1% of
+ * airtime. Light is not considered by default, it swings every day
+ *
+ */
+FlowerCareScheduler::FlowerCareScheduler() {
+  config.minInterval = 120000;
+  config.maxInterval = 3600000;
+  config.readCost = 3000;
+  config.airtime = 0.01f;
+  config.safety = 0.5f;
+  config.alpha = 0.3f;
+  config.metrics = FIELD_TEMP | FIELD_MOIST | FIELD_FERT;
+
+  _rateSum = 0;
+}
+
+/**
+ * @brief Add a sensor, due immediately
+ *
+ * @param sensor the sensor, not owned by the scheduler
+ * @return the index of the sensor
+ */
+size_t FlowerCareScheduler::add(FlowerCare* sensor) {
+  FlowerCareSchedState_t st = {};
+  st.sensor = sensor;
+  st.interval = minInterval();
+  _sensors.push_back(st);
+  _rateSum += 1.0 / st.interval;
+  return _sensors.size() - 1;
+}
+
+/**
+ * @brief Get the number of sensors
+ *
+ */
+size_t FlowerCareScheduler::size() { return _sensors.size(); }
+
+/**
+ * @brief Learn from a new reading of a sensor and compute its next interval
+ *
+ * @param idx index returned by add()
+ * @param now millis() of the reading
+ */
+void FlowerCareScheduler::update(size_t idx, uint32_t now) {
+  FlowerCareSchedState_t& st = _sensors[idx];
+  const FlowerCareData_t& d = st.sensor->data();
+  const PlantVal_t& p = st.sensor->plant();
+
+  float val[4] = {d.temp, (float)d.moist, (float)d.light, (float)d.fert};
+  float lo[4] = {p.temp_min, (float)p.moist_min, (float)p.light_min,
+                 (float)p.fert_min};
+  float hi[4] = {p.temp_max, (float)p.moist_max, (float)p.light_max,
+                 (float)p.fert_max};
+
+  uint32_t elapsed = now - st.lastRead;
+  float next = (float)config.maxInterval;
+
+  for (uint8_t m = 0; m < 4; m++) {
+    if (st.valid && elapsed > 0) {
+      float r = fabsf(val[m] - st.last[m]) / elapsed;
+      st.rate[m] += config.alpha * (r - st.rate[m]);
+    }
+    st.last[m] = val[m];
+
+    if (!(config.metrics & (1 << m))) {
+      continue;
+    }
+
+    // distance to the nearest threshold, 0 when already out of range
+    float margin = val[m] - lo[m] < hi[m] - val[m] ? val[m] - lo[m]
+                                                   : hi[m] - val[m];
+    if (margin <= 0) {
+      next = 0;
+    } else if (st.rate[m] > 0 && margin / st.rate[m] * config.safety < next) {
+      next = margin / st.rate[m] * config.safety;
+    }
+  }
+
+  // stretch gradually, a single flat reading is not a trend
+  if (next > 2.0f * st.interval) {
+    next = 2.0f * st.interval;
+  }
+
+  if (next < minInterval()) {
+    next = (float)minInterval();
+  } else if (next > config.maxInterval) {
+    next = (float)config.maxInterval;
+  }
+
+  _rateSum += 1.0 / (uint32_t)next - 1.0 / st.interval;
+  st.interval = (uint32_t)next;
+  st.lastRead = now;
+  st.lastTry = now;
+  st.valid = true;
+  st.tried = true;
+}
+
+/**
+ * @brief Check if a sensor must be read, at once if never attempted
+ *
+ * @param idx index returned by add()
+ * @param now millis()
+ */
+bool FlowerCareScheduler::due(size_t idx, uint32_t now) {
+  const FlowerCareSchedState_t& st = _sensors[idx];
+  return !st.tried ||
+         now - st.lastTry >= (uint32_t)(st.interval * budgetScale());
+}
+
+/**
+ * @brief Get the interval of a sensor, airtime budget included
+ *
+ * @param idx index returned by add()
+ * @return the interval in ms
+ */
+uint32_t FlowerCareScheduler::interval(size_t idx) {
+  return (uint32_t)(_sensors[idx].interval * budgetScale());
+}
+
+/**
+ * @brief Get the time before the next sensor is due
+ *
+ * @param now millis()
+ * @return the time in ms, 0 if a sensor is due now
+ */
+uint32_t FlowerCareScheduler::nextDue(uint32_t now) {
+  float scale = budgetScale();
+  uint32_t wait = config.maxInterval;
+
+  for (size_t i = 0; i < _sensors.size(); i++) {
+    const FlowerCareSchedState_t& st = _sensors[i];
+    if (!st.tried) {
+      return 0;
+    }
+
+    uint32_t elapsed = now - st.lastTry;
+    uint32_t iv = (uint32_t)(st.interval * scale);
+    if (elapsed >= iv) {
+      return 0;
+    }
+    if (iv - elapsed < wait) {
+      wait = iv - elapsed;
+    }
+  }
+
+  return wait;
+}
+
+/**
+ * @brief Read every due sensor with getData() and update its interval
+ *
+ * @return the number of sensors read successfully
+ */
+size_t FlowerCareScheduler::run() {
+  size_t ok = 0;
+
+  for (size_t i = 0; i < _sensors.size(); i++) {
+    if (!due(i, millis())) {
+      continue;
+    }
+
+    if (_sensors[i].sensor->getData() == FLCARE_OK) {
+      update(i, millis());
+      ok++;
+    } else {
+      // retry after the shortest interval, what was learned is kept
+      _rateSum += 1.0 / minInterval() - 1.0 / _sensors[i].interval;
+      _sensors[i].lastTry = millis();
+      _sensors[i].interval = minInterval();
+      _sensors[i].tried = true;
+    }
+  }
+
+  return ok;
+}
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Factor stretching every interval so that the readings fit in the
+ * airtime budget. The budget wins over maxInterval
+ *
+ * @return the factor, 1 if the budget is respected
+ */
+float FlowerCareScheduler::budgetScale() {
+  float demand = (float)(config.readCost * _rateSum);
+
+  return demand > config.airtime && config.airtime > 0
+             ? demand / config.airtime
+             : 1.0f;
+}
+
+/**
+ * @brief Get the shortest interval, a minInterval of 0 is raised to 1 ms:
+ * the airtime demand divides by the interval
+ *
+ */
+uint32_t FlowerCareScheduler::minInterval() {
+  return config.minInterval > 0 ? config.minInterval : 1;
+}
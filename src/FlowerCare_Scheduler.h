@@ -0,0 +1,68 @@
+#ifndef FLOWERCARE_SCHEDULER_H
+#define FLOWERCARE_SCHEDULER_H
+
+/* Adaptive polling: every sensor is read again after an interval computed
+ * from how fast its values change and how close they are to the plant
+ * thresholds. The interval is the predicted time to reach the nearest
+ * threshold, scaled by a safety factor and bounded by min/max. When all
+ * sensors together would use more radio time than the airtime budget, every
+ * interval is stretched by the same factor
+ */
+
+#include <math.h>
+#include <vector>
+#include "FlowerCare_BLE.h"
+
+/**
+ * @brief Scheduler configuration, times in ms
+ *
+ */
+typedef struct FlowerCareSchedConfig {
+  uint32_t minInterval; /**< Shortest interval between two readings, > 0 */
+  uint32_t maxInterval; /**< Longest interval between two readings */
+  uint32_t readCost;    /**< Estimated radio time of one reading */
+  float airtime;        /**< Max fraction of time spent on readings, 0-1 */
+  float safety;         /**< Fraction of the time to threshold to wait */
+  float alpha;          /**< Smoothing of the rate of change, 0-1 */
+  uint8_t metrics;      /**< FC_FIELD_T mask of the metrics considered */
+} FlowerCareSchedConfig_t;
+
+/**
+ * @brief Learned state of one sensor
+ *
+ */
+typedef struct FlowerCareSchedState {
+  FlowerCare* sensor;
+  float last[4];     /**< Last values: temp, moist, light, fert */
+  float rate[4];     /**< Smoothed absolute rate of change, units per ms */
+  uint32_t lastRead; /**< millis() of the last reading */
+  uint32_t lastTry;  /**< millis() of the last attempt, failed or not */
+  uint32_t interval; /**< Interval before the next attempt */
+  bool valid;        /**< true after the first reading */
+  bool tried;        /**< true after the first attempt */
+} FlowerCareSchedState_t;
+
+class FlowerCareScheduler {
+ public:
+  FlowerCareScheduler();
+
+  size_t add(FlowerCare*);
+  size_t size();
+
+  void update(size_t, uint32_t);
+  bool due(size_t, uint32_t);
+  uint32_t interval(size_t);
+  uint32_t nextDue(uint32_t);
+  size_t run();
+
+  FlowerCareSchedConfig_t config;
+
+ private:
+  std::vector<FlowerCareSchedState_t> _sensors;
+  double _rateSum; /**< Sum of 1 / interval, readings per ms */
+
+  float budgetScale();
+  uint32_t minInterval();
+};
+
+#endif
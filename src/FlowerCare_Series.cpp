@@ -0,0 +1,455 @@
+#include "FlowerCare_Series.h"
+
+// sample flag: same time step as the previous sample
+#define SAMPLE_SAMESTEP 0x10
+
+static uint16_t get16(const uint8_t* p) { return p[0] | p[1] << 8; }
+
+static uint32_t get32(const uint8_t* p) {
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 |
+         (uint32_t)p[3] << 24;
+}
+
+static void put16(uint8_t* p, uint16_t val) {
+  p[0] = (uint8_t)val;
+  p[1] = (uint8_t)(val >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t val) {
+  put16(p, (uint16_t)val);
+  put16(p + 2, (uint16_t)(val >> 16));
+}
+
+static size_t putVarint(uint8_t* p, uint32_t val) {
+  size_t n = 0;
+  while (val >= 0x80) {
+    p[n++] = (uint8_t)(val | 0x80);
+    val >>= 7;
+  }
+  p[n++] = (uint8_t)val;
+  return n;
+}
+
+/**
+ * @brief Read a varint
+ *
+ * @param p   the data
+ * @param len bytes available
+ * @param pos position, moved past the varint
+ * @param val where to store the value
+ * @return false if the varint is truncated or too long
+ */
+static bool getVarint(const uint8_t* p, size_t len, size_t* pos,
+                      uint32_t* val) {
+  uint32_t v = 0;
+
+  for (unsigned shift = 0; shift < 35 && *pos < len; shift += 7) {
+    uint8_t b = p[(*pos)++];
+    v |= (uint32_t)(b & 0x7f) << shift;
+    if (!(b & 0x80)) {
+      *val = v;
+      return true;
+    }
+  }
+  return false;
+}
+
+// deltas wrap around 32 bits, zigzag keeps small negative deltas short
+static uint32_t zigzag(uint32_t delta) {
+  return (delta << 1) ^ (uint32_t)-(int32_t)(delta >> 31);
+}
+
+static uint32_t unzigzag(uint32_t val) { return (val >> 1) ^ -(val & 1); }
+
+// metric values as uint32, in FC_FIELD_T bit order
+static void toValues(const FlowerCareReading_t& r, uint32_t* v) {
+  v[0] = (uint32_t)(int32_t)r.temp;
+  v[1] = r.moist;
+  v[2] = r.light;
+  v[3] = r.fert;
+}
+
+static void fromValues(const uint32_t* v, FlowerCareReading_t* r) {
+  r->temp = (int16_t)v[0];
+  r->moist = (uint8_t)v[1];
+  r->light = v[2];
+  r->fert = (uint16_t)v[3];
+}
+
+/**
+ * @brief Encode a sample
+ *
+ * @param base previous sample of the block, zero in a new block
+ * @param step previous time step of the block
+ * @param s    the sample
+ * @param out  where to store the sample, FC_SERIES_MAXSAMPLE bytes
+ * @return encoded length
+ */
+static size_t encode(const FlowerCareSample_t& base, uint32_t step,
+                     const FlowerCareSample_t& s, uint8_t* out) {
+  uint32_t prev[4], cur[4];
+  uint32_t dt = s.time - base.time;
+  uint8_t flags = 0;
+  size_t n = 1;
+
+  toValues(base.reading, prev);
+  toValues(s.reading, cur);
+
+  if (dt == step) {
+    flags |= SAMPLE_SAMESTEP;
+  } else {
+    n += putVarint(out + n, dt);
+  }
+
+  for (uint8_t m = 0; m < 4; m++) {
+    if (cur[m] != prev[m]) {
+      flags |= 1 << m;
+      n += putVarint(out + n, zigzag(cur[m] - prev[m]));
+    }
+  }
+
+  out[0] = flags;
+  return n;
+}
+
+/*******************************************************************************
+ *                                 Iterator
+ ******************************************************************************/
+
+/**
+ * @brief Constructor, use FlowerCareSeries::scan()
+ *
+ * @param buf        first block of the ring
+ * @param blockSize  bytes per block
+ * @param ringBlocks blocks of the ring
+ * @param first      ring index of the first block to scan
+ * @param blocks     number of blocks to scan
+ * @param from       start of the time range
+ * @param to         end of the time range, inclusive
+ */
+FlowerCareSeries::Iterator::Iterator(const uint8_t* buf, size_t blockSize,
+                                     size_t ringBlocks, size_t first,
+                                     size_t blocks, uint32_t from,
+                                     uint32_t to) {
+  _buf = buf;
+  _blockSize = blockSize;
+  _ringBlocks = ringBlocks;
+  _block = first;
+  _left = blocks;
+  _from = from;
+  _to = to;
+  _pos = 0;
+  _prev = FlowerCareSample_t();
+  _step = 0;
+  openBlock();
+}
+
+/**
+ * @brief Get the next sample of the range
+ *
+ * @param sample where to store the sample
+ * @return false at the end of the range
+ */
+bool FlowerCareSeries::Iterator::next(FlowerCareSample_t* sample) {
+  while (_left > 0) {
+    const uint8_t* b = _buf + _block * _blockSize;
+    size_t used = get16(b);
+    uint32_t val;
+
+    if (_pos >= used) {
+      _block = (_block + 1) % _ringBlocks;
+      _left--;
+      openBlock();
+      continue;
+    }
+
+    uint8_t flags = b[_pos++];
+    if (!(flags & SAMPLE_SAMESTEP)) {
+      if (!getVarint(b, used, &_pos, &_step)) {
+        _left = 0;  // corrupted block, e.g. a bad spilled copy
+        return false;
+      }
+    }
+    _prev.time += _step;
+
+    uint32_t v[4];
+    toValues(_prev.reading, v);
+    for (uint8_t m = 0; m < 4; m++) {
+      if (flags & (1 << m)) {
+        if (!getVarint(b, used, &_pos, &val)) {
+          _left = 0;
+          return false;
+        }
+        v[m] += unzigzag(val);
+      }
+    }
+    fromValues(v, &_prev.reading);
+
+    if (_prev.time > _to) {
+      _left = 0;
+      return false;
+    }
+    if (_prev.time >= _from) {
+      *sample = _prev;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief Start decoding the current block, skipping the blocks that end
+ * before the time range
+ *
+ * @return false if no block is left
+ */
+bool FlowerCareSeries::Iterator::openBlock() {
+  for (; _left > 0; _left--, _block = (_block + 1) % _ringBlocks) {
+    const uint8_t* b = _buf + _block * _blockSize;
+    size_t used = get16(b);
+
+    if (used < FC_SERIES_BLOCKHEAD || used > _blockSize) {
+      continue;
+    }
+    if (get16(b + 2) > 0 && get32(b + 4) >= _from) {
+      _pos = FC_SERIES_BLOCKHEAD;
+      _prev = FlowerCareSample_t();
+      _step = 0;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor, the ring is allocated once here
+ *
+ * @param size      bytes of the ring, rounded down to whole blocks
+ * @param blockSize bytes per block, 32 to 65535
+ */
+FlowerCareSeries::FlowerCareSeries(size_t size, size_t blockSize) {
+  init(size, blockSize);
+  _buf = new uint8_t[_ringBlocks * _blockSize];
+  _ownBuf = true;
+  clear();
+}
+
+/**
+ * @brief Constructor on a buffer given by the caller, e.g. static memory
+ *
+ * @param buf       the buffer, must outlive the object
+ * @param size      bytes of buf, rounded down to whole blocks
+ * @param blockSize bytes per block, 32 to 65535
+ */
+FlowerCareSeries::FlowerCareSeries(uint8_t* buf, size_t size,
+                                   size_t blockSize) {
+  init(size, blockSize);
+  _buf = buf;
+  _ownBuf = false;
+  clear();
+}
+
+/**
+ * @brief Destructor
+ *
+ */
+FlowerCareSeries::~FlowerCareSeries() {
+  if (_ownBuf) {
+    delete[] _buf;
+  }
+}
+
+/**
+ * @brief Append a sample. O(1), does not allocate. When the ring is full the
+ * oldest block is dropped
+ *
+ * @param time    time of the sample in s, not before the last sample
+ * @param reading the values
+ * @return false if time is before the last sample
+ */
+bool FlowerCareSeries::append(uint32_t time,
+                              const FlowerCareReading_t& reading) {
+  if (_samples > 0 && time < _last.time) {
+    return false;
+  }
+
+  FlowerCareSample_t s = {time, reading};
+  uint8_t enc[FC_SERIES_MAXSAMPLE];
+  size_t n = encode(_base, _step, s, enc);
+  uint8_t* b = _blocks > 0 ? block(_blocks - 1) : NULL;
+
+  if (b == NULL || get16(b) + n > _blockSize) {
+    newBlock();
+    b = block(_blocks - 1);
+    n = encode(_base, _step, s, enc);
+  }
+
+  size_t used = get16(b);
+  memcpy(b + used, enc, n);
+  put16(b, (uint16_t)(used + n));
+  put16(b + 2, (uint16_t)(get16(b + 2) + 1));
+  put32(b + 4, time);
+
+  _step = time - _base.time;
+  _base = s;
+  _last = s;
+  _samples++;
+
+  return true;
+}
+
+/**
+ * @brief Drop all the samples, without spilling them
+ *
+ */
+void FlowerCareSeries::clear() {
+  _first = 0;
+  _blocks = 0;
+  _samples = 0;
+  _last = FlowerCareSample_t();
+  _base = FlowerCareSample_t();
+  _step = 0;
+}
+
+/**
+ * @brief Set the callback receiving the blocks dropped from the ring, e.g. to
+ * write them to flash or to a file. They can be read with scanBlock()
+ *
+ * @param spill the callback, NULL to just drop the blocks
+ * @param arg   argument of spill
+ */
+void FlowerCareSeries::setSpill(FC_SERIES_SPILL_T spill, void* arg) {
+  _spill = spill;
+  _spillArg = arg;
+}
+
+/**
+ * @brief Get the number of samples in the ring
+ *
+ * @return the number of samples
+ */
+size_t FlowerCareSeries::size() const { return _samples; }
+
+/**
+ * @brief Get the bytes used by the samples, block headers included
+ *
+ * @return the bytes used
+ */
+size_t FlowerCareSeries::bytes() const {
+  size_t n = 0;
+  for (size_t i = 0; i < _blocks; i++) {
+    n += get16(block(i));
+  }
+  return n;
+}
+
+/**
+ * @brief Get the last sample
+ *
+ * @param sample where to store the sample
+ * @return false if the series is empty
+ */
+bool FlowerCareSeries::last(FlowerCareSample_t* sample) const {
+  if (_samples == 0) {
+    return false;
+  }
+
+  *sample = _last;
+  return true;
+}
+
+/**
+ * @brief Scan the samples of a time range
+ *
+ *   FlowerCareSeries::Iterator it = series.scan(from, to);
+ *   FlowerCareSample_t s;
+ *   while (it.next(&s)) { ... }
+ *
+ * @param from start of the range, in s
+ * @param to   end of the range, inclusive
+ * @return iterator over the samples, oldest first
+ */
+FlowerCareSeries::Iterator FlowerCareSeries::scan(uint32_t from,
+                                                  uint32_t to) const {
+  return Iterator(_buf, _blockSize, _ringBlocks, _first, _blocks, from, to);
+}
+
+/**
+ * @brief Scan the samples of a single block, e.g. a spilled one
+ *
+ * @param block     the block
+ * @param blockSize length of the block, at least its used bytes
+ * @param from      start of the range, in s
+ * @param to        end of the range, inclusive
+ * @return iterator over the samples, oldest first
+ */
+FlowerCareSeries::Iterator FlowerCareSeries::scanBlock(const uint8_t* block,
+                                                       size_t blockSize,
+                                                       uint32_t from,
+                                                       uint32_t to) {
+  return Iterator(block, blockSize, 1, 0, 1, from, to);
+}
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Set the geometry of the ring
+ *
+ * @param size      bytes of the ring
+ * @param blockSize bytes per block
+ */
+void FlowerCareSeries::init(size_t size, size_t blockSize) {
+  if (blockSize < 32) {
+    blockSize = 32;
+  } else if (blockSize > 65535) {
+    blockSize = 65535;
+  }
+
+  _blockSize = blockSize;
+  _ringBlocks = size / blockSize < 2 ? 2 : size / blockSize;
+  _spill = NULL;
+  _spillArg = NULL;
+}
+
+/**
+ * @brief Get a block in use
+ *
+ * @param i index of the block, 0 is the oldest
+ * @return the block
+ */
+uint8_t* FlowerCareSeries::block(size_t i) const {
+  return _buf + ((_first + i) % _ringBlocks) * _blockSize;
+}
+
+/**
+ * @brief Start a new block, dropping the oldest one if the ring is full
+ *
+ */
+void FlowerCareSeries::newBlock() {
+  if (_blocks == _ringBlocks) {
+    uint8_t* old = block(0);
+
+    if (_spill != NULL) {
+      _spill(old, get16(old), _spillArg);
+    }
+    _samples -= get16(old + 2);
+    _first = (_first + 1) % _ringBlocks;
+    _blocks--;
+  }
+
+  uint8_t* b = block(_blocks++);
+  put16(b, FC_SERIES_BLOCKHEAD);
+  put16(b + 2, 0);
+  put32(b + 4, 0);
+
+  _base = FlowerCareSample_t();
+  _step = 0;
+}
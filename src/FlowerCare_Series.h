@@ -0,0 +1,110 @@
+#ifndef FLOWERCARE_SERIES_H
+#define FLOWERCARE_SERIES_H
+
+/* Time series of the readings of one sensor, kept in a fixed-size ring buffer
+ * of blocks. Samples are delta and varint encoded, a sample taken every 10
+ * minutes needs 3-6 bytes, so a day fits in about 1 KB.
+ *
+ * Block layout (little endian):
+ *   uint16 used bytes, uint16 samples, uint32 time of the last sample,
+ *   then the samples. Every sample is:
+ *   uint8 flags  bits 0-3: FC_FIELD_T of the metrics that changed
+ *                bit 4: same time step as the previous sample
+ *   varint time step (absent with bit 4), zigzag varint delta of every
+ *   changed metric, in temp, moist, light, fert order
+ * The deltas of a block start from zero, so every block can be decoded on
+ * its own. When the ring is full the oldest block is dropped, after being
+ * handed to the spill callback if any (to keep it in flash or in a file)
+ */
+
+#include "FlowerCare_Adv.h"
+#include "FlowerCare_Decode.h"
+
+// default ring size and block size in bytes
+#define FC_SERIES_SIZE 4096
+#define FC_SERIES_BLOCK 256
+#define FC_SERIES_BLOCKHEAD 8
+// max bytes of an encoded sample
+#define FC_SERIES_MAXSAMPLE 26
+
+/**
+ * @brief A sample of the time series
+ *
+ */
+typedef struct FlowerCareSample {
+  uint32_t time;               /**< Time in s, e.g. time(NULL) */
+  FlowerCareReading_t reading; /**< The values */
+} FlowerCareSample_t;
+
+/**
+ * @brief Called with a block about to be dropped from the ring, len is the
+ * used part of the block
+ *
+ */
+typedef void (*FC_SERIES_SPILL_T)(const uint8_t* block, size_t len, void* arg);
+
+class FlowerCareSeries {
+ public:
+  /**
+   * @brief Scan of the samples in a time range, oldest first. Appends to the
+   * series invalidate the iterator
+   *
+   */
+  class Iterator {
+   public:
+    Iterator(const uint8_t*, size_t, size_t, size_t, size_t, uint32_t,
+             uint32_t);
+    bool next(FlowerCareSample_t*);
+
+   private:
+    const uint8_t* _buf;   /**< First block of the ring */
+    size_t _blockSize;     /**< Bytes per block */
+    size_t _ringBlocks;    /**< Blocks of the ring */
+    size_t _block;         /**< Ring index of the current block */
+    size_t _left;          /**< Blocks left, including the current one */
+    size_t _pos;           /**< Position in the current block */
+    uint32_t _from, _to;   /**< Time range, inclusive */
+    FlowerCareSample_t _prev; /**< Previous sample of the block */
+    uint32_t _step;           /**< Previous time step */
+
+    bool openBlock();
+  };
+
+  FlowerCareSeries(size_t = FC_SERIES_SIZE, size_t = FC_SERIES_BLOCK);
+  FlowerCareSeries(uint8_t*, size_t, size_t = FC_SERIES_BLOCK);
+  ~FlowerCareSeries();
+
+  FlowerCareSeries(const FlowerCareSeries&) = delete;
+  FlowerCareSeries& operator=(const FlowerCareSeries&) = delete;
+
+  bool append(uint32_t, const FlowerCareReading_t&);
+  void clear();
+  void setSpill(FC_SERIES_SPILL_T, void*);
+
+  size_t size() const;
+  size_t bytes() const;
+  bool last(FlowerCareSample_t*) const;
+  Iterator scan(uint32_t = 0, uint32_t = UINT32_MAX) const;
+  static Iterator scanBlock(const uint8_t*, size_t, uint32_t = 0,
+                            uint32_t = UINT32_MAX);
+
+ private:
+  uint8_t* _buf;        /**< Ring of blocks */
+  bool _ownBuf;         /**< true if _buf was allocated by the object */
+  size_t _blockSize;    /**< Bytes per block */
+  size_t _ringBlocks;   /**< Blocks of the ring */
+  size_t _first;        /**< Ring index of the oldest block */
+  size_t _blocks;       /**< Blocks in use */
+  size_t _samples;      /**< Samples in the ring */
+  FlowerCareSample_t _last; /**< Last sample appended */
+  FlowerCareSample_t _base; /**< Base of the next delta, zero in new blocks */
+  uint32_t _step;           /**< Last time step of the current block */
+  FC_SERIES_SPILL_T _spill; /**< Spill callback or NULL */
+  void* _spillArg;          /**< Argument of _spill */
+
+  void init(size_t, size_t);
+  uint8_t* block(size_t) const;
+  void newBlock();
+};
+
+#endif
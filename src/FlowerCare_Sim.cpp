@@ -0,0 +1,573 @@
+#ifndef ARDUINO
+
+#include "FlowerCare_Sim.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include "FlowerCare_Adv.h"
+#include "FlowerCare_Driver.h"
+
+/**
+ * @brief Characteristics exposed by the simulated sensor
+ *
+ */
+static const struct {
+  uint16_t service, charact;
+  FC_HANDLE_T handle;
+} simChars[] = {
+    {SERVICE_UUID16, WRITEMODE_UUID16, FC_SIM_HANDLE_WRITEMODE},
+    {SERVICE_UUID16, SENSORDATA_UUID16, FC_SIM_HANDLE_SENSORDATA},
+    {SERVICE_UUID16, VERSIONBATTERY_UUID16, FC_SIM_HANDLE_VERSIONBATTERY},
+    {HISTORY_UUID16, HISTORYCTRL_UUID16, FC_SIM_HANDLE_HISTORYCTRL},
+    {HISTORY_UUID16, HISTORYDATA_UUID16, FC_SIM_HANDLE_HISTORYDATA},
+    {HISTORY_UUID16, DEVICETIME_UUID16, FC_SIM_HANDLE_DEVICETIME},
+};
+
+// value returned by 0x1a01 when the mode command was not written
+static const uint8_t simNoModeData[SENSORDATA_LEN] = {
+    0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff, 0x99, 0x88, 0x77, 0x66};
+
+/*******************************************************************************
+ *                               FlowerCareSim
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ * @param seed seed of the random generator used for failure injection
+ */
+FlowerCareSim::FlowerCareSim(uint32_t seed) : _rng(seed) {
+  config = {};
+  _stats = {};
+}
+
+/**
+ * @brief Add a sensor to the simulation, with plausible default values
+ *
+ * @param addr BLE address of the sensor
+ * @return the simulated sensor, to change its values
+ */
+FlowerCareSimSensor_t* FlowerCareSim::addSensor(const std::string& addr) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  FlowerCareSimSensor_t& s = _sensors[addr];
+  s.addr = addr;
+  s.reachable = true;
+  s.temp = 215;
+  s.moist = 35;
+  s.light = 5000;
+  s.fert = 400;
+  s.battery = 100;
+  s.firmware = "3.1.8";
+  s.handleShift = 0;
+  s.central = NULL;
+  s.modeSet = false;
+  s.advSeq = 0;
+  s.advCounter = 0;
+  s.bootMs = millis();
+  s.history.clear();
+  s.historyMax = 0;
+  s.historySel = -1;
+
+  return &s;
+}
+
+/**
+ * @brief Get a simulated sensor
+ *
+ * @param addr BLE address of the sensor
+ * @return the simulated sensor or NULL if not found
+ */
+FlowerCareSimSensor_t* FlowerCareSim::sensor(const std::string& addr) {
+  std::lock_guard<std::mutex> lock(_mutex);
+
+  std::map<std::string, FlowerCareSimSensor_t>::iterator it =
+      _sensors.find(addr);
+  return it == _sensors.end() ? NULL : &it->second;
+}
+
+/**
+ * @brief Set the values measured by a sensor
+ *
+ * @param addr  BLE address of the sensor
+ * @param temp  temperature in °C
+ * @param moist moisture in %
+ * @param light light in lux
+ * @param fert  EC in us/cm
+ */
+void FlowerCareSim::setData(const std::string& addr, float temp, int moist,
+                            int light, int fert) {
+  FlowerCareSimSensor_t* s = sensor(addr);
+
+  if (s == NULL) {
+    s = addSensor(addr);
+  }
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  s->temp = (int16_t)lroundf(temp * 10);
+  s->moist = (uint8_t)moist;
+  s->light = (uint32_t)light;
+  s->fert = (uint16_t)fert;
+}
+
+/**
+ * @brief Move a sensor in or out of range
+ *
+ * @param addr      BLE address of the sensor
+ * @param reachable false to make every connection attempt time out
+ */
+void FlowerCareSim::setReachable(const std::string& addr, bool reachable) {
+  FlowerCareSimSensor_t* s = sensor(addr);
+
+  if (s != NULL) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    s->reachable = reachable;
+  }
+}
+
+/**
+ * @brief Drop the connection of a sensor, as if the link was lost
+ *
+ * @param addr BLE address of the sensor
+ */
+void FlowerCareSim::dropLink(const std::string& addr) {
+  FlowerCareSimSensor_t* s = sensor(addr);
+
+  if (s != NULL) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    s->central = NULL;
+    s->modeSet = false;
+  }
+}
+
+/**
+ * @brief Append an entry to the history of a sensor
+ *
+ * @param addr    BLE address of the sensor
+ * @param devTime sensor time of the entry, s since the sensor epoch
+ * @param temp    temperature in °C
+ * @param moist   moisture in %
+ * @param light   light in lux
+ * @param fert    EC in us/cm
+ */
+void FlowerCareSim::addHistory(const std::string& addr, uint32_t devTime,
+                               float temp, int moist, int light, int fert) {
+  FlowerCareSimSensor_t* s = sensor(addr);
+
+  if (s == NULL) {
+    s = addSensor(addr);
+  }
+
+  FlowerCareSimHistory_t h;
+  h.devTime = devTime;
+  h.temp = (int16_t)lroundf(temp * 10);
+  h.moist = (uint8_t)moist;
+  h.light = (uint32_t)light;
+  h.fert = (uint16_t)fert;
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  if (s->historyMax > 0 && s->history.size() >= s->historyMax) {
+    s->history.erase(s->history.begin());
+  }
+  s->history.push_back(h);
+}
+
+/**
+ * @brief Get the operation counters
+ *
+ */
+FlowerCareSimStats_t FlowerCareSim::stats() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _stats;
+}
+
+/**
+ * @brief Reset the operation counters
+ *
+ */
+void FlowerCareSim::resetStats() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  _stats = {};
+}
+
+/**
+ * @brief Decide if an operation fails, must be called with _mutex held
+ *
+ * @param prob failure probability
+ * @return true if the operation must fail
+ */
+bool FlowerCareSim::fail(float prob) {
+  if (prob <= 0) {
+    return false;
+  }
+
+  if (std::uniform_real_distribution<float>(0, 1)(_rng) < prob) {
+    _stats.failures++;
+    return true;
+  }
+  return false;
+}
+
+/*******************************************************************************
+ *                          FlowerCareSimTransport
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ * @param sim the simulation hosting the sensors
+ */
+FlowerCareSimTransport::FlowerCareSimTransport(FlowerCareSim* sim) {
+  _sim = sim;
+  _sensor = NULL;
+}
+
+/**
+ * @brief Destructor, close the connection if still open
+ *
+ */
+FlowerCareSimTransport::~FlowerCareSimTransport() { disconnect(); }
+
+/**
+ * @brief Connect to a simulated sensor
+ *
+ * @param addr BLE address of the sensor
+ * @return FLCARE_OK, ERR_ALREADYCONN or ERR_CONNECT
+ */
+FC_RET_T FlowerCareSimTransport::connect(const std::string& addr) {
+  if (isConnected()) {
+    return ERR_ALREADYCONN;
+  }
+
+  FlowerCareSimSensor_t* s = _sim->sensor(addr);
+  bool reachable;
+  {
+    std::lock_guard<std::mutex> lock(_sim->_mutex);
+    reachable = s != NULL && s->reachable;
+  }
+
+  delay(reachable ? _sim->config.connect_ms : _sim->config.timeout_ms);
+
+  std::lock_guard<std::mutex> lock(_sim->_mutex);
+
+  // the sensor accepts one central at a time
+  if (!reachable || s->central != NULL ||
+      _sim->fail(_sim->config.connect_fail)) {
+    return ERR_CONNECT;
+  }
+
+  s->central = this;
+  s->modeSet = false;
+  _sensor = s;
+  _sim->_stats.connects++;
+
+  return FLCARE_OK;
+}
+
+/**
+ * @brief Close the connection
+ *
+ */
+void FlowerCareSimTransport::disconnect() {
+  if (_sensor == NULL) {
+    return;
+  }
+
+  if (isConnected()) {
+    delay(_sim->config.disconnect_ms);
+  }
+
+  std::lock_guard<std::mutex> lock(_sim->_mutex);
+  if (_sensor->central == this) {
+    _sensor->central = NULL;
+    _sensor->modeSet = false;
+  }
+  _sensor = NULL;
+}
+
+/**
+ * @brief Check if the link is up, it goes down after FlowerCareSim::dropLink()
+ *
+ */
+bool FlowerCareSimTransport::isConnected() {
+  std::lock_guard<std::mutex> lock(_sim->_mutex);
+  return _sensor != NULL && _sensor->central == this;
+}
+
+/**
+ * @brief Look up a characteristic of the connected sensor
+ *
+ * @param service 16 bit UUID of the service
+ * @param charact 16 bit UUID of the characteristic
+ * @param handle  where to store the characteristic handle
+ * @return FLCARE_OK, ERR_NOCONN, ERR_SERVICE or ERR_CHARACT
+ */
+FC_RET_T FlowerCareSimTransport::getCharacteristic(uint16_t service,
+                                                   uint16_t charact,
+                                                   FC_HANDLE_T* handle) {
+  delay(_sim->config.discover_ms);
+
+  std::lock_guard<std::mutex> lock(_sim->_mutex);
+
+  if (_sensor == NULL || _sensor->central != this) {
+    return ERR_NOCONN;
+  }
+
+  _sim->_stats.discovers++;
+
+  if (_sim->fail(_sim->config.discover_fail)) {
+    return ERR_SERVICE;
+  }
+
+  bool serviceFound = false;
+  for (size_t i = 0; i < sizeof(simChars) / sizeof(simChars[0]); i++) {
+    if (simChars[i].service == service) {
+      serviceFound = true;
+      if (simChars[i].charact == charact) {
+        *handle = simChars[i].handle + _sensor->handleShift;
+        return FLCARE_OK;
+      }
+    }
+  }
+
+  return serviceFound ? ERR_CHARACT : ERR_SERVICE;
+}
+
+/**
+ * @brief Write a characteristic of the connected sensor
+ *
+ * @param handle   handle returned by getCharacteristic()
+ * @param buf      data to write
+ * @param len      number of bytes to write
+ * @param response ignored, writes are always confirmed
+ * @return FLCARE_OK, ERR_NOCONN, ERR_CHARACT or ERR_WRITE
+ */
+FC_RET_T FlowerCareSimTransport::write(FC_HANDLE_T handle, const uint8_t* buf,
+                                       size_t len, bool response) {
+  (void)response;
+
+  delay(_sim->config.write_ms);
+
+  std::lock_guard<std::mutex> lock(_sim->_mutex);
+
+  if (_sensor == NULL || _sensor->central != this) {
+    return ERR_NOCONN;
+  }
+
+  handle -= _sensor->handleShift;
+  if (handle != FC_SIM_HANDLE_WRITEMODE &&
+      handle != FC_SIM_HANDLE_HISTORYCTRL) {
+    return ERR_CHARACT;
+  }
+
+  _sim->_stats.writes++;
+
+  if (_sim->fail(_sim->config.write_fail)) {
+    return ERR_WRITE;
+  }
+
+  if (handle == FC_SIM_HANDLE_WRITEMODE) {
+    // 0xA01F enables the real time data
+    _sensor->modeSet = len == 2 && buf[0] == 0xA0 && buf[1] == 0x1F;
+  } else if (len == 3 && buf[0] == 0xA0) {
+    // history mode, next read gives the entry count
+    _sensor->historySel = -1;
+  } else if (len == 3 && buf[0] == 0xA1) {
+    // select an entry
+    _sensor->historySel = buf[1] | buf[2] << 8;
+  }
+
+  return FLCARE_OK;
+}
+
+/**
+ * @brief Read a characteristic of the connected sensor
+ *
+ * @param handle handle returned by getCharacteristic()
+ * @param buf    where to store the value
+ * @param len    in: size of buf, out: number of bytes stored
+ * @return FLCARE_OK, ERR_NOCONN, ERR_CHARACT or ERR_READ
+ */
+FC_RET_T FlowerCareSimTransport::read(FC_HANDLE_T handle, uint8_t* buf,
+                                      size_t* len) {
+  delay(_sim->config.read_ms);
+
+  std::lock_guard<std::mutex> lock(_sim->_mutex);
+
+  if (_sensor == NULL || _sensor->central != this) {
+    return ERR_NOCONN;
+  }
+
+  handle -= _sensor->handleShift;
+
+  uint8_t value[SENSORDATA_LEN] = {};
+  size_t valueLen;
+
+  if (handle == FC_SIM_HANDLE_SENSORDATA) {
+    // temp int16 0.1 °C, light uint32 lux, moist uint8 %, EC uint16 us/cm
+    // firmware before 2.6.6 has no mode command
+    uint32_t version = fcVersion(_sensor->firmware.c_str());
+    if (_sensor->modeSet ||
+        (version != 0 && version < FC_VERSION_MODECMD)) {
+      value[0] = (uint8_t)_sensor->temp;
+      value[1] = (uint8_t)((uint16_t)_sensor->temp >> 8);
+      value[3] = (uint8_t)_sensor->light;
+      value[4] = (uint8_t)(_sensor->light >> 8);
+      value[5] = (uint8_t)(_sensor->light >> 16);
+      value[6] = (uint8_t)(_sensor->light >> 24);
+      value[7] = _sensor->moist;
+      value[8] = (uint8_t)_sensor->fert;
+      value[9] = (uint8_t)(_sensor->fert >> 8);
+    } else {
+      memcpy(value, simNoModeData, sizeof(value));
+    }
+    valueLen = SENSORDATA_LEN;
+  } else if (handle == FC_SIM_HANDLE_VERSIONBATTERY) {
+    // battery %, separator, firmware version as text
+    value[0] = _sensor->battery;
+    value[1] = 0x13;
+    valueLen = 2 + _sensor->firmware.copy((char*)value + 2, sizeof(value) - 2);
+  } else if (handle == FC_SIM_HANDLE_HISTORYDATA) {
+    if (_sensor->historySel < 0) {
+      value[0] = (uint8_t)_sensor->history.size();
+      value[1] = (uint8_t)(_sensor->history.size() >> 8);
+    } else if ((size_t)_sensor->historySel < _sensor->history.size()) {
+      const FlowerCareSimHistory_t& h = _sensor->history[_sensor->historySel];
+      // time uint32, temp int16, light uint32, moist uint8, EC uint16
+      for (uint8_t i = 0; i < 4; i++) {
+        value[i] = (uint8_t)(h.devTime >> (8 * i));
+        value[7 + i] = (uint8_t)(h.light >> (8 * i));
+      }
+      value[4] = (uint8_t)h.temp;
+      value[5] = (uint8_t)((uint16_t)h.temp >> 8);
+      value[11] = h.moist;
+      value[12] = (uint8_t)h.fert;
+      value[13] = (uint8_t)(h.fert >> 8);
+    }
+    valueLen = HISTORYDATA_LEN;
+  } else if (handle == FC_SIM_HANDLE_DEVICETIME) {
+    uint32_t devNow = (uint32_t)((millis() - _sensor->bootMs) / 1000);
+    for (uint8_t i = 0; i < 4; i++) {
+      value[i] = (uint8_t)(devNow >> (8 * i));
+    }
+    valueLen = 4;
+  } else {
+    return ERR_CHARACT;
+  }
+
+  _sim->_stats.reads++;
+
+  if (_sim->fail(_sim->config.read_fail)) {
+    *len = 0;
+    return ERR_READ;
+  }
+
+  if (valueLen < *len) {
+    *len = valueLen;
+  }
+  memcpy(buf, value, *len);
+
+  return FLCARE_OK;
+}
+
+/*******************************************************************************
+ *                           FlowerCareSimScanner
+ ******************************************************************************/
+
+// metrics advertised by the sensor, one per frame
+static const uint16_t simAdvObjects[] = {ADV_TEMP, ADV_MOIST, ADV_LIGHT,
+                                         ADV_FERT, ADV_BATTERY};
+#define SIM_ADV_OBJECTS (sizeof(simAdvObjects) / sizeof(simAdvObjects[0]))
+
+/**
+ * @brief Constructor
+ *
+ * @param sim the simulation hosting the sensors
+ */
+FlowerCareSimScanner::FlowerCareSimScanner(FlowerCareSim* sim) { _sim = sim; }
+
+/**
+ * @brief Wait for the scan window and report the frames sent meanwhile by
+ * every sensor in range
+ *
+ * @param ms  scan window in ms
+ * @param cb  called for every advertisement
+ * @param arg argument passed to cb
+ * @return FLCARE_OK
+ */
+FC_RET_T FlowerCareSimScanner::scan(uint32_t ms, FC_ADV_CB_T cb, void* arg) {
+  /**
+   * @brief One received advertisement
+   *
+   */
+  struct Frame {
+    std::string addr;
+    uint8_t data[16];
+    size_t len;
+  };
+  std::vector<Frame> frames;
+
+  delay(ms);
+
+  {
+    std::lock_guard<std::mutex> lock(_sim->_mutex);
+
+    size_t perSensor = _sim->config.adv_interval_ms > 0
+                           ? ms / _sim->config.adv_interval_ms
+                           : SIM_ADV_OBJECTS;
+
+    for (std::map<std::string, FlowerCareSimSensor_t>::iterator it =
+             _sim->_sensors.begin();
+         it != _sim->_sensors.end(); ++it) {
+      FlowerCareSimSensor_t& s = it->second;
+
+      // a connected sensor does not advertise
+      if (!s.reachable || s.central != NULL) {
+        continue;
+      }
+
+      for (size_t i = 0; i < perSensor; i++) {
+        FlowerCareAdv_t adv;
+        adv.product = MIBEACON_FLOWERCARE;
+        adv.counter = s.advCounter++;
+        adv.object = simAdvObjects[s.advSeq];
+        s.advSeq = (s.advSeq + 1) % SIM_ADV_OBJECTS;
+
+        switch (adv.object) {
+          case ADV_TEMP:
+            adv.value = s.temp;
+            break;
+          case ADV_MOIST:
+            adv.value = s.moist;
+            break;
+          case ADV_LIGHT:
+            adv.value = s.light & 0xFFFFFF;
+            break;
+          case ADV_FERT:
+            adv.value = s.fert;
+            break;
+          default:
+            adv.value = s.battery;
+            break;
+        }
+
+        Frame f;
+        f.addr = s.addr;
+        f.len = fcBuildAdv(&adv, f.data, sizeof(f.data));
+        frames.push_back(f);
+        _sim->_stats.advertisements++;
+      }
+    }
+  }
+
+  // callbacks out of the lock, they may use the simulation
+  for (size_t i = 0; i < frames.size(); i++) {
+    cb(frames[i].addr, MIBEACON_UUID16, frames[i].data, frames[i].len, -60,
+       arg);
+  }
+
+  return FLCARE_OK;
+}
+
+#endif
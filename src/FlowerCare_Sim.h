@@ -0,0 +1,159 @@
+#ifndef FLOWERCARE_SIM_H
+#define FLOWERCARE_SIM_H
+
+/* In-process simulation of Flower Care sensors, host builds only.
+ * FlowerCareSim holds the simulated peripherals, FlowerCareSimTransport is the
+ * client side used by FlowerCare in place of the ESP32 BLE library.
+ *
+ * Typical latencies measured on ESP32 with firmware 3.1.8, useful as config:
+ * connect ~1000 ms, discovery ~300 ms, read/write ~50 ms, disconnect ~50 ms
+ */
+
+#ifndef ARDUINO
+
+#include <map>
+#include <mutex>
+#include <random>
+#include <vector>
+#include "FlowerCare_Transport.h"
+
+// attribute handles exposed by the simulated sensor, same as firmware 3.1.8
+#define FC_SIM_HANDLE_WRITEMODE 0x33
+#define FC_SIM_HANDLE_SENSORDATA 0x35
+#define FC_SIM_HANDLE_VERSIONBATTERY 0x38
+#define FC_SIM_HANDLE_HISTORYDATA 0x3c
+#define FC_SIM_HANDLE_HISTORYCTRL 0x3e
+#define FC_SIM_HANDLE_DEVICETIME 0x41
+
+class FlowerCareSimTransport;
+
+/**
+ * @brief Latency and failure injection of the simulated link
+ *
+ */
+typedef struct FlowerCareSimConfig {
+  // latency of every operation in ms
+  uint32_t connect_ms, discover_ms, write_ms, read_ms, disconnect_ms;
+  // time spent before giving up when the sensor is not reachable, in ms
+  uint32_t timeout_ms;
+  // advertising interval of the sensors in ms, 0 sends every metric once
+  // per scan
+  uint32_t adv_interval_ms;
+  // failure probability of every operation, 0 never, 1 always
+  float connect_fail, discover_fail, write_fail, read_fail;
+} FlowerCareSimConfig_t;
+
+/**
+ * @brief Counters of the operations served by the simulation
+ *
+ */
+typedef struct FlowerCareSimStats {
+  uint32_t connects, discovers, writes, reads, failures, advertisements;
+} FlowerCareSimStats_t;
+
+/**
+ * @brief One history entry of a simulated sensor
+ *
+ */
+typedef struct FlowerCareSimHistory {
+  uint32_t devTime;  // sensor time, s since sensor epoch
+  int16_t temp;      // temperature in 0.1 °C
+  uint8_t moist;     // moisture in %
+  uint32_t light;    // light in lux
+  uint16_t fert;     // EC in us/cm
+} FlowerCareSimHistory_t;
+
+/**
+ * @brief State of one simulated Flower Care peripheral
+ *
+ */
+typedef struct FlowerCareSimSensor {
+  std::string addr;
+  bool reachable;          // false when the sensor is out of range
+  int16_t temp;            // temperature in 0.1 °C
+  uint8_t moist;           // moisture in %
+  uint32_t light;          // light in lux
+  uint16_t fert;           // EC in us/cm
+  uint8_t battery;         // battery in %
+  std::string firmware;    // firmware version, "3.1.8"
+  uint8_t handleShift;     // added to every handle, another attribute layout
+  FlowerCareSimTransport* central;  // connected client or NULL
+  bool modeSet;            // 0xA01F written on the current connection
+  uint8_t advSeq;          // next metric to advertise
+  uint8_t advCounter;      // MiBeacon frame counter
+  unsigned long bootMs;    // millis() at sensor epoch
+  std::vector<FlowerCareSimHistory_t> history;  // oldest first
+  uint16_t historyMax;     // ring size, the oldest entry is dropped, 0 none
+  int32_t historySel;      // selected entry, -1 for the entry count
+} FlowerCareSimSensor_t;
+
+/**
+ * @brief A set of simulated Flower Care sensors.
+ * Thread safe, several transports can use the same simulation concurrently
+ */
+class FlowerCareSim {
+ public:
+  FlowerCareSim(uint32_t seed = 1);
+
+  FlowerCareSimSensor_t* addSensor(const std::string&);
+  FlowerCareSimSensor_t* sensor(const std::string&);
+  void setData(const std::string&, float, int, int, int);
+  void setReachable(const std::string&, bool);
+  void dropLink(const std::string&);
+  void addHistory(const std::string&, uint32_t, float, int, int, int);
+
+  FlowerCareSimStats_t stats();
+  void resetStats();
+
+  FlowerCareSimConfig_t config; /**< Link latency and failures */
+
+ private:
+  friend class FlowerCareSimTransport;
+  friend class FlowerCareSimScanner;
+
+  std::map<std::string, FlowerCareSimSensor_t> _sensors;
+  FlowerCareSimStats_t _stats;
+  std::mutex _mutex; /**< Protects _sensors, _stats and _rng */
+  std::mt19937 _rng;
+
+  bool fail(float);
+};
+
+/**
+ * @brief Client side of the simulated link
+ *
+ */
+class FlowerCareSimTransport : public FlowerCareTransport {
+ public:
+  FlowerCareSimTransport(FlowerCareSim*);
+  ~FlowerCareSimTransport();
+
+  FC_RET_T connect(const std::string&);
+  void disconnect();
+  bool isConnected();
+  FC_RET_T getCharacteristic(uint16_t, uint16_t, FC_HANDLE_T*);
+  FC_RET_T write(FC_HANDLE_T, const uint8_t*, size_t, bool);
+  FC_RET_T read(FC_HANDLE_T, uint8_t*, size_t*);
+
+ private:
+  FlowerCareSim* _sim;
+  FlowerCareSimSensor_t* _sensor; /**< Connected sensor or NULL */
+};
+
+/**
+ * @brief Passive scanner receiving the MiBeacon frames of the simulated
+ * sensors in range
+ */
+class FlowerCareSimScanner : public FlowerCareScanner {
+ public:
+  FlowerCareSimScanner(FlowerCareSim*);
+
+  FC_RET_T scan(uint32_t, FC_ADV_CB_T, void*);
+
+ private:
+  FlowerCareSim* _sim;
+};
+
+#endif
+
+#endif
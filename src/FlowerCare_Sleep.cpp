@@ -0,0 +1,299 @@
+#include "FlowerCare_Sleep.h"
+
+#ifdef ARDUINO
+#include <esp_sleep.h>
+#endif
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor, call restore() before the first window
+ *
+ * @param fleet the sensors, at most FC_SLEEP_MAXSENSORS are scheduled
+ * @param state persistent state, in RTC memory on ESP32. Not owned
+ */
+FlowerCareSleep::FlowerCareSleep(FlowerCareFleet* fleet,
+                                 FlowerCareSleepState_t* state) {
+  _fleet = fleet;
+  _state = state;
+  _mark = millis();
+  _windowTime = 0;
+  _cb = NULL;
+  _cbArg = NULL;
+  _due.reserve(FC_SLEEP_MAXSENSORS);
+
+  config.interval = FC_SLEEP_INTERVAL;
+  config.group = FC_SLEEP_GROUP;
+  config.retry = FC_SLEEP_RETRY;
+  config.minSleep = FC_SLEEP_MIN;
+  config.activeMa = 100;
+  config.lightUa = 800;
+  config.deepUa = 10;
+  config.volts = 3.3;
+}
+
+/**
+ * @brief Resume the schedule kept in the state, or start a new one if the
+ * state is not valid (cold boot) or was made for another number of sensors
+ *
+ * @return true if the schedule was resumed
+ */
+bool FlowerCareSleep::restore() {
+  size_t count = _fleet->size();
+  if (count > FC_SLEEP_MAXSENSORS) {
+    count = FC_SLEEP_MAXSENSORS;
+  }
+
+  if (_state->magic != FC_SLEEP_MAGIC || _state->count != count) {
+    reset();
+    return false;
+  }
+
+#ifdef ARDUINO
+  // woken from deep sleep millis() restarted with the boot, while after a
+  // light sleep the object is the same and restore() is not called again
+  _mark = 0;
+#else
+  _mark = millis();
+#endif
+
+  if (_state->mode == SLEEP_DEEP) {
+    _state->wakeups++;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Start a new schedule, every sensor is due at once
+ *
+ */
+void FlowerCareSleep::reset() {
+  size_t count = _fleet->size();
+  if (count > FC_SLEEP_MAXSENSORS) {
+    count = FC_SLEEP_MAXSENSORS;
+  }
+
+  *_state = {};
+  _state->magic = FC_SLEEP_MAGIC;
+  _state->count = (uint16_t)count;
+  _state->mode = SLEEP_LIGHT;
+  _mark = millis();
+
+  for (size_t i = 0; i < count; i++) {
+    _state->sensors[i].interval = config.interval;
+    _state->sensors[i].ret = FLCARE_OK;
+  }
+}
+
+/**
+ * @brief Get the gateway time, kept across deep sleep
+ *
+ * @return the time in ms since the schedule started
+ */
+uint32_t FlowerCareSleep::now() {
+  return _state->clock + (uint32_t)(millis() - _mark);
+}
+
+/**
+ * @brief Set the interval between two readings of a sensor
+ *
+ * @param idx      index of the sensor in the fleet
+ * @param interval the interval in ms, config.interval by default
+ */
+void FlowerCareSleep::setInterval(size_t idx, uint32_t interval) {
+  if (idx < _state->count) {
+    FlowerCareSleepSensor_t& s = _state->sensors[idx];
+    s.interval = interval;
+    if (s.valid) {
+      s.next = s.lastRead + interval;
+    }
+  }
+}
+
+/**
+ * @brief Check if a sensor must be read at a time
+ *
+ * @param idx  index of the sensor in the fleet
+ * @param time gateway time in ms
+ * @return true if the sensor is due at time
+ */
+bool FlowerCareSleep::due(size_t idx, uint32_t time) {
+  return idx < _state->count &&
+         (int32_t)(_state->sensors[idx].next - time) <= 0;
+}
+
+/**
+ * @brief Run one activity window: read every sensor due now or within
+ * config.group, with the connections of the fleet
+ *
+ * @param cb  called after every reading, may be NULL
+ * @param arg argument passed to cb
+ * @return the number of sensors read successfully
+ */
+size_t FlowerCareSleep::window(FC_FLEET_CB_T cb, void* arg) {
+  uint32_t start = millis();
+
+  _windowTime = now();
+  _due.clear();
+  for (size_t i = 0; i < _state->count; i++) {
+    if (due(i, _windowTime + config.group)) {
+      _due.push_back(i);
+    }
+  }
+
+  size_t ok = 0;
+  if (!_due.empty()) {
+    _cb = cb;
+    _cbArg = arg;
+    ok = _fleet->sweep(_due, onRead, this);
+    _cb = NULL;
+    _cbArg = NULL;
+  }
+
+  _state->lastWindow = (uint32_t)(millis() - start);
+  _state->activeMs += _state->lastWindow;
+  _state->windows++;
+
+  return ok;
+}
+
+/**
+ * @brief Get the time of the next window
+ *
+ * @return the gateway time in ms when the first sensor is due
+ */
+uint32_t FlowerCareSleep::nextWindow() {
+  uint32_t time = now();
+  int32_t wait = _state->count > 0 ? INT32_MAX : (int32_t)config.interval;
+
+  for (size_t i = 0; i < _state->count; i++) {
+    int32_t left = (int32_t)(_state->sensors[i].next - time);
+    if (left < wait) {
+      wait = left;
+    }
+  }
+
+  return time + (wait > 0 ? (uint32_t)wait : 0);
+}
+
+/**
+ * @brief Sleep until the next window. With SLEEP_DEEP on ESP32 it does not
+ * return, the sketch restarts from setup() and calls restore()
+ *
+ * @param mode light or deep sleep
+ * @return the time slept in ms, 0 if the next window is too close
+ */
+uint32_t FlowerCareSleep::sleep(FC_SLEEP_T mode) {
+  uint32_t time = now();
+  uint32_t ms = nextWindow() - time;
+
+  if (ms < config.minSleep) {
+    return 0;
+  }
+
+  _state->mode = (uint8_t)mode;
+  _state->lastSleep = ms;
+  _state->sleptMs += ms;
+
+#ifdef ARDUINO
+  esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+  if (mode == SLEEP_DEEP) {
+    // the gateway time when woken up, millis() restarts from 0
+    _state->clock = time + ms;
+    esp_deep_sleep_start();
+  }
+  esp_light_sleep_start();
+#else
+  delay(ms);
+  if (mode == SLEEP_DEEP) {
+    // as after the restart, see restore()
+    _state->clock = time + ms;
+    _mark = millis();
+  }
+#endif
+
+  return ms;
+}
+
+/**
+ * @brief Estimate duty cycle and energy from the measured window and sleep
+ * times and the currents of config
+ *
+ * @param energy where to store the estimate
+ */
+void FlowerCareSleep::report(FlowerCareEnergy_t* energy) {
+  float sleepUa = _state->mode == SLEEP_DEEP ? config.deepUa : config.lightUa;
+  double total = (double)(_state->activeMs + _state->sleptMs);
+
+  energy->windowMs = _state->lastWindow;
+  energy->sleepMs = _state->lastSleep;
+  energy->dutyCycle = total > 0 ? (float)(_state->activeMs / total) : 0;
+
+  // mA * V = mW, mW * ms = uJ
+  energy->windowMj = config.activeMa * config.volts * _state->lastWindow / 1000;
+  energy->sweepMj = energy->windowMj +
+                    sleepUa / 1000 * config.volts * _state->lastSleep / 1000;
+  energy->avgMa = config.activeMa * energy->dutyCycle +
+                  sleepUa / 1000 * (1 - energy->dutyCycle);
+}
+
+/**
+ * @brief Get the persistent state of a sensor
+ *
+ * @param idx index of the sensor in the fleet
+ * @return the state or NULL if idx is not scheduled
+ */
+const FlowerCareSleepSensor_t* FlowerCareSleep::sensor(size_t idx) {
+  return idx < _state->count ? &_state->sensors[idx] : NULL;
+}
+
+/**
+ * @brief Get the history cursor of a sensor, kept across deep sleep
+ *
+ * @param idx index of the sensor in the fleet
+ * @return the cursor or NULL if idx is not scheduled
+ */
+FlowerCareHistoryCursor_t* FlowerCareSleep::cursor(size_t idx) {
+  return idx < _state->count ? &_state->sensors[idx].cursor : NULL;
+}
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+/**
+ * @brief Called by the fleet after every reading of the window
+ *
+ */
+void FlowerCareSleep::onRead(size_t idx, FlowerCare* sensor, FC_RET_T ret,
+                             void* arg) {
+  FlowerCareSleep* self = (FlowerCareSleep*)arg;
+  FlowerCareSleepSensor_t& s = self->_state->sensors[idx];
+
+  uint32_t time = self->_windowTime;
+
+  s.ret = (int8_t)ret;
+  if (ret == FLCARE_OK) {
+    s.reading = sensor->reading();
+    s.valid = true;
+    s.fails = 0;
+    s.lastRead = time;
+    // a sensor read ahead of time keeps its cadence, a late one restarts
+    // from now
+    s.next = (self->due(idx, time) ? time : s.next) + s.interval;
+  } else {
+    if (s.fails < UINT8_MAX) {
+      s.fails++;
+    }
+    // doubled at every failure up to the interval, an unreachable sensor
+    // must not wake the gateway every retry
+    s.next = time + fcBackoff(self->config.retry, s.fails, s.interval);
+  }
+
+  if (self->_cb != NULL) {
+    self->_cb(idx, sensor, ret, self->_cbArg);
+  }
+}
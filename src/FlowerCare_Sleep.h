@@ -0,0 +1,133 @@
+#ifndef FLOWERCARE_SLEEP_H
+#define FLOWERCARE_SLEEP_H
+
+/* Radio windows for battery gateways. All the sensors due within the group
+ * time are read in one activity window, then the ESP32 sleeps until the next
+ * sensor is due. The schedule, the last readings and the history cursors live
+ * in a FlowerCareSleepState_t the sketch puts in RTC memory, so after a deep
+ * sleep wake-up the gateway resumes without NVS access:
+ *
+ *   RTC_DATA_ATTR FlowerCareSleepState_t rtcState;
+ *
+ * Time is kept as gateway ms, carried across deep sleep by the state. On host
+ * sleep() waits with delay(), see fcSimClock() to run schedules at once
+ */
+
+#include <vector>
+#include "FlowerCare_Fleet.h"
+
+// max sensors kept in the state
+#define FC_SLEEP_MAXSENSORS 16
+// marks a valid state
+#define FC_SLEEP_MAGIC 0x46435331UL
+// default interval between two readings of a sensor, in ms
+#define FC_SLEEP_INTERVAL 600000UL
+// default lookahead, sensors due within it are read in the current window
+#define FC_SLEEP_GROUP 60000UL
+// default wait before reading again a sensor that failed, in ms
+#define FC_SLEEP_RETRY 60000UL
+// default shortest sleep, shorter waits start the next window at once
+#define FC_SLEEP_MIN 1000UL
+
+/**
+ * @brief Sleep mode between two windows
+ *
+ */
+enum FC_SLEEP_T {
+  SLEEP_LIGHT = 0,  // RAM kept, sleep() returns
+  SLEEP_DEEP,       // only RTC memory kept, restarts from setup()
+};
+
+/**
+ * @brief Schedule configuration, times in ms. The currents are used only to
+ * estimate the energy, see FlowerCareSleep::report()
+ *
+ */
+typedef struct FlowerCareSleepConfig {
+  uint32_t interval; /**< Default interval between two readings */
+  uint32_t group;    /**< Sensors due within it join the current window */
+  uint32_t retry;    /**< Wait before reading a failed sensor again */
+  uint32_t minSleep; /**< Shortest sleep worth entering */
+  float activeMa;    /**< Current during a window, radio on, mA */
+  float lightUa;     /**< Current in light sleep, uA */
+  float deepUa;      /**< Current in deep sleep, uA */
+  float volts;       /**< Supply voltage */
+} FlowerCareSleepConfig_t;
+
+/**
+ * @brief Persistent state of one sensor
+ *
+ */
+typedef struct FlowerCareSleepSensor {
+  FlowerCareReading_t reading;      /**< Last successful reading */
+  FlowerCareHistoryCursor_t cursor; /**< For FlowerCare::syncHistory() */
+  uint32_t next;     /**< Gateway ms when the sensor is due */
+  uint32_t interval; /**< Interval between two readings, ms */
+  uint32_t lastRead; /**< Gateway ms of the last successful reading */
+  int8_t ret;        /**< Result of the last reading */
+  uint8_t fails;     /**< Failed readings in a row */
+  bool valid;        /**< true once reading holds a value */
+} FlowerCareSleepSensor_t;
+
+/**
+ * @brief State kept across deep sleep, meant for RTC memory
+ *
+ */
+typedef struct FlowerCareSleepState {
+  uint32_t magic;    /**< FC_SLEEP_MAGIC once initialized */
+  uint16_t count;    /**< Sensors in use */
+  uint8_t mode;      /**< FC_SLEEP_T of the last sleep */
+  uint32_t clock;    /**< Gateway ms at the last wake-up or cold boot */
+  uint32_t windows;  /**< Windows since cold boot */
+  uint32_t wakeups;  /**< Wake-ups from deep sleep since cold boot */
+  uint32_t lastWindow; /**< Duration of the last window, ms */
+  uint32_t lastSleep;  /**< Duration of the last sleep, ms */
+  uint64_t activeMs;   /**< Time spent in windows since cold boot */
+  uint64_t sleptMs;    /**< Time spent sleeping since cold boot */
+  FlowerCareSleepSensor_t sensors[FC_SLEEP_MAXSENSORS];
+} FlowerCareSleepState_t;
+
+/**
+ * @brief Estimated duty cycle and energy
+ *
+ */
+typedef struct FlowerCareEnergy {
+  uint32_t windowMs; /**< Duration of the last window */
+  uint32_t sleepMs;  /**< Duration of the last sleep */
+  float dutyCycle;   /**< Fraction of time in windows since cold boot */
+  float windowMj;    /**< Energy of the last window, mJ */
+  float sweepMj;     /**< Last window plus the sleep after it, mJ */
+  float avgMa;       /**< Average current since cold boot, mA */
+} FlowerCareEnergy_t;
+
+class FlowerCareSleep {
+ public:
+  FlowerCareSleep(FlowerCareFleet*, FlowerCareSleepState_t*);
+
+  bool restore();
+  void reset();
+  uint32_t now();
+  void setInterval(size_t, uint32_t);
+  bool due(size_t, uint32_t);
+  size_t window(FC_FLEET_CB_T = NULL, void* = NULL);
+  uint32_t nextWindow();
+  uint32_t sleep(FC_SLEEP_T);
+  void report(FlowerCareEnergy_t*);
+  const FlowerCareSleepSensor_t* sensor(size_t);
+  FlowerCareHistoryCursor_t* cursor(size_t);
+
+  FlowerCareSleepConfig_t config;
+
+ private:
+  FlowerCareFleet* _fleet;         /**< Sensors, not owned */
+  FlowerCareSleepState_t* _state;  /**< Persistent state, not owned */
+  uint32_t _mark;                  /**< millis() when _state->clock was set */
+  uint32_t _windowTime;            /**< Gateway ms of the running window */
+  std::vector<size_t> _due;        /**< Sensors of the running window */
+  FC_FLEET_CB_T _cb;               /**< Callback of the running window */
+  void* _cbArg;                    /**< Argument of _cb */
+
+  static void onRead(size_t, FlowerCare*, FC_RET_T, void*);
+};
+
+#endif
@@ -0,0 +1,257 @@
+#include "FlowerCare_Stats.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+
+static const char* phaseNames[PHASE_COUNT] = {
+    "connect", "discover", "settle", "write", "read", "disconnect", "total"};
+
+/**
+ * @brief Append formatted text to a buffer, like snprintf() but keeping
+ * track of the position. Output is truncated when the buffer is full
+ *
+ * @param buf buffer
+ * @param len size of buf
+ * @param pos current length, updated
+ * @param fmt printf format
+ */
+static void append(char* buf, size_t len, size_t* pos, const char* fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static void append(char* buf, size_t len, size_t* pos, const char* fmt, ...) {
+  if (*pos >= len) {
+    return;
+  }
+
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf + *pos, len - *pos, fmt, args);
+  va_end(args);
+
+  if (n > 0) {
+    *pos = *pos + n < len ? *pos + n : len - 1;
+  }
+}
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ */
+FlowerCareStats::FlowerCareStats() { reset(); }
+
+/**
+ * @brief Record the duration of a phase
+ *
+ * @param phase the phase
+ * @param us    duration in us
+ */
+void FlowerCareStats::record(FC_PHASE_T phase, uint32_t us) {
+  uint8_t bucket = 0;
+
+  // position of the highest bit set
+  for (uint32_t v = us; v != 0 && bucket < FC_STATS_BUCKETS - 1; v >>= 1) {
+    bucket++;
+  }
+
+  _hist[phase][bucket].fetch_add(1, std::memory_order_relaxed);
+  _count[phase].fetch_add(1, std::memory_order_relaxed);
+  uint32_t lo = _sumLo[phase].fetch_add(us, std::memory_order_relaxed);
+  if (lo + us < lo) {
+    _sumHi[phase].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint32_t max = _maxUs[phase].load(std::memory_order_relaxed);
+  while (us > max && !_maxUs[phase].compare_exchange_weak(
+                         max, us, std::memory_order_relaxed)) {
+  }
+}
+
+/**
+ * @brief Count the result of a reading
+ *
+ * @param ret the result
+ */
+void FlowerCareStats::result(FC_RET_T ret) {
+  uint32_t idx = ret < FC_STATS_RETCODES ? ret : FC_STATS_RETCODES - 1;
+  _results[idx].fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Copy the statistics. Counters are read one by one, a snapshot taken
+ * during a reading may be off by the samples being recorded, and the total
+ * time by 2^32 us (~72 min) if it is taken while its low word wraps
+ *
+ * @param snap where to copy the statistics
+ */
+void FlowerCareStats::snapshot(FlowerCareStatsSnapshot_t* snap) {
+  for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+    for (uint8_t b = 0; b < FC_STATS_BUCKETS; b++) {
+      snap->hist[p][b] = _hist[p][b].load(std::memory_order_relaxed);
+    }
+    snap->count[p] = _count[p].load(std::memory_order_relaxed);
+    snap->sumUs[p] =
+        (uint64_t)_sumHi[p].load(std::memory_order_relaxed) << 32 |
+        _sumLo[p].load(std::memory_order_relaxed);
+    snap->maxUs[p] = _maxUs[p].load(std::memory_order_relaxed);
+  }
+  for (uint8_t r = 0; r < FC_STATS_RETCODES; r++) {
+    snap->results[r] = _results[r].load(std::memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief Clear all statistics
+ *
+ */
+void FlowerCareStats::reset() {
+  for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+    for (uint8_t b = 0; b < FC_STATS_BUCKETS; b++) {
+      _hist[p][b].store(0, std::memory_order_relaxed);
+    }
+    _count[p].store(0, std::memory_order_relaxed);
+    _sumLo[p].store(0, std::memory_order_relaxed);
+    _sumHi[p].store(0, std::memory_order_relaxed);
+    _maxUs[p].store(0, std::memory_order_relaxed);
+  }
+  for (uint8_t r = 0; r < FC_STATS_RETCODES; r++) {
+    _results[r].store(0, std::memory_order_relaxed);
+  }
+}
+
+/**
+ * @brief Estimate a percentile from the histogram, interpolating linearly
+ * inside the bucket holding it, capped to the max sample
+ *
+ * @param snap  the statistics
+ * @param phase the phase
+ * @param p     percentile, 0-100
+ * @return the percentile in us, 0 if no samples
+ */
+uint32_t FlowerCareStats::percentile(const FlowerCareStatsSnapshot_t* snap,
+                                     FC_PHASE_T phase, float p) {
+  uint32_t count = snap->count[phase];
+
+  if (count == 0) {
+    return 0;
+  }
+
+  uint64_t rank = (uint64_t)(p / 100 * count + 0.5f);
+  if (rank < 1) {
+    rank = 1;
+  }
+
+  uint64_t seen = 0;
+  for (uint8_t b = 0; b < FC_STATS_BUCKETS; b++) {
+    uint32_t n = snap->hist[phase][b];
+    if (seen + n >= rank) {
+      uint32_t lower = b == 0 ? 0 : (uint32_t)(1ULL << (b - 1));
+      uint32_t upper = b == 0 ? 0 : (uint32_t)((1ULL << b) - 1);
+      uint32_t val = lower + (uint32_t)((uint64_t)(upper - lower) *
+                                        (rank - seen) / n);
+      return val < snap->maxUs[phase] ? val : snap->maxUs[phase];
+    }
+    seen += n;
+  }
+
+  return snap->maxUs[phase];
+}
+
+/**
+ * @brief Format the statistics as text, one line per phase
+ *
+ * @param snap the statistics
+ * @param buf  where to write the text
+ * @param len  size of buf
+ * @return the text length, truncated if buf is too small
+ */
+size_t FlowerCareStats::toText(const FlowerCareStatsSnapshot_t* snap,
+                               char* buf, size_t len) {
+  size_t pos = 0;
+
+  if (len == 0) {
+    return 0;
+  }
+  buf[0] = '\0';
+
+  for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+    FC_PHASE_T ph = (FC_PHASE_T)p;
+    uint32_t n = snap->count[p];
+    append(buf, len, &pos,
+           "%-10s n=%lu avg=%luus p50=%luus p99=%luus max=%luus\n",
+           phaseNames[p], (unsigned long)n,
+           (unsigned long)(n ? snap->sumUs[p] / n : 0),
+           (unsigned long)percentile(snap, ph, 50),
+           (unsigned long)percentile(snap, ph, 99),
+           (unsigned long)snap->maxUs[p]);
+  }
+
+  append(buf, len, &pos, "results");
+  for (uint8_t r = 0; r < FC_STATS_RETCODES; r++) {
+    if (snap->results[r] != 0) {
+      append(buf, len, &pos, " %u:%lu", r, (unsigned long)snap->results[r]);
+    }
+  }
+  append(buf, len, &pos, "\n");
+
+  return pos;
+}
+
+/**
+ * @brief Format the statistics as JSON:
+ * {"phases":{"connect":{"n":..,"sum_us":..,"max_us":..,"p50_us":..,
+ * "p99_us":..,"hist":[..]},..},"results":[..]}
+ *
+ * @param snap the statistics
+ * @param buf  where to write the JSON
+ * @param len  size of buf
+ * @return the JSON length, truncated if buf is too small
+ */
+size_t FlowerCareStats::toJson(const FlowerCareStatsSnapshot_t* snap,
+                               char* buf, size_t len) {
+  size_t pos = 0;
+
+  if (len == 0) {
+    return 0;
+  }
+  buf[0] = '\0';
+
+  append(buf, len, &pos, "{\"phases\":{");
+  for (uint8_t p = 0; p < PHASE_COUNT; p++) {
+    FC_PHASE_T ph = (FC_PHASE_T)p;
+    append(buf, len, &pos,
+           "%s\"%s\":{\"n\":%lu,\"sum_us\":%llu,\"max_us\":%lu,"
+           "\"p50_us\":%lu,\"p99_us\":%lu,\"hist\":[",
+           p ? "," : "", phaseNames[p], (unsigned long)snap->count[p],
+           (unsigned long long)snap->sumUs[p], (unsigned long)snap->maxUs[p],
+           (unsigned long)percentile(snap, ph, 50),
+           (unsigned long)percentile(snap, ph, 99));
+    for (uint8_t b = 0; b < FC_STATS_BUCKETS; b++) {
+      append(buf, len, &pos, "%s%lu", b ? "," : "",
+             (unsigned long)snap->hist[p][b]);
+    }
+    append(buf, len, &pos, "]}");
+  }
+
+  append(buf, len, &pos, "},\"results\":[");
+  for (uint8_t r = 0; r < FC_STATS_RETCODES; r++) {
+    append(buf, len, &pos, "%s%lu", r ? "," : "",
+           (unsigned long)snap->results[r]);
+  }
+  append(buf, len, &pos, "]}");
+
+  return pos;
+}
+
+/**
+ * @brief Get the name of a phase
+ *
+ * @param phase the phase
+ * @return the name, as used in toText() and toJson()
+ */
+const char* FlowerCareStats::phaseName(FC_PHASE_T phase) {
+  return phase < PHASE_COUNT ? phaseNames[phase] : "";
+}
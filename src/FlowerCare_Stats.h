@@ -0,0 +1,73 @@
+#ifndef FLOWERCARE_STATS_H
+#define FLOWERCARE_STATS_H
+
+/* Latency histograms of every phase of a reading and result counters.
+ * Fixed size, updated with relaxed 32-bit atomics: no heap and no lock on the
+ * hot path, a FlowerCareStats can be shared by all the sensors of a fleet.
+ * 64-bit atomics are not lock free on ESP32, the total time of a phase is
+ * kept in two 32-bit words. 32-bit atomics are lock free on Xtensa (ESP32,
+ * S2, S3) and on hosts; targets without atomic instructions (ESP32-C3)
+ * emulate them and take a short lock per counter
+ */
+
+#include <atomic>
+#include "FlowerCare_Defs.h"
+
+// histogram buckets: bucket 0 < 1 us, bucket i in [2^(i-1), 2^i) us, the
+// last one holds everything above 2^(FC_STATS_BUCKETS - 2) us (~8 s)
+#define FC_STATS_BUCKETS 25
+// result codes counted, FC_RET_T values above are counted in the last one
+#define FC_STATS_RETCODES 16
+
+/**
+ * @brief Phases of a reading
+ *
+ */
+enum FC_PHASE_T {
+  PHASE_CONNECT = 0,  // transport connect()
+  PHASE_DISCOVER,     // service and characteristic lookup
+  PHASE_SETTLE,       // wait before the mode write
+  PHASE_WRITE,        // mode write
+  PHASE_READ,         // characteristic reads
+  PHASE_DISCONNECT,   // transport disconnect()
+  PHASE_TOTAL,        // whole reading
+  PHASE_COUNT,
+};
+
+/**
+ * @brief Plain copy of the statistics, see FlowerCareStats::snapshot()
+ *
+ */
+typedef struct FlowerCareStatsSnapshot {
+  uint32_t hist[PHASE_COUNT][FC_STATS_BUCKETS]; /**< Samples per bucket */
+  uint32_t count[PHASE_COUNT];                  /**< Samples per phase */
+  uint64_t sumUs[PHASE_COUNT];                  /**< Total time per phase */
+  uint32_t maxUs[PHASE_COUNT];                  /**< Longest sample */
+  uint32_t results[FC_STATS_RETCODES];          /**< Readings per FC_RET_T */
+} FlowerCareStatsSnapshot_t;
+
+class FlowerCareStats {
+ public:
+  FlowerCareStats();
+
+  void record(FC_PHASE_T, uint32_t);
+  void result(FC_RET_T);
+  void snapshot(FlowerCareStatsSnapshot_t*);
+  void reset();
+
+  static uint32_t percentile(const FlowerCareStatsSnapshot_t*, FC_PHASE_T,
+                             float);
+  static size_t toText(const FlowerCareStatsSnapshot_t*, char*, size_t);
+  static size_t toJson(const FlowerCareStatsSnapshot_t*, char*, size_t);
+  static const char* phaseName(FC_PHASE_T);
+
+ private:
+  std::atomic<uint32_t> _hist[PHASE_COUNT][FC_STATS_BUCKETS];
+  std::atomic<uint32_t> _count[PHASE_COUNT];
+  std::atomic<uint32_t> _sumLo[PHASE_COUNT]; /**< Total time, low word */
+  std::atomic<uint32_t> _sumHi[PHASE_COUNT]; /**< Carries of _sumLo */
+  std::atomic<uint32_t> _maxUs[PHASE_COUNT];
+  std::atomic<uint32_t> _results[FC_STATS_RETCODES];
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "FlowerCare_Store.h"
+
+#include <ctype.h>
+#include <stdio.h>
+
+#ifdef ARDUINO
+/*******************************************************************************
+ *                            FlowerCareNVSStore
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ * @param name NVS namespace
+ */
+FlowerCareNVSStore::FlowerCareNVSStore(const char* name) {
+  _prefs.begin(name, false);
+}
+
+/**
+ * @brief Destructor
+ *
+ */
+FlowerCareNVSStore::~FlowerCareNVSStore() { _prefs.end(); }
+
+/**
+ * @brief Load a value
+ *
+ * @param key max FC_STORE_KEYLEN chars
+ * @param buf where to store the value
+ * @param len expected length of the value
+ * @return true if the value exists with the expected length
+ */
+bool FlowerCareNVSStore::load(const char* key, void* buf, size_t len) {
+  return _prefs.getBytesLength(key) == len &&
+         _prefs.getBytes(key, buf, len) == len;
+}
+
+/**
+ * @brief Save a value
+ *
+ * @param key max FC_STORE_KEYLEN chars
+ * @param buf the value
+ * @param len length of the value
+ * @return true on success
+ */
+bool FlowerCareNVSStore::save(const char* key, const void* buf, size_t len) {
+  return _prefs.putBytes(key, buf, len) == len;
+}
+#else
+/*******************************************************************************
+ *                            FlowerCareFileStore
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ * @param dir existing directory where to store the files
+ */
+FlowerCareFileStore::FlowerCareFileStore(const std::string& dir) {
+  _dir = dir;
+}
+
+/**
+ * @brief Load a value
+ *
+ * @param key max FC_STORE_KEYLEN chars
+ * @param buf where to store the value
+ * @param len expected length of the value
+ * @return true if the value exists with the expected length
+ */
+bool FlowerCareFileStore::load(const char* key, void* buf, size_t len) {
+  FILE* f = fopen((_dir + "/" + key).c_str(), "rb");
+
+  if (f == NULL) {
+    return false;
+  }
+
+  // the file must hold exactly len bytes
+  bool ok = fread(buf, 1, len, f) == len && fgetc(f) == EOF;
+  fclose(f);
+
+  return ok;
+}
+
+/**
+ * @brief Save a value, written to a temporary file and renamed so that a
+ * crash never leaves a truncated value
+ *
+ * @param key max FC_STORE_KEYLEN chars
+ * @param buf the value
+ * @param len length of the value
+ * @return true on success
+ */
+bool FlowerCareFileStore::save(const char* key, const void* buf, size_t len) {
+  std::string path = _dir + "/" + key;
+  std::string tmp = path + ".tmp";
+  FILE* f = fopen(tmp.c_str(), "wb");
+
+  if (f == NULL) {
+    return false;
+  }
+
+  bool ok = fwrite(buf, 1, len, f) == len;
+  ok = fclose(f) == 0 && ok;
+
+  return ok && rename(tmp.c_str(), path.c_str()) == 0;
+}
+#endif
+
+/**
+ * @brief Build the storage key of a sensor: a prefix followed by the hex
+ * digits of the address, "XX:XX:XX:XX:XX:XX" -> "pxxxxxxxxxxxx"
+ *
+ * @param prefix kind of value
+ * @param addr   BLE address of the sensor
+ * @param key    where to store the key, FC_STORE_KEYLEN + 1 bytes
+ */
+void fcStoreKey(char prefix, const std::string& addr, char* key) {
+  size_t n = 0;
+
+  key[n++] = prefix;
+  for (size_t i = 0; i < addr.size() && n < FC_STORE_KEYLEN; i++) {
+    if (isxdigit((unsigned char)addr[i])) {
+      key[n++] = (char)tolower((unsigned char)addr[i]);
+    }
+  }
+  key[n] = '\0';
+}
@@ -0,0 +1,81 @@
+#ifndef FLOWERCARE_STORE_H
+#define FLOWERCARE_STORE_H
+
+/* Small persistent key/value storage used for data that must survive a
+ * reboot (history cursors, ...). NVS on ESP32, one file per key on host
+ */
+
+#include "FlowerCare_Defs.h"
+
+#ifdef ARDUINO
+#include <Preferences.h>
+#endif
+
+// max key length, NVS limit
+#define FC_STORE_KEYLEN 15
+
+/**
+ * @brief Persistent storage of binary values
+ *
+ */
+class FlowerCareStore {
+ public:
+  virtual ~FlowerCareStore() {}
+
+  /**
+   * @brief Load a value
+   *
+   * @param key max FC_STORE_KEYLEN chars
+   * @param buf where to store the value
+   * @param len expected length of the value
+   * @return true if the value exists with the expected length
+   */
+  virtual bool load(const char* key, void* buf, size_t len) = 0;
+
+  /**
+   * @brief Save a value
+   *
+   * @param key max FC_STORE_KEYLEN chars
+   * @param buf the value
+   * @param len length of the value
+   * @return true on success
+   */
+  virtual bool save(const char* key, const void* buf, size_t len) = 0;
+};
+
+#ifdef ARDUINO
+/**
+ * @brief Storage in the ESP32 NVS partition
+ *
+ */
+class FlowerCareNVSStore : public FlowerCareStore {
+ public:
+  FlowerCareNVSStore(const char* = "flcare");
+  ~FlowerCareNVSStore();
+
+  bool load(const char*, void*, size_t);
+  bool save(const char*, const void*, size_t);
+
+ private:
+  Preferences _prefs;
+};
+#else
+/**
+ * @brief Storage in a directory, one file per key
+ *
+ */
+class FlowerCareFileStore : public FlowerCareStore {
+ public:
+  FlowerCareFileStore(const std::string&);
+
+  bool load(const char*, void*, size_t);
+  bool save(const char*, const void*, size_t);
+
+ private:
+  std::string _dir; /**< Directory holding the files */
+};
+#endif
+
+void fcStoreKey(char, const std::string&, char*);
+
+#endif
@@ -0,0 +1,114 @@
+#include "FlowerCare_Task.h"
+
+/*******************************************************************************
+ *                                  PUBLIC
+ ******************************************************************************/
+
+/**
+ * @brief Constructor
+ *
+ */
+FlowerCareTask::FlowerCareTask() {
+  _fn = NULL;
+  _arg = NULL;
+  _running = false;
+#ifdef ARDUINO
+  _done = NULL;
+#endif
+}
+
+/**
+ * @brief Destructor, wait for the task to end
+ *
+ */
+FlowerCareTask::~FlowerCareTask() {
+  join();
+#ifdef ARDUINO
+  if (_done != NULL) {
+    vSemaphoreDelete(_done);
+  }
+#endif
+}
+
+/**
+ * @brief Start the task
+ *
+ * @param fn    function to run
+ * @param arg   argument of fn
+ * @param name  task name, ESP32 only
+ * @param core  core where to pin the task, -1 for any. ESP32 only
+ * @param stack stack size in bytes, ESP32 only
+ * @return true if the task started
+ */
+bool FlowerCareTask::start(FC_TASK_FN_T fn, void* arg, const char* name,
+                           int core, uint32_t stack) {
+  if (_running) {
+    return false;
+  }
+
+  _fn = fn;
+  _arg = arg;
+
+#ifdef ARDUINO
+  if (_done == NULL) {
+    _done = xSemaphoreCreateBinary();
+  }
+
+  if (xTaskCreatePinnedToCore(entry, name, stack, this, FC_TASK_PRIO, NULL,
+                              core < 0 ? tskNO_AFFINITY : core) != pdPASS) {
+    return false;
+  }
+#else
+  (void)name;
+  (void)core;
+  (void)stack;
+  _thread = std::thread(fn, arg);
+#endif
+
+  _running = true;
+  return true;
+}
+
+/**
+ * @brief Wait for the task to end, return immediately if not started
+ *
+ */
+void FlowerCareTask::join() {
+  if (!_running) {
+    return;
+  }
+
+#ifdef ARDUINO
+  xSemaphoreTake(_done, portMAX_DELAY);
+#else
+  _thread.join();
+#endif
+
+  _running = false;
+}
+
+/**
+ * @brief Check if the task was started and not joined yet
+ *
+ */
+bool FlowerCareTask::running() { return _running; }
+
+/*******************************************************************************
+ *                                  PRIVATE
+ ******************************************************************************/
+
+#ifdef ARDUINO
+/**
+ * @brief Entry point of the FreeRTOS task
+ *
+ * @param task the FlowerCareTask object
+ */
+void FlowerCareTask::entry(void* task) {
+  FlowerCareTask* t = (FlowerCareTask*)task;
+
+  t->_fn(t->_arg);
+
+  xSemaphoreGive(t->_done);
+  vTaskDelete(NULL);
+}
+#endif
@@ -0,0 +1,54 @@
+#ifndef FLOWERCARE_TASK_H
+#define FLOWERCARE_TASK_H
+
+/* Minimal task wrapper: a FreeRTOS task on ESP32, a std::thread on host */
+
+#include "FlowerCare_Defs.h"
+
+#ifdef ARDUINO
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#else
+#include <thread>
+#endif
+
+// stack size of the tasks, BLE calls need more than the default
+#define FC_TASK_STACK 4096
+// priority of the tasks on ESP32
+#define FC_TASK_PRIO 1
+
+/**
+ * @brief Function run by a task
+ *
+ */
+typedef void (*FC_TASK_FN_T)(void*);
+
+class FlowerCareTask {
+ public:
+  FlowerCareTask();
+  ~FlowerCareTask();
+
+  bool start(FC_TASK_FN_T, void*, const char* = "flcare", int = -1,
+             uint32_t = FC_TASK_STACK);
+  void join();
+  bool running();
+
+  FlowerCareTask(const FlowerCareTask&) = delete;
+  FlowerCareTask& operator=(const FlowerCareTask&) = delete;
+
+ private:
+  FC_TASK_FN_T _fn; /**< Function run by the task */
+  void* _arg;       /**< Argument of _fn */
+  bool _running;    /**< true between start() and join() */
+
+#ifdef ARDUINO
+  SemaphoreHandle_t _done; /**< Given when _fn returns */
+
+  static void entry(void*);
+#else
+  std::thread _thread;
+#endif
+};
+
+#endif
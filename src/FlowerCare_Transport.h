@@ -0,0 +1,111 @@
+#ifndef FLOWERCARE_TRANSPORT_H
+#define FLOWERCARE_TRANSPORT_H
+
+#include "FlowerCare_Defs.h"
+
+/**
+ * @brief Handle of a resolved characteristic. 0 is never a valid handle
+ *
+ */
+typedef uint16_t FC_HANDLE_T;
+
+/**
+ * @brief Link used by FlowerCare to talk with one sensor at a time.
+ * Implemented on ESP32 by FlowerCareESP32Transport and on Linux by the
+ * simulated peripheral FlowerCareSimTransport.
+ * A transport holds at most one connection, so every FlowerCare object that
+ * must be read concurrently needs its own transport
+ */
+class FlowerCareTransport {
+ public:
+  virtual ~FlowerCareTransport() {}
+
+  /**
+   * @brief Connect to the sensor
+   *
+   * @param addr BLE address of the sensor, "XX:XX:XX:XX:XX:XX"
+   * @return FLCARE_OK, ERR_ALREADYCONN or ERR_CONNECT
+   */
+  virtual FC_RET_T connect(const std::string& addr) = 0;
+
+  /**
+   * @brief Close the connection, does nothing if not connected
+   *
+   */
+  virtual void disconnect() = 0;
+
+  /**
+   * @brief Check if the link is up
+   *
+   */
+  virtual bool isConnected() = 0;
+
+  /**
+   * @brief Look up a characteristic of the connected sensor
+   *
+   * @param service 16 bit UUID of the service
+   * @param charact 16 bit UUID of the characteristic
+   * @param handle  where to store the characteristic handle
+   * @return FLCARE_OK, ERR_NOCONN, ERR_SERVICE or ERR_CHARACT
+   */
+  virtual FC_RET_T getCharacteristic(uint16_t service, uint16_t charact,
+                                     FC_HANDLE_T* handle) = 0;
+
+  /**
+   * @brief Write a characteristic
+   *
+   * @param handle   handle returned by getCharacteristic()
+   * @param buf      data to write
+   * @param len      number of bytes to write
+   * @param response true to wait for the write response
+   * @return FLCARE_OK, ERR_NOCONN, ERR_CHARACT or ERR_WRITE
+   */
+  virtual FC_RET_T write(FC_HANDLE_T handle, const uint8_t* buf, size_t len,
+                         bool response) = 0;
+
+  /**
+   * @brief Read a characteristic
+   *
+   * @param handle handle returned by getCharacteristic()
+   * @param buf    where to store the value
+   * @param len    in: size of buf, out: number of bytes stored
+   * @return FLCARE_OK, ERR_NOCONN, ERR_CHARACT or ERR_READ
+   */
+  virtual FC_RET_T read(FC_HANDLE_T handle, uint8_t* buf, size_t* len) = 0;
+};
+
+/**
+ * @brief Called for every advertisement carrying service data
+ *
+ * @param addr     BLE address of the advertiser
+ * @param uuid     16 bit UUID of the service data
+ * @param data     service data
+ * @param len      length of data
+ * @param rssi     signal strength in dBm
+ * @param arg      argument given to scan()
+ */
+typedef void (*FC_ADV_CB_T)(const std::string& addr, uint16_t uuid,
+                            const uint8_t* data, size_t len, int rssi,
+                            void* arg);
+
+/**
+ * @brief Passive scanner reporting the service data of advertisements.
+ * Implemented on ESP32 by FlowerCareESP32Scanner and on Linux by
+ * FlowerCareSimScanner
+ */
+class FlowerCareScanner {
+ public:
+  virtual ~FlowerCareScanner() {}
+
+  /**
+   * @brief Scan without connecting, blocking for the whole window
+   *
+   * @param ms  scan window in ms
+   * @param cb  called for every advertisement with service data
+   * @param arg argument passed to cb
+   * @return FLCARE_OK or ERR_CONNECT if the scan could not start
+   */
+  virtual FC_RET_T scan(uint32_t ms, FC_ADV_CB_T cb, void* arg) = 0;
+};
+
+#endif
@@ -2,7 +2,8 @@
 #define PLANTS_H
 
 /* TODO implement _MEDHIGH and _MEDLOW levels if necessary
- * Implement light control over the day (integral of lux over day)
+ * Light over the day: see FlowerCare_Light.h, DLI targets are derived from the
+ * light levels
  */
 
 // temperature levels in °C
@@ -44,68 +45,6 @@ enum Level {
   _ND,  // data not available
 };
 
-enum Plant {
-  // test plant
-  FICUS_GINSEGN,
-  // high temperature indoor plants (tender plants) www.coolgarden.me
-  ACALYPHA,
-  ANTHURIUM,
-  CALADIUM,
-  CALATHEA,
-  CISSUS_DISCOLOR,
-  DIEFFENBACHIA,
-  DIZYGOTHECA,
-  SAINTPAULIA,
-  SYNGONIUM,
-  // med temperature indoor plants (non-hardy plants) www.coolgarden.me
-  APHELANDRA,
-  ARAUCARIA,
-  ASPARAGUS,
-  BEGONIA,
-  BROMELIADS,
-  CITRUS,
-  COLEUS,
-  DRACAENA,
-  FERNS,
-  FICUS,
-  GYNURA,
-  HOYA,
-  IMPATIENS,
-  KALANCHOE,
-  MARANTA,
-  MONSTERA,
-  ORCHIDS,
-  PALM,
-  PANDANUS,
-  PEPEROMIA,
-  PHILODENDRON,
-  SANSEVIERIA,
-  SCHEFFLERA,
-  // low temperature indoor plants (hardy plants) www.coolgarden.me
-  ASPIDISTRA,
-  CHLOROPHYTUM,
-  CLIVIA,
-  CUPHEA,
-  FATSHEDERA,
-  FATSIA,
-  GREVILLEA,
-  HEDERA,
-  HELXINE,
-  LAURUS,
-  PELARGONIUM,
-  SAXIFRAGA,
-  SUCCULENTS,
-  TRADESCANTIA,
-  VINES,
-  YUCCA,
-
-  // pier
-  ROSMARINUS_OFFICINALIS,
-  THYMUS_VULGARIS,
-  SALVIA_OFFICINALIS_LATIFOLIA,
-  OCIMUM_BASILICUM,
-};
-
 /* #define [plantName]_VAL [temp Level],[moist Level],[light Level],
                            [fert Level]
 */
@@ -173,4 +112,75 @@ enum Plant {
 */
 //  AGGIUNGERE PIANTE QUI SOTTO
 
+/* Plants with a _VAL define above. The Plant enum and the profile table
+ * (FlowerCare_Profile.h) are generated from this list, so adding a plant means
+ * adding its _VAL define and its line here
+ */
+#define PLANT_LIST(X)                                                      \
+  /* high temperature indoor plants (tender plants) www.coolgarden.me */   \
+  X(ACALYPHA)                                                              \
+  X(ANTHURIUM)                                                             \
+  X(CALADIUM)                                                              \
+  X(CALATHEA)                                                              \
+  X(CISSUS_DISCOLOR)                                                       \
+  X(DIEFFENBACHIA)                                                         \
+  X(DIZYGOTHECA)                                                           \
+  X(SAINTPAULIA)                                                           \
+  X(SYNGONIUM)                                                             \
+  /* med temperature indoor plants (non-hardy plants) www.coolgarden.me */ \
+  X(APHELANDRA)                                                            \
+  X(ARAUCARIA)                                                             \
+  X(ASPARAGUS)                                                             \
+  X(BEGONIA)                                                               \
+  X(BROMELIADS)                                                            \
+  X(CITRUS)                                                                \
+  X(COLEUS)                                                                \
+  X(DRACAENA)                                                              \
+  X(FERNS)                                                                 \
+  X(FICUS)                                                                 \
+  X(GYNURA)                                                                \
+  X(HOYA)                                                                  \
+  X(IMPATIENS)                                                             \
+  X(KALANCHOE)                                                             \
+  X(MARANTA)                                                               \
+  X(MONSTERA)                                                              \
+  X(ORCHIDS)                                                               \
+  X(PALM)                                                                  \
+  X(PANDANUS)                                                              \
+  X(PEPEROMIA)                                                             \
+  X(PHILODENDRON)                                                          \
+  X(SANSEVIERIA)                                                           \
+  X(SCHEFFLERA)                                                            \
+  /* low temperature indoor plants (hardy plants) www.coolgarden.me */     \
+  X(ASPIDISTRA)                                                            \
+  X(CHLOROPHYTUM)                                                          \
+  X(CLIVIA)                                                                \
+  X(CUPHEA)                                                                \
+  X(FATSHEDERA)                                                            \
+  X(FATSIA)                                                                \
+  X(GREVILLEA)                                                             \
+  X(HEDERA)                                                                \
+  X(HELXINE)                                                               \
+  X(LAURUS)                                                                \
+  X(PELARGONIUM)                                                           \
+  X(SAXIFRAGA)                                                             \
+  X(SUCCULENTS)                                                            \
+  X(TRADESCANTIA)                                                          \
+  X(VINES)                                                                 \
+  X(YUCCA)                                                                 \
+  /* pier */                                                               \
+  X(ROSMARINUS_OFFICINALIS)                                                \
+  X(THYMUS_VULGARIS)                                                       \
+  X(SALVIA_OFFICINALIS_LATIFOLIA)                                          \
+  X(OCIMUM_BASILICUM)
+
+#define PLANT_ENUM(name) name,
+
+enum Plant {
+  // test plant, values set in FlowerCare_Profile.h
+  FICUS_GINSEGN,
+  PLANT_LIST(PLANT_ENUM)
+  PLANT_COUNT,  // number of plants, not a plant
+};
+
 #endif
\ No newline at end of file